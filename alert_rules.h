@@ -0,0 +1,464 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "event_log.h"
+#include "metric_history.h"
+
+// Metrics alert rules can test, filled per GPU by the monitor from each sweep
+enum class AlertMetric : uint8_t {
+    Temperature,        // °C
+    GPUUtilization,     // %
+    MemoryUtilization,  // %
+    PowerUsage,         // W
+    PowerPercent,       // Draw as % of the maximum power limit
+    MemoryPercent,      // Memory used as % of total
+    CoreClock,          // MHz
+    MemoryClock,        // MHz
+    FanSpeed,           // %
+    PcieTx,             // MB/s
+    PcieRx,             // MB/s
+    NvLinkTx,           // MB/s, all links
+    NvLinkRx,           // MB/s, all links
+    EncoderUtilization, // %
+    DecoderUtilization, // %
+    EccCorrected,       // Errors since the driver loaded
+    EccUncorrected,
+    Count
+};
+
+static constexpr int kAlertMetricCount = static_cast<int>(AlertMetric::Count);
+
+// Names used in rule text, in AlertMetric order
+static const char* const kAlertMetricNames[kAlertMetricCount] = {
+    "temp", "util", "mem_util", "power", "power_pct", "mem_pct", "core_clock", "mem_clock", "fan",
+    "pcie_tx", "pcie_rx", "nvlink_tx", "nvlink_rx", "enc", "dec", "ecc_corrected", "ecc_uncorrected",
+};
+
+// "temp, util, ...", for help text; built once, since the UI shows it every frame
+inline const std::string& alertMetricList() {
+    static const std::string list = [] {
+        std::string names;
+        for (int i = 0; i < kAlertMetricCount; i++) {
+            if (i > 0) names += ", ";
+            names += kAlertMetricNames[i];
+        }
+        return names;
+    }();
+    return list;
+}
+
+enum class AlertCompare : uint8_t { Greater, GreaterEqual, Less, LessEqual };
+
+enum class AlertKind : uint8_t {
+    Level,        // The value itself
+    Rate,         // Change per second, in the metric's unit
+    RelativeRate, // Change per second, in % of the value at the start of the window
+};
+
+// One compiled rule: a row of the predicate table walked for every GPU
+struct AlertRule {
+    uint16_t id = 0; // Stable while the rule's text is unchanged; names its events
+    AlertMetric metric = AlertMetric::Temperature;
+    AlertCompare compare = AlertCompare::Greater;
+    AlertKind kind = AlertKind::Level;
+    float threshold = 0.0f;
+    int64_t hold_us = 0; // Condition must hold this long before the alert fires
+};
+
+inline bool compareAlertValue(double value, AlertCompare compare, double threshold) {
+    switch (compare) {
+        case AlertCompare::Greater: return value > threshold;
+        case AlertCompare::GreaterEqual: return value >= threshold;
+        case AlertCompare::Less: return value < threshold;
+        case AlertCompare::LessEqual: return value <= threshold;
+    }
+    return false;
+}
+
+// Parses rules such as "temp > 85 for 30s", "power spike > 20%/s" or
+// "fan < 10 for 2m". A value in /s or %/s makes it a rate rule; "drop" turns
+// it around, so "power drop > 50 W/s" fires when draw falls that fast.
+inline bool parseAlertRule(const std::string& text, AlertRule& rule, std::string& error) {
+    const char* cursor = text.c_str();
+    auto skipSpace = [&] {
+        while (std::isspace(static_cast<unsigned char>(*cursor))) cursor++;
+    };
+    auto readWord = [&](std::string& word) {
+        skipSpace();
+        word.clear();
+        while (std::isalnum(static_cast<unsigned char>(*cursor)) || *cursor == '_') {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(*cursor++)));
+        }
+        return !word.empty();
+    };
+    auto consume = [&](const char* token) {
+        skipSpace();
+        size_t length = std::strlen(token);
+        if (std::strncmp(cursor, token, length) != 0) return false;
+        cursor += length;
+        return true;
+    };
+    
+    rule = AlertRule();
+    std::string word;
+    if (!readWord(word)) {
+        error = "expected a metric name";
+        return false;
+    }
+    if (word == "temperature") word = "temp";
+    int metric = -1;
+    for (int i = 0; i < kAlertMetricCount; i++) {
+        if (word == kAlertMetricNames[i]) metric = i;
+    }
+    if (metric < 0) {
+        error = "unknown metric '" + word + "'";
+        return false;
+    }
+    rule.metric = static_cast<AlertMetric>(metric);
+    
+    bool rate = false;
+    bool falling = false;
+    if (readWord(word)) {
+        if (word == "rate" || word == "spike" || word == "rise") {
+            rate = true;
+        } else if (word == "drop" || word == "fall") {
+            rate = falling = true;
+        } else {
+            error = "unexpected '" + word + "'";
+            return false;
+        }
+    }
+    
+    if (consume(">=")) {
+        rule.compare = AlertCompare::GreaterEqual;
+    } else if (consume(">")) {
+        rule.compare = AlertCompare::Greater;
+    } else if (consume("<=")) {
+        rule.compare = AlertCompare::LessEqual;
+    } else if (consume("<")) {
+        rule.compare = AlertCompare::Less;
+    } else {
+        error = "expected >, >=, < or <=";
+        return false;
+    }
+    
+    skipSpace();
+    char* end;
+    double value = std::strtod(cursor, &end);
+    if (end == cursor) {
+        error = "expected a number";
+        return false;
+    }
+    cursor = end;
+    
+    // Units are decoration, except that a per-second one makes it a rate
+    consume("MB/s") || consume("MHz") || consume("C") || consume("W");
+    if (consume("%/s")) {
+        rule.kind = AlertKind::RelativeRate;
+    } else if (consume("/s")) {
+        rule.kind = AlertKind::Rate;
+    } else {
+        consume("%");
+    }
+    if (rate && rule.kind == AlertKind::Level) {
+        error = "a rate needs a value in /s or %/s";
+        return false;
+    }
+    if (falling) { // Falling faster than x is a rate below -x
+        value = -value;
+        static const AlertCompare kMirrored[] = {AlertCompare::Less, AlertCompare::LessEqual, AlertCompare::Greater,
+                                                 AlertCompare::GreaterEqual};
+        rule.compare = kMirrored[static_cast<int>(rule.compare)];
+    }
+    rule.threshold = static_cast<float>(value);
+    
+    if (readWord(word)) {
+        if (word != "for") {
+            error = "unexpected '" + word + "'";
+            return false;
+        }
+        skipSpace();
+        double hold = std::strtod(cursor, &end);
+        if (end == cursor || hold < 0) {
+            error = "expected a duration after 'for'";
+            return false;
+        }
+        cursor = end;
+        double scale = 1e6;
+        if (readWord(word)) {
+            if (word == "ms") {
+                scale = 1e3;
+            } else if (word == "m" || word == "min") {
+                scale = 60e6;
+            } else if (word == "h") {
+                scale = 3600e6;
+            } else if (word != "s") {
+                error = "unknown duration unit '" + word + "'";
+                return false;
+            }
+        }
+        rule.hold_us = static_cast<int64_t>(hold * scale);
+    }
+    
+    skipSpace();
+    if (*cursor) {
+        error = std::string("unexpected '") + cursor + "'";
+        return false;
+    }
+    return true;
+}
+
+// Evaluates alert rules against every sweep, on the sampler thread. Each
+// (rule, GPU) pair keeps constant-size state: when its condition started
+// holding and, for rate rules, where the current window started. A sweep is
+// one pass over the predicate table, never a look back through history.
+// Alerts are logged as GPUEventKind::Alert when they fire and when they clear.
+class AlertEngine {
+public:
+    static constexpr size_t kMaxRules = 64;
+    static constexpr int64_t kRateWindowUs = 1000000; // Rates are measured over at least this long
+    
+    // One GPU's values for a sweep
+    struct Sample {
+        float values[kAlertMetricCount] = {};
+        bool valid = false; // False for a GPU that missed the sweep; its state is left alone
+    };
+    
+    struct RuleStatus {
+        uint16_t id = 0;
+        std::string text;
+        std::vector<uint8_t> active; // Per GPU index
+        std::vector<uint64_t> fired; // Per GPU index, since the rule was added
+    };
+    
+private:
+    struct State {
+        int64_t since_us = 0;  // When the condition started holding, 0 = not holding
+        int64_t window_us = 0; // Rate rules: start of the current window, 0 = none yet
+        float window_value = 0.0f;
+        bool rate_condition = false; // Rate rules: result of the last complete window
+        bool active = false;
+        uint64_t fired = 0;
+    };
+    
+    GPUEventLog& log;
+    mutable std::mutex mutex;
+    std::vector<AlertRule> rules;   // Guarded by mutex
+    std::vector<std::string> names; // Rule text by id, guarded by mutex; kept so old events stay readable
+    std::vector<State> states;      // [gpu * rules.size() + rule], guarded by mutex
+    size_t gpu_count = 0;           // Guarded by mutex
+    std::atomic<bool> has_rules{false};
+    std::atomic<uint64_t> version{0};
+    
+    // Caller holds mutex
+    void logAlert(size_t gpu_index, uint16_t rule_id, bool fired, int64_t timestamp_us) {
+        GPUEvent event;
+        event.timestamp_us = timestamp_us;
+        event.gpu_index = static_cast<uint16_t>(gpu_index);
+        event.kind = GPUEventKind::Alert;
+        event.data = rule_id | (fired ? 0 : kAlertClearedBit);
+        log.append(event);
+        version.fetch_add(1, std::memory_order_release);
+    }
+    
+    // Caller holds mutex; GPUs past the old count start with fresh state
+    void resizeGPUs(size_t count) {
+        states.resize(count * rules.size());
+        gpu_count = count;
+    }
+    
+    uint16_t idFor(const std::string& text) {
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == text) return static_cast<uint16_t>(i);
+        }
+        names.push_back(text);
+        return static_cast<uint16_t>(names.size() - 1);
+    }
+    
+public:
+    explicit AlertEngine(GPUEventLog& event_log) : log(event_log) {}
+    
+    AlertEngine(const AlertEngine&) = delete;
+    AlertEngine& operator=(const AlertEngine&) = delete;
+    
+    // Replaces the rules with one per non-empty line of lines ('#' starts a
+    // comment). On a parse error nothing changes and error names the line.
+    // Rules whose text is unchanged keep their state, so editing one rule
+    // doesn't re-fire the others; alerts of removed rules are logged as cleared.
+    bool setRules(const std::vector<std::string>& lines, std::string& error) {
+        std::vector<AlertRule> compiled;
+        std::vector<std::string> texts;
+        for (size_t i = 0; i < lines.size(); i++) {
+            std::string text = lines[i].substr(0, lines[i].find('#'));
+            text.erase(0, text.find_first_not_of(" \t\r\n"));
+            text.erase(text.find_last_not_of(" \t\r\n") + 1);
+            if (text.empty()) continue;
+            
+            AlertRule rule;
+            std::string rule_error;
+            if (!parseAlertRule(text, rule, rule_error)) {
+                error = "Line " + std::to_string(i + 1) + ": " + rule_error;
+                return false;
+            }
+            compiled.push_back(rule);
+            texts.push_back(text);
+        }
+        if (compiled.size() > kMaxRules) {
+            error = "At most " + std::to_string(kMaxRules) + " rules";
+            return false;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t r = 0; r < compiled.size(); r++) {
+            compiled[r].id = idFor(texts[r]);
+        }
+        
+        int64_t now_us = wallClockMicros();
+        std::vector<State> new_states(gpu_count * compiled.size());
+        for (size_t old_rule = 0; old_rule < rules.size(); old_rule++) {
+            size_t new_rule = 0;
+            while (new_rule < compiled.size() && compiled[new_rule].id != rules[old_rule].id) new_rule++;
+            for (size_t gpu = 0; gpu < gpu_count; gpu++) {
+                const State& state = states[gpu * rules.size() + old_rule];
+                if (new_rule < compiled.size()) {
+                    new_states[gpu * compiled.size() + new_rule] = state;
+                } else if (state.active) {
+                    logAlert(gpu, rules[old_rule].id, false, now_us);
+                }
+            }
+        }
+        rules = std::move(compiled);
+        states = std::move(new_states);
+        has_rules = !rules.empty();
+        version.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+    
+    bool hasRules() const { return has_rules.load(std::memory_order_relaxed); }
+    
+    // Bumped when the rules change or an alert fires or clears
+    uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
+    
+    // Sampler thread; samples[i] is GPU i
+    void evaluate(const std::vector<Sample>& samples, int64_t now_us) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (samples.size() != gpu_count) resizeGPUs(samples.size());
+        size_t rule_count = rules.size();
+        for (size_t gpu = 0; gpu < gpu_count; gpu++) {
+            const Sample& sample = samples[gpu];
+            if (!sample.valid) continue;
+            State* row = states.data() + gpu * rule_count;
+            for (size_t r = 0; r < rule_count; r++) {
+                const AlertRule& rule = rules[r];
+                State& state = row[r];
+                float value = sample.values[static_cast<int>(rule.metric)];
+                
+                bool condition;
+                if (rule.kind == AlertKind::Level) {
+                    condition = compareAlertValue(value, rule.compare, rule.threshold);
+                } else {
+                    if (state.window_us == 0) {
+                        state.window_us = now_us;
+                        state.window_value = value;
+                    } else if (now_us - state.window_us >= kRateWindowUs) {
+                        double rate = (value - state.window_value) * 1e6 / (now_us - state.window_us);
+                        if (rule.kind == AlertKind::RelativeRate) {
+                            rate = state.window_value != 0.0f ? rate * 100.0 / std::fabs(state.window_value) : 0.0;
+                        }
+                        state.rate_condition = compareAlertValue(rate, rule.compare, rule.threshold);
+                        state.window_us = now_us;
+                        state.window_value = value;
+                    }
+                    condition = state.rate_condition;
+                }
+                
+                if (!condition) {
+                    state.since_us = 0;
+                    if (state.active) {
+                        state.active = false;
+                        logAlert(gpu, rule.id, false, now_us);
+                    }
+                    continue;
+                }
+                if (state.since_us == 0) state.since_us = now_us;
+                if (!state.active && now_us - state.since_us >= rule.hold_us) {
+                    state.active = true;
+                    state.fired++;
+                    logAlert(gpu, rule.id, true, now_us);
+                }
+            }
+        }
+    }
+    
+    // Follows a change of device set, like GPUEventLog::remapGPUs(); GPUs that are gone lose their state
+    void remapGPUs(const std::vector<int>& old_to_new, size_t new_count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t rule_count = rules.size();
+        std::vector<State> remapped(new_count * rule_count);
+        for (size_t gpu = 0; gpu < gpu_count && gpu < old_to_new.size(); gpu++) {
+            if (old_to_new[gpu] < 0 || static_cast<size_t>(old_to_new[gpu]) >= new_count) continue;
+            std::copy(states.begin() + gpu * rule_count, states.begin() + (gpu + 1) * rule_count,
+                      remapped.begin() + old_to_new[gpu] * rule_count);
+        }
+        states.swap(remapped);
+        gpu_count = new_count;
+        version.fetch_add(1, std::memory_order_release);
+    }
+    
+    // Forgets every GPU's state (the rules stay), e.g. after a full re-detection
+    void resetState() {
+        std::lock_guard<std::mutex> lock(mutex);
+        states.clear();
+        gpu_count = 0;
+        version.fetch_add(1, std::memory_order_release);
+    }
+    
+    // The rules' text, in order
+    std::vector<std::string> ruleTexts() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string> texts;
+        for (const AlertRule& rule : rules) texts.push_back(names[rule.id]);
+        return texts;
+    }
+    
+    // Every rule with its per-GPU state; reuses out's storage
+    void copyStatus(std::vector<RuleStatus>& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        out.resize(rules.size());
+        for (size_t r = 0; r < rules.size(); r++) {
+            RuleStatus& status = out[r];
+            status.id = rules[r].id;
+            status.text = names[rules[r].id];
+            status.active.resize(gpu_count);
+            status.fired.resize(gpu_count);
+            for (size_t gpu = 0; gpu < gpu_count; gpu++) {
+                const State& state = states[gpu * rules.size() + r];
+                status.active[gpu] = state.active ? 1 : 0;
+                status.fired[gpu] = state.fired;
+            }
+        }
+    }
+    
+    // E.g. "Alert: temp > 85 for 30s" or "Cleared: temp > 85 for 30s"
+    void describe(const GPUEvent& event, char* out, size_t size) const {
+        uint32_t id = event.data & ~kAlertClearedBit;
+        const char* prefix = event.data & kAlertClearedBit ? "Cleared" : "Alert";
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id < names.size()) {
+            std::snprintf(out, size, "%s: %s", prefix, names[id].c_str());
+        } else {
+            formatGPUEvent(event, out, size);
+        }
+    }
+};
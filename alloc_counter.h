@@ -0,0 +1,68 @@
+#pragma once
+
+// Debug builds count heap allocations per thread, so the UI can check that a
+// steady-state frame allocates nothing. The global operator new/delete are
+// replaced, which is why this header must be included by exactly one
+// translation unit (the one defining main()). Release builds (NDEBUG) and
+// builds with GPUTUNE_NO_ALLOC_COUNTER keep the standard allocator.
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if !defined(NDEBUG) && !defined(GPUTUNE_NO_ALLOC_COUNTER)
+    #define GPUTUNE_COUNT_ALLOCATIONS 1
+#endif
+
+#ifdef GPUTUNE_COUNT_ALLOCATIONS
+
+inline uint64_t& threadAllocationCount() {
+    static thread_local uint64_t count = 0;
+    return count;
+}
+
+inline void* countedAllocate(std::size_t size) {
+    threadAllocationCount()++;
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    threadAllocationCount()++;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    threadAllocationCount()++;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+// For ImGui::SetAllocatorFunctions, so ImGui's own buffers are counted too
+inline void* countedImGuiAlloc(std::size_t size, void*) {
+    threadAllocationCount()++;
+    return std::malloc(size);
+}
+
+inline void countedImGuiFree(void* pointer, void*) { std::free(pointer); }
+
+#endif // GPUTUNE_COUNT_ALLOCATIONS
+
+// Allocations made by the calling thread so far (always 0 without the counter)
+inline uint64_t allocationCount() {
+#ifdef GPUTUNE_COUNT_ALLOCATIONS
+    return threadAllocationCount();
+#else
+    return 0;
+#endif
+}
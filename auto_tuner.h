@@ -0,0 +1,476 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gpu_monitor.h"
+#include "stress_kernel.h"
+
+// Automated search for the most efficient clock/power-limit point of a GPU.
+// Each candidate runs the built-in stress kernel for a trial; a candidate is
+// feasible when it produced no arithmetic errors, stayed below the temperature
+// limit and kept at least min_throughput_ratio of the stock throughput. The
+// winner is the feasible candidate with the best throughput per watt.
+//
+// Search: stock baseline -> core clock hill climb (halving step) at the highest
+// memory clock -> binary search for the lowest feasible power limit -> the
+// remaining memory clocks at the chosen core clock and power limit.
+struct AutoTuneOptions {
+    double trial_seconds = 3.0;
+    int temperature_limit_c = 83;
+    float min_throughput_ratio = 0.90f; // Of the stock baseline
+    int clock_step = 4;                 // Initial hill climb step, in supported-clock entries
+    unsigned int power_resolution_mw = 5000;
+};
+
+struct AutoTuneTrial {
+    unsigned int core_clock = 0;   // MHz, 0 = stock application clocks
+    unsigned int memory_clock = 0; // MHz, 0 = stock
+    unsigned int power_limit_mw = 0;
+    double gflops = 0.0;
+    float watts = 0.0f;
+    double perf_per_watt = 0.0; // GFLOPS/W
+    float max_temperature = 0.0f;
+    uint64_t errors = 0;
+    bool feasible = false;
+    std::string note;
+};
+
+struct AutoTuneResult {
+    bool complete = false; // Search finished (not cancelled or failed)
+    bool has_best = false;
+    AutoTuneTrial baseline;
+    AutoTuneTrial best;
+    std::vector<AutoTuneTrial> trials;
+    std::string error;
+};
+
+class AutoTuner {
+private:
+    static constexpr double kWarmupSeconds = 0.5;
+    static constexpr int kCooldownMarginC = 8;
+    static constexpr double kMaxCooldownSeconds = 30.0;
+    
+    struct Job {
+        std::thread thread;
+        std::atomic<bool> running{false};
+        std::atomic<bool> cancel{false};
+        mutable std::mutex mutex;
+        std::string status;
+        AutoTuneResult result;
+        uint64_t version = 0; // Bumped under mutex on every status/result change
+    };
+    
+    // Everything one search needs on its own thread
+    struct Search {
+        Job& job;
+        size_t gpu_index;
+        AutoTuneOptions options;
+        GPUDevice device;
+        StressKernel kernel;
+        double min_gflops = 0.0;
+        std::vector<MetricSample> scratch;
+        std::vector<float> values;
+        
+        Search(Job& job, size_t gpu_index, const AutoTuneOptions& options) :
+            job(job), gpu_index(gpu_index), options(options) {}
+    };
+    
+    GPUMonitor& monitor;
+    std::vector<std::unique_ptr<Job>> jobs; // Indexed by GPU; touched only by the owning thread
+    
+    void setStatus(Job& job, const std::string& status) {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        job.status = status;
+        job.version++;
+    }
+    
+    bool restoreStock(Search& search) {
+        bool clocks = monitor.resetApplicationClocks(search.gpu_index);
+        bool power = monitor.setPowerLimit(search.gpu_index, search.device.power_limit_default);
+        return clocks && power;
+    }
+    
+    bool applyTrial(Search& search, const AutoTuneTrial& trial) {
+        bool clocks = trial.core_clock == 0
+            ? monitor.resetApplicationClocks(search.gpu_index)
+            : monitor.setApplicationClocks(search.gpu_index, trial.memory_clock, trial.core_clock);
+        return clocks && monitor.setPowerLimit(search.gpu_index, trial.power_limit_mw);
+    }
+    
+    float latestTemperature(Search& search, int64_t since_us) {
+        monitor.copyHistory(search.gpu_index, HistoryMetric::Temperature, since_us, search.scratch, search.values);
+        return search.values.empty() ? 0.0f : search.values.back();
+    }
+    
+    // Lets the card cool down after a trial that ran hot, so the next one starts level
+    void cooldown(Search& search) {
+        float target = static_cast<float>(search.options.temperature_limit_c - kCooldownMarginC);
+        auto start = std::chrono::steady_clock::now();
+        while (!search.job.cancel.load() &&
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < kMaxCooldownSeconds) {
+            int64_t recent_us = wallClockMicros() - 2000000;
+            if (latestTemperature(search, recent_us) < target) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        }
+    }
+    
+    // Runs one candidate and records it. Power and temperature come from the
+    // monitor's history for the trial window, so the tuner adds no NVML polling.
+    AutoTuneTrial runTrial(Search& search, AutoTuneTrial trial) {
+        char status[128];
+        snprintf(status, sizeof(status), "Trial %zu: %u MHz core, %u MHz memory, %u W",
+                 search.job.result.trials.size() + 1, trial.core_clock, trial.memory_clock,
+                 trial.power_limit_mw / 1000);
+        setStatus(search.job, status);
+        
+        if (!applyTrial(search, trial)) {
+            trial.note = "Driver rejected the settings";
+            restoreStock(search);
+            return record(search, trial);
+        }
+        
+        auto stop = [&]() { return search.job.cancel.load(); };
+        search.kernel.run(kWarmupSeconds, stop); // Let clocks and power settle
+        
+        int64_t since_us = wallClockMicros();
+        bool too_hot = false;
+        StressResult stress = search.kernel.run(search.options.trial_seconds, [&]() {
+            if (latestTemperature(search, since_us) >= search.options.temperature_limit_c) too_hot = true;
+            return too_hot || stop();
+        });
+        
+        monitor.copyHistory(search.gpu_index, HistoryMetric::Power, since_us, search.scratch, search.values);
+        double power_sum = 0.0;
+        for (float value : search.values) power_sum += value;
+        trial.watts = search.values.empty() ? 0.0f : static_cast<float>(power_sum / search.values.size());
+        
+        monitor.copyHistory(search.gpu_index, HistoryMetric::Temperature, since_us, search.scratch, search.values);
+        for (float value : search.values) trial.max_temperature = std::max(trial.max_temperature, value);
+        
+        trial.gflops = stress.gflops;
+        trial.errors = stress.errors;
+        trial.perf_per_watt = trial.watts > 0.0f ? trial.gflops / trial.watts : 0.0;
+        
+        if (!stress.ok) {
+            trial.note = stress.error;
+        } else if (trial.errors > 0) {
+            trial.note = "Computation errors";
+        } else if (too_hot) {
+            trial.note = "Temperature limit reached";
+        } else if (search.job.cancel.load()) {
+            trial.note = "Cancelled";
+        } else if (trial.watts <= 0.0f) {
+            trial.note = "No power readings";
+        } else if (trial.gflops < search.min_gflops) {
+            trial.note = "Throughput below target";
+        } else {
+            trial.feasible = true;
+        }
+        
+        // Unstable or hot: back to stock at once rather than at the next trial
+        if (!stress.ok || trial.errors > 0 || too_hot) {
+            restoreStock(search);
+            cooldown(search);
+        }
+        return record(search, trial);
+    }
+    
+    AutoTuneTrial record(Search& search, const AutoTuneTrial& trial) {
+        std::lock_guard<std::mutex> lock(search.job.mutex);
+        search.job.result.trials.push_back(trial);
+        search.job.version++;
+        return trial;
+    }
+    
+    // Reuses an earlier trial of the same point instead of running it again
+    bool findTrial(Search& search, const AutoTuneTrial& point, AutoTuneTrial& found) {
+        std::lock_guard<std::mutex> lock(search.job.mutex);
+        for (const AutoTuneTrial& trial : search.job.result.trials) {
+            if (trial.core_clock == point.core_clock && trial.memory_clock == point.memory_clock &&
+                trial.power_limit_mw == point.power_limit_mw) {
+                found = trial;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Only the settings of point are used; its measurements are replaced
+    AutoTuneTrial evaluate(Search& search, const AutoTuneTrial& point) {
+        AutoTuneTrial found;
+        if (findTrial(search, point, found)) return found;
+        AutoTuneTrial trial;
+        trial.core_clock = point.core_clock;
+        trial.memory_clock = point.memory_clock;
+        trial.power_limit_mw = point.power_limit_mw;
+        return runTrial(search, trial);
+    }
+    
+    static bool better(const AutoTuneTrial& a, const AutoTuneTrial& b) {
+        if (a.feasible != b.feasible) return a.feasible;
+        return a.perf_per_watt > b.perf_per_watt;
+    }
+    
+    // Hill climb down the supported graphics clocks (highest first) with a halving step
+    AutoTuneTrial climbCoreClock(Search& search, const std::vector<unsigned int>& graphics_clocks,
+                                 AutoTuneTrial current) {
+        size_t index = 0;
+        current.core_clock = graphics_clocks[0];
+        current = evaluate(search, current);
+        int step = std::max(1, search.options.clock_step);
+        
+        while (step > 0 && !search.job.cancel.load()) {
+            size_t next = std::min(graphics_clocks.size() - 1, index + static_cast<size_t>(step));
+            if (next == index) {
+                step /= 2;
+                continue;
+            }
+            AutoTuneTrial candidate = current;
+            candidate.core_clock = graphics_clocks[next];
+            candidate = evaluate(search, candidate);
+            
+            // Errors or heat at a clock mean lower clocks are the only way forward
+            bool unstable = !current.feasible && (current.errors > 0 || current.max_temperature >= search.options.temperature_limit_c);
+            if (better(candidate, current) || unstable) {
+                index = next;
+                current = candidate;
+            } else {
+                step /= 2;
+            }
+        }
+        return current;
+    }
+    
+    // Lowest power limit that still meets the throughput target at these clocks
+    AutoTuneTrial searchPowerLimit(Search& search, AutoTuneTrial current) {
+        unsigned int low = search.device.power_limit_min;
+        unsigned int high = current.power_limit_mw;
+        
+        while (high > low + search.options.power_resolution_mw && !search.job.cancel.load()) {
+            AutoTuneTrial candidate = current;
+            candidate.power_limit_mw = low + (high - low) / 2;
+            candidate = evaluate(search, candidate);
+            if (candidate.feasible) {
+                high = candidate.power_limit_mw;
+                if (better(candidate, current)) current = candidate;
+            } else {
+                low = candidate.power_limit_mw;
+            }
+        }
+        return current;
+    }
+    
+    void runSearch(Job& job, size_t gpu_index, AutoTuneOptions options) {
+        Search search(job, gpu_index, options);
+        auto fail = [&](const std::string& error) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.result.error = error;
+            job.status = "Failed: " + error;
+            job.version++;
+        };
+        
+        const GPUDevice* device = monitor.getDevice(gpu_index);
+        if (!device) {
+            fail("GPU not found");
+            job.running = false;
+            return;
+        }
+        search.device = *device;
+        
+        std::string error;
+        setStatus(job, "Starting stress kernel");
+        if (!search.kernel.open(search.device.pci_bus_id, error)) {
+            fail(error);
+            job.running = false;
+            return;
+        }
+        
+        // Stock baseline sets the throughput target
+        AutoTuneTrial stock;
+        stock.power_limit_mw = search.device.power_limit_default;
+        restoreStock(search);
+        AutoTuneTrial baseline = runTrial(search, stock);
+        if (!baseline.feasible) {
+            restoreStock(search);
+            fail("Baseline failed: " + baseline.note);
+            job.running = false;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.result.baseline = baseline;
+            job.version++;
+        }
+        search.min_gflops = baseline.gflops * options.min_throughput_ratio;
+        
+        AutoTuneTrial best = baseline;
+        std::vector<unsigned int> memory_clocks = monitor.getSupportedMemoryClocks(gpu_index);
+        std::vector<unsigned int> graphics_clocks;
+        if (!memory_clocks.empty()) {
+            graphics_clocks = monitor.getSupportedGraphicsClocks(gpu_index, memory_clocks[0]);
+        }
+        
+        if (!graphics_clocks.empty() && !job.cancel.load()) {
+            AutoTuneTrial start = stock;
+            start.memory_clock = memory_clocks[0];
+            AutoTuneTrial clocked = climbCoreClock(search, graphics_clocks, start);
+            if (better(clocked, best)) best = clocked;
+        }
+        
+        // Without clock control the power limit alone is searched at stock clocks
+        if (!job.cancel.load()) {
+            AutoTuneTrial limited = searchPowerLimit(search, best);
+            if (better(limited, best)) best = limited;
+        }
+        
+        for (size_t i = 1; i < memory_clocks.size() && !job.cancel.load(); i++) {
+            std::vector<unsigned int> clocks = monitor.getSupportedGraphicsClocks(gpu_index, memory_clocks[i]);
+            if (clocks.empty()) continue;
+            // Closest supported core clock at or below the chosen one
+            auto it = std::find_if(clocks.begin(), clocks.end(),
+                                   [&](unsigned int clock) { return best.core_clock == 0 || clock <= best.core_clock; });
+            AutoTuneTrial candidate = best;
+            candidate.memory_clock = memory_clocks[i];
+            candidate.core_clock = it != clocks.end() ? *it : clocks.back();
+            candidate = evaluate(search, candidate);
+            if (better(candidate, best)) best = candidate;
+        }
+        
+        restoreStock(search);
+        search.kernel.close();
+        
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.result.best = best;
+            job.result.has_best = true;
+            job.result.complete = !job.cancel.load();
+            char status[128];
+            if (job.result.complete) {
+                snprintf(status, sizeof(status), "Done: %.1f GFLOPS/W (stock %.1f) after %zu trials",
+                         best.perf_per_watt, baseline.perf_per_watt, job.result.trials.size());
+            } else {
+                snprintf(status, sizeof(status), "Cancelled after %zu trials; stock settings restored",
+                         job.result.trials.size());
+            }
+            job.status = status;
+            job.version++;
+        }
+        job.running = false;
+    }
+    
+    void joinFinished() {
+        for (auto& job : jobs) {
+            if (job && !job->running && job->thread.joinable()) job->thread.join();
+        }
+    }
+    
+public:
+    AutoTuner(GPUMonitor& monitor) : monitor(monitor) {}
+    
+    ~AutoTuner() {
+        cancelAll();
+        for (auto& job : jobs) {
+            if (job && job->thread.joinable()) job->thread.join();
+        }
+    }
+    
+    AutoTuner(const AutoTuner&) = delete;
+    AutoTuner& operator=(const AutoTuner&) = delete;
+    
+    // Starts a search on gpu_index; false if one is already running there.
+    // The GPU is loaded to 100% and its clocks and power limit change while it
+    // runs; GPUMonitor::detectGPUs() must not be called until it finishes.
+    bool start(size_t gpu_index, const AutoTuneOptions& options) {
+        if (gpu_index >= monitor.deviceCount()) return false;
+        joinFinished();
+        if (jobs.size() <= gpu_index) jobs.resize(gpu_index + 1);
+        if (!jobs[gpu_index]) jobs[gpu_index].reset(new Job());
+        
+        Job& job = *jobs[gpu_index];
+        if (job.running) return false;
+        if (job.thread.joinable()) job.thread.join();
+        
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.result = AutoTuneResult();
+            job.status = "Starting";
+            job.version++;
+        }
+        job.cancel = false;
+        job.running = true;
+        job.thread = std::thread(&AutoTuner::runSearch, this, std::ref(job), gpu_index, options);
+        return true;
+    }
+    
+    void cancel(size_t gpu_index) {
+        if (gpu_index < jobs.size() && jobs[gpu_index]) jobs[gpu_index]->cancel = true;
+    }
+    
+    void cancelAll() {
+        for (auto& job : jobs) {
+            if (job) job->cancel = true;
+        }
+    }
+    
+    // Blocks until every search has finished
+    void wait() {
+        for (auto& job : jobs) {
+            if (job && job->thread.joinable()) job->thread.join();
+        }
+    }
+    
+    bool isRunning(size_t gpu_index) const {
+        return gpu_index < jobs.size() && jobs[gpu_index] && jobs[gpu_index]->running;
+    }
+    
+    bool isAnyRunning() const {
+        for (const auto& job : jobs) {
+            if (job && job->running) return true;
+        }
+        return false;
+    }
+    
+    bool hasResult(size_t gpu_index) const {
+        return gpu_index < jobs.size() && jobs[gpu_index];
+    }
+    
+    AutoTuneResult getResult(size_t gpu_index) const {
+        if (!hasResult(gpu_index)) return AutoTuneResult();
+        std::lock_guard<std::mutex> lock(jobs[gpu_index]->mutex);
+        return jobs[gpu_index]->result;
+    }
+    
+    std::string getStatus(size_t gpu_index) const {
+        if (!hasResult(gpu_index)) return "";
+        std::lock_guard<std::mutex> lock(jobs[gpu_index]->mutex);
+        return jobs[gpu_index]->status;
+    }
+    
+    // Copies result and status only when they changed since `version` (0 if no
+    // search ever ran), so a UI can poll every frame without copying. Returns
+    // true and updates version when it copied.
+    bool copyIfChanged(size_t gpu_index, uint64_t& version, AutoTuneResult& result, std::string& status) const {
+        if (!hasResult(gpu_index)) {
+            if (version == 0) return false;
+            result = AutoTuneResult();
+            status.clear();
+            version = 0;
+            return true;
+        }
+        const Job& job = *jobs[gpu_index];
+        std::lock_guard<std::mutex> lock(job.mutex);
+        if (job.version == version) return false;
+        result = job.result;
+        status = job.status;
+        version = job.version;
+        return true;
+    }
+};
@@ -0,0 +1,269 @@
+// Microbenchmarks for the monitoring core, run against the mock NVML backend
+// so the numbers are reproducible without NVIDIA hardware. For each device
+// count it measures a full sampler sweep, the UI's per-frame snapshot merge,
+// snapshot publish + read, history appends, the SoA node summary and
+// exporter serialization.
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+#include "mock_nvml.h"
+#include "gpu_monitor.h"
+#include "metrics_exporter.h"
+#include "latency_histogram.h"
+#include "metric_store.h"
+
+static constexpr unsigned int kBenchHistoryLimit = 64; // History stores of the history_append benchmark
+
+struct BenchOptions {
+    std::vector<unsigned int> gpu_counts{1, 8, 64, 1024};
+    double call_latency_us = 10.0;  // Simulated cost of each device query
+    unsigned int processes_per_gpu = 2;
+    int sample_interval_ms = 20;    // Every metric group, while measuring sweeps
+    double sweep_seconds = 2.0;     // Sampler run time per device count
+    double micro_seconds = 0.5;     // Minimum run time per microbenchmark
+    bool csv = false;
+};
+
+class BenchApp {
+private:
+    BenchOptions options;
+    
+    // Runs fn until at least min_seconds and 10 iterations have passed, timing each call
+    template <typename Fn>
+    static void runTimed(LatencyHistogram& histogram, double min_seconds, Fn&& fn) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(min_seconds);
+        uint64_t iterations = 0;
+        while (iterations < 10 || std::chrono::steady_clock::now() < deadline) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            histogram.recordSince(start);
+            iterations++;
+        }
+    }
+    
+    static void formatDuration(uint64_t ns, char* out, size_t size) {
+        if (ns < 1000) {
+            std::snprintf(out, size, "%llu ns", (unsigned long long)ns);
+        } else if (ns < 1000000) {
+            std::snprintf(out, size, "%.1f us", ns / 1e3);
+        } else {
+            std::snprintf(out, size, "%.2f ms", ns / 1e6);
+        }
+    }
+    
+    void printHeader() {
+        if (options.csv) {
+            std::cout << "gpus,benchmark,count,mean_ns,p50_ns,p99_ns,max_ns,note" << std::endl;
+        } else {
+            std::printf("%-6s %-24s %10s %12s %12s %12s %12s  %s\n", "GPUs", "Benchmark", "Count", "Mean", "p50", "p99",
+                        "Max", "Note");
+        }
+    }
+    
+    void printResult(unsigned int gpu_count, const char* name, const LatencyHistogram& histogram, const char* note) {
+        LatencyHistogram::Summary summary = histogram.summarize();
+        uint64_t mean_ns = summary.count ? summary.sum_ns / summary.count : 0;
+        if (options.csv) {
+            std::printf("%u,%s,%llu,%llu,%llu,%llu,%llu,%s\n", gpu_count, name, (unsigned long long)summary.count,
+                        (unsigned long long)mean_ns, (unsigned long long)summary.p50_ns,
+                        (unsigned long long)summary.p99_ns, (unsigned long long)summary.max_ns, note);
+        } else {
+            char mean[32], p50[32], p99[32], max[32];
+            formatDuration(mean_ns, mean, sizeof(mean));
+            formatDuration(summary.p50_ns, p50, sizeof(p50));
+            formatDuration(summary.p99_ns, p99, sizeof(p99));
+            formatDuration(summary.max_ns, max, sizeof(max));
+            std::printf("%-6u %-24s %10llu %12s %12s %12s %12s  %s\n", gpu_count, name, (unsigned long long)summary.count,
+                        mean, p50, p99, max, note);
+        }
+        std::fflush(stdout);
+    }
+    
+    static double perSecond(const LatencyHistogram& histogram, double items_per_call) {
+        LatencyHistogram::Summary summary = histogram.summarize();
+        return summary.sum_ns ? items_per_call * summary.count * 1e9 / summary.sum_ns : 0.0;
+    }
+    
+#ifdef GPUTUNE_HAVE_NVML
+    void runDeviceCount(unsigned int gpu_count) {
+        mockNvmlConfig().device_count = gpu_count;
+        GPUMonitor monitor;
+        if (monitor.getGPUs().size() != gpu_count) {
+            std::cerr << "Mock backend reported " << monitor.getGPUs().size() << " GPUs, expected " << gpu_count << std::endl;
+            return;
+        }
+        char note[96];
+        
+        // Sampler sweeps at a fixed cadence, while this thread merges snapshots
+        // like the UI does once per frame
+        for (int i = 0; i < kMetricGroupCount; i++) {
+            monitor.setSampleInterval(static_cast<MetricGroup>(i), std::chrono::milliseconds(options.sample_interval_ms));
+        }
+        monitor.sweepLatency().reset();
+        LatencyHistogram merge_latency;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(options.sweep_seconds);
+        while (std::chrono::steady_clock::now() < deadline) {
+            auto start = std::chrono::steady_clock::now();
+            if (monitor.pollSnapshot()) merge_latency.recordSince(start);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        monitor.stopSampler(); // Keep it off the CPU for the microbenchmarks
+        
+        // The simulated latency busy-waits, so sweeps can only scale with the cores available
+        std::snprintf(note, sizeof(note), "%.1f us/call simulated, %d ms interval, %u cores", options.call_latency_us,
+                      options.sample_interval_ms, std::max(1u, std::thread::hardware_concurrency()));
+        printResult(gpu_count, "sampler_sweep", monitor.sweepLatency(), note);
+        printResult(gpu_count, "frame_snapshot_merge", merge_latency, "pollSnapshot() with new data");
+        
+        MonitorSnapshot snapshot;
+        snapshot.gpus = monitor.getGPUs();
+        snapshot.version = 1;
+        
+        LatencyHistogram publish_latency;
+        SnapshotBuffer buffer;
+        runTimed(publish_latency, options.micro_seconds, [&] {
+            buffer.writeBuffer() = snapshot;
+            buffer.publish();
+            buffer.fetch();
+        });
+        printResult(gpu_count, "snapshot_publish_read", publish_latency, "copy in, publish, fetch");
+        
+        // A GPUHistory is a few MB, and the monitor already holds one per GPU, so
+        // the GPUs' appends are spread over a bounded set of stores
+        std::vector<std::unique_ptr<GPUHistory>> histories;
+        for (unsigned int i = 0; i < std::min(gpu_count, kBenchHistoryLimit); i++) {
+            histories.emplace_back(new GPUHistory());
+        }
+        LatencyHistogram append_latency;
+        int64_t timestamp_us = wallClockMicros();
+        runTimed(append_latency, options.micro_seconds, [&] {
+            timestamp_us += 1000;
+            for (unsigned int i = 0; i < gpu_count; i++) {
+                GPUHistory& history = *histories[i % histories.size()];
+                for (int metric = 0; metric < kHistoryMetricCount; metric++) {
+                    history.metrics[metric].append(timestamp_us, static_cast<float>(metric));
+                }
+            }
+        });
+        std::snprintf(note, sizeof(note), "%.1fM appends/s", perSecond(append_latency, 1.0 * gpu_count * kHistoryMetricCount) / 1e6);
+        printResult(gpu_count, "history_append", append_latency, note);
+        
+        MetricStore store;
+        MetricSummary summary;
+        LatencyHistogram summary_latency;
+        runTimed(summary_latency, options.micro_seconds, [&] {
+            store.assign(snapshot.gpus);
+            store.summarize(summary);
+        });
+        printResult(gpu_count, "metric_summary", summary_latency, "SoA transpose + totals, p95, top 5");
+        
+        MetricsExporter exporter(monitor);
+        LatencyHistogram export_latency;
+        size_t body_size = 0;
+        runTimed(export_latency, options.micro_seconds, [&] { body_size = exporter.renderBody(snapshot).size(); });
+        std::snprintf(note, sizeof(note), "%.1f KB body, %.1f MB/s", body_size / 1024.0,
+                      perSecond(export_latency, static_cast<double>(body_size)) / 1e6);
+        printResult(gpu_count, "exporter_render", export_latency, note);
+    }
+#endif
+    
+public:
+    explicit BenchApp(const BenchOptions& opts) : options(opts) {}
+    
+    int run() {
+#ifdef GPUTUNE_HAVE_NVML
+        mockNvmlConfig().call_latency_ns = static_cast<unsigned int>(options.call_latency_us * 1000.0);
+        mockNvmlConfig().processes_per_gpu = options.processes_per_gpu;
+        if (!MockNvml::install()) {
+            std::cerr << "Failed to install the mock NVML backend" << std::endl;
+            return 1;
+        }
+        
+        printHeader();
+        for (unsigned int gpu_count : options.gpu_counts) {
+            runDeviceCount(gpu_count);
+        }
+        return 0;
+#else
+        std::cerr << "Benchmarks need the NVML backend (Linux or Windows)" << std::endl;
+        return 1;
+#endif
+    }
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --gpus <list>     Comma-separated device counts (default 1,8,64,1024)\n"
+              << "  --call-latency-us <us>   Simulated latency of each NVML device query (default 10)\n"
+              << "  --processes <n>   Compute processes per simulated GPU (default 2)\n"
+              << "  --interval <ms>   Sampling interval of every metric group (default 20)\n"
+              << "  --sweep-seconds <s>      How long to run the sampler per device count (default 2)\n"
+              << "  --micro-seconds <s>      Minimum run time of each microbenchmark (default 0.5)\n"
+              << "  --csv             Print results as CSV\n"
+              << "  --help            Show this help\n";
+}
+
+static bool parseGPUCounts(const char* list, std::vector<unsigned int>& counts) {
+    counts.clear();
+    const char* cursor = list;
+    while (*cursor) {
+        char* end;
+        long count = std::strtol(cursor, &end, 10);
+        if (end == cursor || count <= 0) return false;
+        counts.push_back(static_cast<unsigned int>(count));
+        cursor = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return false;
+    }
+    return !counts.empty();
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        
+        if (std::strcmp(arg, "--gpus") == 0 && has_value) {
+            if (!parseGPUCounts(argv[++i], options.gpu_counts)) return false;
+        } else if (std::strcmp(arg, "--call-latency-us") == 0 && has_value) {
+            options.call_latency_us = std::max(0.0, std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--processes") == 0 && has_value) {
+            options.processes_per_gpu = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        } else if (std::strcmp(arg, "--interval") == 0 && has_value) {
+            options.sample_interval_ms = std::max(10, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--sweep-seconds") == 0 && has_value) {
+            options.sweep_seconds = std::max(0.1, std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--micro-seconds") == 0 && has_value) {
+            options.micro_seconds = std::max(0.01, std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--csv") == 0) {
+            options.csv = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Entry point
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return argc > 1 && std::strcmp(argv[1], "--help") == 0 ? 0 : 2;
+    }
+    
+    try {
+        BenchApp app(options);
+        return app.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Little helpers shared by gputune's binary formats: LEB128 varints, zigzag
+// for signed deltas, and fixed-width little-endian fields. Writers append to a
+// byte vector; readers advance a cursor and return false on truncated input
+// instead of reading past the end.
+
+inline uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void appendVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline void appendSignedVarint(std::vector<uint8_t>& out, int64_t value) {
+    appendVarint(out, zigzagEncode(value));
+}
+
+inline void appendString(std::vector<uint8_t>& out, const std::string& value) {
+    appendVarint(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+template <typename T>
+inline void appendFixed(std::vector<uint8_t>& out, T value) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T)); // All supported targets are little-endian
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+class ByteReader {
+private:
+    const uint8_t* cursor;
+    const uint8_t* end;
+    
+public:
+    ByteReader(const uint8_t* data, size_t size) : cursor(data), end(data + size) {}
+    
+    size_t remaining() const { return static_cast<size_t>(end - cursor); }
+    const uint8_t* position() const { return cursor; }
+    
+    bool skip(size_t count) {
+        if (count > remaining()) return false;
+        cursor += count;
+        return true;
+    }
+    
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (cursor == end) return false;
+            uint8_t byte = *cursor++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false; // More than 10 bytes: corrupt
+    }
+    
+    bool readSignedVarint(int64_t& value) {
+        uint64_t raw;
+        if (!readVarint(raw)) return false;
+        value = zigzagDecode(raw);
+        return true;
+    }
+    
+    bool readString(std::string& value) {
+        uint64_t length;
+        if (!readVarint(length) || length > remaining()) return false;
+        value.assign(reinterpret_cast<const char*>(cursor), static_cast<size_t>(length));
+        cursor += length;
+        return true;
+    }
+    
+    template <typename T>
+    bool readFixed(T& value) {
+        if (sizeof(T) > remaining()) return false;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+};
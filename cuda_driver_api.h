@@ -0,0 +1,150 @@
+#pragma once
+
+// Runtime-loaded CUDA driver API, for the built-in stress kernel. Like NVML it
+// is resolved from the driver (libcuda.so.1 / nvcuda.dll) on first use, so
+// neither the CUDA toolkit nor its headers are needed to build gputune; the
+// handful of types and entry points used are declared here.
+
+#if defined(_WIN32) || defined(__linux__)
+    #define GPUTUNE_HAVE_CUDA_DRIVER 1
+#endif
+
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+    #define GPUTUNE_CUDA_API __stdcall
+#else
+    #include <dlfcn.h>
+    #define GPUTUNE_CUDA_API
+#endif
+
+typedef int CUresult;
+typedef int CUdevice;
+typedef struct CUctx_st* CUcontext;
+typedef struct CUmod_st* CUmodule;
+typedef struct CUfunc_st* CUfunction;
+typedef struct CUstream_st* CUstream;
+typedef unsigned long long CUdeviceptr;
+
+static constexpr CUresult CUDA_SUCCESS = 0;
+static constexpr int CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT = 16;
+
+// X(member, exported symbol, parameter list); every entry point returns CUresult
+#define GPUTUNE_CUDA_FUNCTIONS(X) \
+    X(Init, cuInit, (unsigned int flags)) \
+    X(GetErrorString, cuGetErrorString, (CUresult error, const char** message)) \
+    X(DeviceGetCount, cuDeviceGetCount, (int* count)) \
+    X(DeviceGet, cuDeviceGet, (CUdevice* device, int ordinal)) \
+    X(DeviceGetPCIBusId, cuDeviceGetPCIBusId, (char* bus_id, int length, CUdevice device)) \
+    X(DeviceGetAttribute, cuDeviceGetAttribute, (int* value, int attribute, CUdevice device)) \
+    X(CtxCreate, cuCtxCreate_v2, (CUcontext* context, unsigned int flags, CUdevice device)) \
+    X(CtxDestroy, cuCtxDestroy_v2, (CUcontext context)) \
+    X(CtxSetCurrent, cuCtxSetCurrent, (CUcontext context)) \
+    X(CtxSynchronize, cuCtxSynchronize, ()) \
+    X(ModuleLoadData, cuModuleLoadData, (CUmodule* module, const void* image)) \
+    X(ModuleUnload, cuModuleUnload, (CUmodule module)) \
+    X(ModuleGetFunction, cuModuleGetFunction, (CUfunction* function, CUmodule module, const char* name)) \
+    X(MemAlloc, cuMemAlloc_v2, (CUdeviceptr* pointer, size_t bytes)) \
+    X(MemFree, cuMemFree_v2, (CUdeviceptr pointer)) \
+    X(MemcpyDtoH, cuMemcpyDtoH_v2, (void* host, CUdeviceptr device, size_t bytes)) \
+    X(LaunchKernel, cuLaunchKernel, (CUfunction function, unsigned int grid_x, unsigned int grid_y, \
+                                     unsigned int grid_z, unsigned int block_x, unsigned int block_y, \
+                                     unsigned int block_z, unsigned int shared_bytes, CUstream stream, \
+                                     void** params, void** extra))
+
+class CudaDriverApi {
+private:
+    std::mutex load_mutex;
+    bool load_attempted = false;
+    bool loaded = false;
+#ifdef _WIN32
+    HMODULE library = nullptr;
+#else
+    void* library = nullptr;
+#endif
+    
+    void* resolve(const char* symbol) {
+#ifdef _WIN32
+        return reinterpret_cast<void*>(GetProcAddress(library, symbol));
+#else
+        return dlsym(library, symbol);
+#endif
+    }
+    
+public:
+#define GPUTUNE_CUDA_DECLARE(member, symbol, params) CUresult (GPUTUNE_CUDA_API *member) params = nullptr;
+    GPUTUNE_CUDA_FUNCTIONS(GPUTUNE_CUDA_DECLARE)
+#undef GPUTUNE_CUDA_DECLARE
+    
+    ~CudaDriverApi() {
+#ifdef _WIN32
+        if (library) FreeLibrary(library);
+#else
+        if (library) dlclose(library);
+#endif
+    }
+    
+    // Loads the driver library and calls cuInit on first use; later calls return the cached result
+    bool load() {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (load_attempted) return loaded;
+        load_attempted = true;
+
+#ifdef _WIN32
+        library = LoadLibraryA("nvcuda.dll");
+#else
+        library = dlopen("libcuda.so.1", RTLD_NOW | RTLD_LOCAL);
+        if (!library) {
+            library = dlopen("libcuda.so", RTLD_NOW | RTLD_LOCAL);
+        }
+#endif
+        if (!library) {
+            std::cout << "CUDA driver library not found" << std::endl;
+            return false;
+        }
+        
+        bool complete = true;
+#define GPUTUNE_CUDA_RESOLVE(member, symbol, params) \
+        member = reinterpret_cast<decltype(member)>(resolve(#symbol)); \
+        if (!member) { \
+            std::cout << "CUDA driver is missing " #symbol << std::endl; \
+            complete = false; \
+        }
+        GPUTUNE_CUDA_FUNCTIONS(GPUTUNE_CUDA_RESOLVE)
+#undef GPUTUNE_CUDA_RESOLVE
+        
+        if (!complete || Init(0) != CUDA_SUCCESS) {
+            std::cout << "CUDA driver API unavailable" << std::endl;
+            return false;
+        }
+        loaded = true;
+        return true;
+    }
+    
+    bool isLoaded() const { return loaded; }
+    
+    const char* errorString(CUresult result) {
+        const char* message = nullptr;
+        if (GetErrorString && GetErrorString(result, &message) == CUDA_SUCCESS && message) return message;
+        return "unknown CUDA error";
+    }
+};
+
+// Process-wide table, loaded lazily by the first stress kernel
+inline CudaDriverApi& cudaDriverApi() {
+    static CudaDriverApi api;
+    return api;
+}
+
+#endif // GPUTUNE_HAVE_CUDA_DRIVER
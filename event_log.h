@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Clock throttle reasons, as NVML reports them (nvmlClocksThrottleReason*)
+static constexpr uint32_t kThrottleGpuIdle = 0x1;
+static constexpr uint32_t kThrottleApplicationsClocks = 0x2;
+static constexpr uint32_t kThrottleSwPowerCap = 0x4;
+static constexpr uint32_t kThrottleHwSlowdown = 0x8;
+static constexpr uint32_t kThrottleSyncBoost = 0x10;
+static constexpr uint32_t kThrottleSwThermal = 0x20;
+static constexpr uint32_t kThrottleHwThermal = 0x40;
+static constexpr uint32_t kThrottleHwPowerBrake = 0x80;
+static constexpr uint32_t kThrottleDisplayClocks = 0x100;
+
+// Reasons that actually cost performance; idle and the user's own clock settings don't
+static constexpr uint32_t kThrottleLimitingMask = kThrottleSwPowerCap | kThrottleHwSlowdown | kThrottleSyncBoost |
+    kThrottleSwThermal | kThrottleHwThermal | kThrottleHwPowerBrake;
+
+// Comma-separated names of the limiting reasons in mask ("" if none)
+inline void formatThrottleReasons(uint32_t mask, char* out, size_t size) {
+    static const struct { uint32_t bit; const char* name; } kNames[] = {
+        {kThrottleSwPowerCap, "Power cap"},
+        {kThrottleSwThermal, "Thermal"},
+        {kThrottleHwThermal, "HW thermal"},
+        {kThrottleHwSlowdown, "HW slowdown"},
+        {kThrottleHwPowerBrake, "Power brake"},
+        {kThrottleSyncBoost, "Sync boost"},
+    };
+    size_t used = 0;
+    out[0] = '\0';
+    for (const auto& entry : kNames) {
+        if (!(mask & entry.bit) || used >= size) continue;
+        int written = std::snprintf(out + used, size - used, "%s%s", used > 0 ? ", " : "", entry.name);
+        if (written > 0) used = std::min(size - 1, used + static_cast<size_t>(written));
+    }
+}
+
+enum class GPUEventKind : uint8_t {
+    Throttle,     // data: the new throttle reason mask
+    XidError,     // data: XID code
+    EccSingleBit, // Corrected memory error
+    EccDoubleBit, // Uncorrectable memory error
+    Alert,        // data: alert rule id, with kAlertClearedBit set when it stopped firing
+};
+
+static constexpr uint32_t kAlertClearedBit = 0x80000000u;
+
+inline const char* gpuEventKindName(GPUEventKind kind) {
+    switch (kind) {
+        case GPUEventKind::Throttle: return "Throttle";
+        case GPUEventKind::XidError: return "XID error";
+        case GPUEventKind::EccSingleBit: return "ECC corrected";
+        case GPUEventKind::EccDoubleBit: return "ECC uncorrectable";
+        case GPUEventKind::Alert: return "Alert";
+        default: return "Unknown";
+    }
+}
+
+// 24 bytes per event, so a full log is 96 KB
+struct GPUEvent {
+    int64_t timestamp_us = 0; // wallClockMicros() timebase, like MetricHistory
+    uint16_t gpu_index = 0;
+    GPUEventKind kind = GPUEventKind::Throttle;
+    uint8_t reserved = 0;
+    uint32_t data = 0;
+    uint64_t sequence = 0;    // Assigned by GPUEventLog in arrival order, starting at 1
+};
+
+static_assert(sizeof(GPUEvent) == 24, "GPUEvent grew; update the size above");
+
+// One-line description, e.g. "Throttled: Power cap, Thermal" or "XID 79"
+inline void formatGPUEvent(const GPUEvent& event, char* out, size_t size) {
+    switch (event.kind) {
+        case GPUEventKind::Throttle: {
+            if (event.data == 0) {
+                std::snprintf(out, size, "Throttling cleared");
+                break;
+            }
+            char reasons[96];
+            formatThrottleReasons(event.data, reasons, sizeof(reasons));
+            std::snprintf(out, size, "Throttled: %s", reasons);
+            break;
+        }
+        case GPUEventKind::XidError:
+            std::snprintf(out, size, "XID %u", event.data);
+            break;
+        case GPUEventKind::Alert: // AlertEngine::describe() has the rule's text
+            std::snprintf(out, size, "%s rule %u", event.data & kAlertClearedBit ? "Cleared" : "Alert",
+                          event.data & ~kAlertClearedBit);
+            break;
+        default:
+            std::snprintf(out, size, "%s", gpuEventKindName(event.kind));
+            break;
+    }
+}
+
+// Time-ordered ring of rare device events: throttle reason transitions from
+// the sampler's workers, XID/ECC events from the NVML event thread. Appends are
+// infrequent, so one mutex covers both writers and the readers.
+class GPUEventLog {
+public:
+    static constexpr size_t kCapacity = 4096;
+    
+private:
+    mutable std::mutex mutex;
+    std::vector<GPUEvent> ring; // Guarded by mutex; kCapacity slots once full
+    size_t head = 0;            // Guarded by mutex; next slot to overwrite once full
+    std::vector<uint32_t> throttle_state; // Last mask logged per GPU, guarded by mutex
+    std::atomic<uint64_t> version{0};
+    uint64_t last_sequence = 0; // Guarded by mutex
+    
+    size_t size() const { return ring.size(); }
+    const GPUEvent& at(size_t i) const { return ring[(head + i) % ring.size()]; } // 0 = oldest
+    GPUEvent& at(size_t i) { return ring[(head + i) % ring.size()]; }
+    
+    // Caller holds mutex. Events from different threads can arrive slightly out
+    // of order, so the new one is bubbled back to its place.
+    void insert(GPUEvent event) {
+        event.sequence = ++last_sequence;
+        if (ring.size() < kCapacity) {
+            ring.push_back(event);
+        } else {
+            ring[head] = event;
+            head = (head + 1) % kCapacity;
+        }
+        for (size_t i = size() - 1; i > 0 && at(i - 1).timestamp_us > at(i).timestamp_us; i--) {
+            std::swap(at(i - 1), at(i));
+        }
+        version.fetch_add(1, std::memory_order_release);
+    }
+    
+public:
+    GPUEventLog() { ring.reserve(kCapacity); }
+    
+    void append(const GPUEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        insert(event);
+    }
+    
+    // Logs a throttle event only when the GPU's reason mask differs from the last one logged
+    void recordThrottle(size_t gpu_index, int64_t timestamp_us, uint32_t mask) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (throttle_state.size() <= gpu_index) throttle_state.resize(gpu_index + 1, 0);
+        if (throttle_state[gpu_index] == mask) return;
+        throttle_state[gpu_index] = mask;
+        
+        GPUEvent event;
+        event.timestamp_us = timestamp_us;
+        event.gpu_index = static_cast<uint16_t>(gpu_index);
+        event.kind = GPUEventKind::Throttle;
+        event.data = mask;
+        insert(event);
+    }
+    
+    // Bumped on every append, so readers can skip copying when nothing happened
+    uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
+    
+    // Copies, oldest first, the events newer than since_us
+    void copySince(int64_t since_us, std::vector<GPUEvent>& out) const {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t low = 0;
+        size_t high = size();
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (at(mid).timestamp_us > since_us) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        for (size_t i = low; i < size(); i++) {
+            out.push_back(at(i));
+        }
+    }
+    
+    // Copies, oldest first, the events that arrived after the one numbered
+    // after_sequence. Unlike copySince this misses neither events sharing a
+    // timestamp nor late ones bubbled back behind the last seen.
+    void copyAfter(uint64_t after_sequence, std::vector<GPUEvent>& out) const {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < size(); i++) {
+            if (at(i).sequence > after_sequence) out.push_back(at(i));
+        }
+    }
+    
+    // Follows a change of device set: old_to_new[i] is GPU i's new index, or -1
+    // if it is gone, in which case its events are dropped
+    void remapGPUs(const std::vector<int>& old_to_new) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<GPUEvent> kept;
+        kept.reserve(kCapacity);
+        for (size_t i = 0; i < size(); i++) {
+            GPUEvent event = at(i);
+            if (event.gpu_index >= old_to_new.size() || old_to_new[event.gpu_index] < 0) continue;
+            event.gpu_index = static_cast<uint16_t>(old_to_new[event.gpu_index]);
+            kept.push_back(event);
+        }
+        ring.swap(kept);
+        head = 0;
+        
+        std::vector<uint32_t> remapped_state;
+        for (size_t i = 0; i < throttle_state.size() && i < old_to_new.size(); i++) {
+            if (old_to_new[i] < 0) continue;
+            size_t index = static_cast<size_t>(old_to_new[i]);
+            if (remapped_state.size() <= index) remapped_state.resize(index + 1, 0);
+            remapped_state[index] = throttle_state[i];
+        }
+        throttle_state.swap(remapped_state);
+        version.fetch_add(1, std::memory_order_release);
+    }
+    
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ring.clear();
+        head = 0;
+        throttle_state.clear();
+        version.fetch_add(1, std::memory_order_release);
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// Fan curve control: GPUInfo::target_fan_curve holds the fan speed (%) at each of
+// these temperatures. Pure logic here; GPUMonitor runs it on the sampler side
+// and does the NVML calls.
+static constexpr int kFanCurvePoints = 5;
+static const int kFanCurveTemperatures[kFanCurvePoints] = {30, 50, 65, 75, 85}; // °C
+
+// Piecewise-linear fan speed (%) for temperature_c, flat beyond the end points
+inline float evaluateFanCurve(const int curve[kFanCurvePoints], float temperature_c) {
+    if (temperature_c <= kFanCurveTemperatures[0]) return static_cast<float>(curve[0]);
+    for (int i = 1; i < kFanCurvePoints; i++) {
+        if (temperature_c <= kFanCurveTemperatures[i]) {
+            float t = (temperature_c - kFanCurveTemperatures[i - 1]) /
+                      static_cast<float>(kFanCurveTemperatures[i] - kFanCurveTemperatures[i - 1]);
+            return curve[i - 1] + t * (curve[i] - curve[i - 1]);
+        }
+    }
+    return static_cast<float>(curve[kFanCurvePoints - 1]);
+}
+
+// What the UI asked for, handed to the controller under a lock
+struct FanCurveSettings {
+    bool enabled = false;
+    int curve[kFanCurvePoints] = {30, 40, 50, 70, 85};
+};
+
+// Per-device closed loop. Temperature rises are followed at once (only the fan
+// ramp is rate limited, and ramping up is fast), but the fan slows down only
+// after the temperature has fallen kHysteresisC below the level that set the
+// current speed, so a load that pulses around a curve point doesn't make the
+// fan hunt.
+class FanCurveController {
+public:
+    static constexpr float kHysteresisC = 3.0f;
+    static constexpr float kRampUpPerSecond = 30.0f;  // % per second
+    static constexpr float kRampDownPerSecond = 5.0f;
+    
+private:
+    float control_temperature = 0.0f;
+    float commanded = -1.0f; // < 0 until the first step
+    int applied = -1;        // Last speed sent to the driver, -1 = none
+    
+public:
+    void reset() {
+        control_temperature = 0.0f;
+        commanded = -1.0f;
+        applied = -1;
+    }
+    
+    // Returns the fan speed (%) to command after elapsed_seconds at temperature_c
+    int step(const int curve[kFanCurvePoints], float temperature_c, float elapsed_seconds) {
+        if (commanded < 0.0f || temperature_c >= control_temperature ||
+            temperature_c <= control_temperature - kHysteresisC) {
+            control_temperature = temperature_c;
+        }
+        float target = std::max(0.0f, std::min(100.0f, evaluateFanCurve(curve, control_temperature)));
+        
+        if (commanded < 0.0f) {
+            commanded = target; // Start at the curve rather than ramping from zero
+        } else if (target > commanded) {
+            commanded = std::min(target, commanded + kRampUpPerSecond * elapsed_seconds);
+        } else {
+            commanded = std::max(target, commanded - kRampDownPerSecond * elapsed_seconds);
+        }
+        return static_cast<int>(std::lround(commanded));
+    }
+    
+    // Only changed speeds need to reach the driver
+    bool needsApply(int speed) const { return speed != applied; }
+    void markApplied(int speed) { applied = speed; }
+    bool isDriving() const { return applied >= 0; }
+};
@@ -0,0 +1,763 @@
+#pragma once
+
+// Fleet mode: headless agents stream their GPUMonitor snapshots to collectors
+// (the GUI) over persistent TCP connections, so one console can watch many
+// nodes. Agents listen; a collector connects to any number of agents.
+//
+// Stream layout: a sequence of frames, each a fixed u32 payload length, a u8
+// frame type and a payload of binary_codec varints:
+//   Hello   - first frame: "GPUFLEET", protocol version, hostname, field count
+//   Devices - device generation, then uuid, name, driver version, bus ID and
+//             NVIDIA flag per device. Resets that agent's values to zero.
+//   Update  - agent wall time, number of changed devices, then per device its
+//             index, a change mask (one bit per kTraceFields column, then one
+//             that toggles the stale flag) and a zigzag delta per set column.
+// Once per interval an agent sends one Update with only what changed since the
+// previous one, conflating any sweeps in between, and the same bytes go to
+// every collector; a new collector first gets Devices and a keyframe (an
+// Update against zero). An Update with no devices doubles as the heartbeat.
+// Unknown frame types are skipped and an agent's extra columns are ignored,
+// so either side can be upgraded first.
+
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include "gpu_monitor.h"
+#include "binary_codec.h"
+#include "trace_file.h"
+#include "net_socket.h"
+
+static const char kFleetMagic[8] = {'G', 'P', 'U', 'F', 'L', 'E', 'E', 'T'};
+static constexpr uint32_t kFleetProtocolVersion = 1;
+static constexpr uint32_t kFleetMaxFrameBytes = 16u << 20;
+static constexpr uint32_t kFleetMaxDevices = 4096; // Per agent
+static constexpr int kFleetHeartbeatMs = 1000;
+static constexpr int kFleetTimeoutMs = 5000;       // Collectors drop an agent that is silent this long
+
+enum class FleetFrame : uint8_t {
+    Hello = 1,
+    Devices = 2,
+    Update = 3,
+};
+
+static constexpr size_t kFleetFrameHeaderBytes = sizeof(uint32_t) + 1;
+
+inline size_t beginFleetFrame(std::vector<uint8_t>& out, FleetFrame type) {
+    size_t start = out.size();
+    appendFixed<uint32_t>(out, 0);
+    out.push_back(static_cast<uint8_t>(type));
+    return start;
+}
+
+inline void endFleetFrame(std::vector<uint8_t>& out, size_t start) {
+    uint32_t length = static_cast<uint32_t>(out.size() - start - kFleetFrameHeaderBytes);
+    std::memcpy(out.data() + start, &length, sizeof(length));
+}
+
+inline void appendFleetHello(std::vector<uint8_t>& out, const std::string& hostname) {
+    size_t start = beginFleetFrame(out, FleetFrame::Hello);
+    out.insert(out.end(), kFleetMagic, kFleetMagic + sizeof(kFleetMagic));
+    appendVarint(out, kFleetProtocolVersion);
+    appendString(out, hostname);
+    appendVarint(out, kTraceFieldCount);
+    endFleetFrame(out, start);
+}
+
+inline void appendFleetDevices(std::vector<uint8_t>& out, uint64_t generation, const std::vector<GPUInfo>& gpus) {
+    size_t start = beginFleetFrame(out, FleetFrame::Devices);
+    appendVarint(out, generation);
+    appendVarint(out, gpus.size());
+    for (const GPUInfo& gpu : gpus) {
+        appendString(out, gpu.uuid);
+        appendString(out, gpu.name);
+        appendString(out, gpu.driver_version);
+        appendString(out, gpu.pci_bus_id);
+        out.push_back(gpu.is_nvidia ? 1 : 0);
+    }
+    endFleetFrame(out, start);
+}
+
+// Appends an Update with the fields of current that differ from previous (same size)
+inline void appendFleetUpdate(std::vector<uint8_t>& out, int64_t wall_time_us, const std::vector<GPUInfo>& previous,
+                              const std::vector<GPUInfo>& current, std::vector<uint8_t>& scratch) {
+    scratch.clear();
+    uint64_t changed = 0;
+    for (size_t i = 0; i < current.size(); i++) {
+        const GPUInfo& now = current[i];
+        const GPUInfo& before = previous[i];
+        uint64_t mask = 0;
+        for (uint32_t f = 0; f < kTraceFieldCount; f++) {
+            if (now.*kTraceFields[f].member != before.*kTraceFields[f].member) mask |= 1ull << f;
+        }
+        if (now.stale != before.stale) mask |= 1ull << kTraceFieldCount;
+        if (!mask) continue;
+        
+        appendVarint(scratch, i);
+        appendVarint(scratch, mask);
+        for (uint32_t f = 0; f < kTraceFieldCount; f++) {
+            if (mask & (1ull << f)) {
+                appendSignedVarint(scratch, static_cast<int64_t>(now.*kTraceFields[f].member) - before.*kTraceFields[f].member);
+            }
+        }
+        changed++;
+    }
+    
+    size_t start = beginFleetFrame(out, FleetFrame::Update);
+    appendVarint(out, static_cast<uint64_t>(std::max<int64_t>(0, wall_time_us)));
+    appendVarint(out, changed);
+    out.insert(out.end(), scratch.begin(), scratch.end());
+    endFleetFrame(out, start);
+}
+
+// Agent side: serves this node's snapshots to every connected collector from
+// its own thread. Sockets are non-blocking; a collector that falls too far
+// behind is disconnected and resynchronizes when it reconnects.
+class FleetAgent {
+private:
+    static constexpr size_t kMaxClientBacklog = 8u << 20;
+    static constexpr size_t kMaxClients = 64;
+    
+    struct Client {
+        SocketHandle socket = kInvalidSocket;
+        std::vector<uint8_t> outbox;
+        size_t sent = 0; // Bytes of outbox already written
+    };
+    
+    GPUMonitor& monitor;
+    std::shared_ptr<SnapshotBuffer> snapshots;
+    SocketHandle listen_socket = kInvalidSocket;
+    std::thread server_thread;
+    std::atomic<bool> running{false};
+    std::atomic<size_t> client_count{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    int interval_ms = 500;
+    std::string hostname;
+    
+    // Server thread only
+    std::vector<Client> clients;
+    std::vector<PollDescriptor> descriptors;
+    std::vector<GPUInfo> sent_state; // What every collector in sync has
+    std::vector<GPUInfo> zero_state;
+    uint64_t sent_generation = 0;
+    bool have_state = false;
+    int64_t sent_wall_us = 0;
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> scratch;
+    uint8_t drain_buffer[256];
+    
+    void broadcast() {
+        for (Client& client : clients) {
+            client.outbox.insert(client.outbox.end(), frame.begin(), frame.end());
+        }
+    }
+    
+    // A new collector gets the device table and a keyframe, then shares the deltas
+    void greet(Client& client) {
+        frame.clear();
+        appendFleetHello(frame, hostname);
+        if (have_state) {
+            appendFleetDevices(frame, sent_generation, sent_state);
+            zero_state.assign(sent_state.size(), GPUInfo());
+            appendFleetUpdate(frame, sent_wall_us, zero_state, sent_state, scratch);
+        }
+        client.outbox.insert(client.outbox.end(), frame.begin(), frame.end());
+    }
+    
+    void sendSnapshot(const MonitorSnapshot& snapshot) {
+        frame.clear();
+        if (!have_state || snapshot.generation != sent_generation || snapshot.gpus.size() != sent_state.size()) {
+            appendFleetDevices(frame, snapshot.generation, snapshot.gpus);
+            zero_state.assign(snapshot.gpus.size(), GPUInfo());
+            appendFleetUpdate(frame, snapshot.wall_time_us, zero_state, snapshot.gpus, scratch);
+            sent_generation = snapshot.generation;
+            have_state = true;
+        } else {
+            appendFleetUpdate(frame, snapshot.wall_time_us, sent_state, snapshot.gpus, scratch);
+        }
+        sent_state = snapshot.gpus;
+        sent_wall_us = snapshot.wall_time_us;
+        broadcast();
+    }
+    
+    void sendHeartbeat() {
+        frame.clear();
+        appendFleetUpdate(frame, wallClockMicros(), sent_state, sent_state, scratch);
+        broadcast();
+    }
+    
+    // Writes what the socket takes without blocking; false if the client must go
+    bool flush(Client& client) {
+        while (client.sent < client.outbox.size()) {
+            int sent = sendSome(client.socket, client.outbox.data() + client.sent, client.outbox.size() - client.sent);
+            if (sent < 0) return false;
+            if (sent == 0) break;
+            client.sent += sent;
+            bytes_sent += sent;
+        }
+        if (client.sent == client.outbox.size()) {
+            client.outbox.clear();
+            client.sent = 0;
+        } else if (client.sent >= (64u << 10)) {
+            client.outbox.erase(client.outbox.begin(), client.outbox.begin() + client.sent);
+            client.sent = 0;
+        }
+        return client.outbox.size() - client.sent <= kMaxClientBacklog;
+    }
+    
+    void dropClient(size_t index, const char* reason) {
+        std::cerr << "Fleet collector disconnected: " << reason << std::endl;
+        closeSocket(clients[index].socket);
+        clients[index] = std::move(clients.back());
+        clients.pop_back();
+        client_count = clients.size();
+    }
+    
+    void acceptClient() {
+        SocketHandle socket = accept(listen_socket, nullptr, nullptr);
+        if (socket == kInvalidSocket) return;
+        if (clients.size() >= kMaxClients || !setNonBlocking(socket)) {
+            closeSocket(socket);
+            return;
+        }
+        setNoDelay(socket);
+        clients.emplace_back();
+        clients.back().socket = socket;
+        greet(clients.back());
+        client_count = clients.size();
+        std::cerr << "Fleet collector connected (" << clients.size() << " total)" << std::endl;
+    }
+    
+    void serverLoop() {
+        auto next_tick = std::chrono::steady_clock::now();
+        auto last_send = next_tick;
+        
+        while (running) {
+            descriptors.clear();
+            descriptors.push_back({listen_socket, kPollRead, 0});
+            for (const Client& client : clients) {
+                short events = kPollRead;
+                if (client.sent < client.outbox.size()) events |= kPollWrite;
+                descriptors.push_back({client.socket, events, 0});
+            }
+            
+            // Heartbeats keep their own deadline, so intervals near kFleetTimeoutMs still keep the link up
+            auto now = std::chrono::steady_clock::now();
+            auto heartbeat_due = last_send + std::chrono::milliseconds(kFleetHeartbeatMs);
+            auto wake = std::min(next_tick, heartbeat_due);
+            int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count());
+            pollSockets(descriptors.data(), descriptors.size(), std::max(0, std::min(timeout_ms, interval_ms)));
+            
+            // Collectors never send after connecting: readable means hang-up
+            for (size_t i = clients.size(); i-- > 0;) {
+                short revents = descriptors[i + 1].revents;
+                if (revents & (POLLERR | POLLNVAL)) {
+                    dropClient(i, "socket error");
+                } else if (revents & (kPollRead | POLLHUP)) {
+                    int count;
+                    while ((count = receiveSome(clients[i].socket, drain_buffer, sizeof(drain_buffer))) > 0) {}
+                    if (count < 0) dropClient(i, "closed by peer");
+                }
+            }
+            if (descriptors[0].revents & kPollRead) {
+                acceptClient();
+            }
+            
+            now = std::chrono::steady_clock::now();
+            if (now >= next_tick) {
+                next_tick += std::chrono::milliseconds(interval_ms);
+                if (next_tick < now) next_tick = now + std::chrono::milliseconds(interval_ms);
+                
+                if (snapshots->fetch()) {
+                    sendSnapshot(snapshots->readBuffer());
+                    last_send = now;
+                }
+            }
+            if (now - last_send >= std::chrono::milliseconds(kFleetHeartbeatMs)) {
+                sendHeartbeat();
+                last_send = now;
+            }
+            
+            for (size_t i = clients.size(); i-- > 0;) {
+                if (!flush(clients[i])) dropClient(i, "too far behind or write failed");
+            }
+        }
+    }
+    
+public:
+    explicit FleetAgent(GPUMonitor& gpu_monitor) : monitor(gpu_monitor) {}
+    
+    ~FleetAgent() { stop(); }
+    
+    FleetAgent(const FleetAgent&) = delete;
+    FleetAgent& operator=(const FleetAgent&) = delete;
+    
+    // Sends an update every send_interval_ms (only if the monitor published meanwhile)
+    bool start(const std::string& address, int port, int send_interval_ms) {
+        if (running) return true;
+        if (!startSockets()) return false;
+        
+        listen_socket = listenTcp(address, port, 16);
+        if (listen_socket == kInvalidSocket) {
+            cleanupSockets();
+            return false;
+        }
+        
+        interval_ms = std::max(10, send_interval_ms);
+        hostname = localHostName();
+        have_state = false;
+        snapshots = monitor.subscribeSnapshots();
+        running = true;
+        server_thread = std::thread([this] { serverLoop(); });
+        std::cerr << "Fleet agent listening on " << address << ":" << port << " as " << hostname << std::endl;
+        return true;
+    }
+    
+    void stop() {
+        if (!running) return;
+        running = false;
+        if (server_thread.joinable()) {
+            server_thread.join();
+        }
+        for (Client& client : clients) {
+            closeSocket(client.socket);
+        }
+        clients.clear();
+        client_count = 0;
+        closeSocket(listen_socket);
+        listen_socket = kInvalidSocket;
+        monitor.unsubscribeSnapshots(snapshots);
+        snapshots.reset();
+        cleanupSockets();
+    }
+    
+    bool isRunning() const { return running; }
+    size_t clientCount() const { return client_count; }
+    uint64_t bytesSent() const { return bytes_sent; }
+};
+
+// Collector side: merged view of every agent, published like MonitorSnapshot
+struct FleetNodeStatus {
+    std::string endpoint; // host:port as added
+    std::string hostname; // As reported by the agent
+    std::string status;
+    bool connected = false;
+    size_t gpu_count = 0;
+    int64_t last_update_us = 0; // Local wall clock when the last frame arrived
+    uint64_t bytes_received = 0;
+};
+
+struct FleetDevice {
+    uint32_t node = 0;  // Index into FleetSnapshot::nodes
+    uint32_t index = 0; // GPU index on that node
+    GPUInfo gpu;       // stale is also set while the node is disconnected
+};
+
+struct FleetSnapshot {
+    std::vector<FleetNodeStatus> nodes;
+    std::vector<FleetDevice> devices; // Grouped by node, in agent order
+    uint64_t version = 0;
+};
+
+// Connects to agents and keeps their device tables current on one thread,
+// polling every connection. Lost agents are retried with exponential backoff
+// and keep their last values (marked stale) until they are back.
+class FleetCollector {
+private:
+    static constexpr int kPollMs = 50;
+    static constexpr int kPublishIntervalMs = 100; // Caps merged views at 10/s however many agents stream
+    static constexpr int kConnectTimeoutMs = 5000;
+    static constexpr int kMinRetryMs = 1000;
+    static constexpr int kMaxRetryMs = 30000;
+    static constexpr size_t kReceiveChunk = 64 * 1024;
+    
+    enum class LinkState { Waiting, Connecting, Streaming };
+    
+    struct Connection {
+        std::string endpoint;
+        std::string host;
+        int port = 0;
+        SocketHandle socket = kInvalidSocket;
+        LinkState state = LinkState::Waiting;
+        std::chrono::steady_clock::time_point next_attempt;
+        std::chrono::steady_clock::time_point last_activity; // Connect start or last frame
+        int retry_ms = kMinRetryMs;
+        
+        std::vector<uint8_t> inbox;
+        size_t consumed = 0;
+        bool greeted = false;
+        uint32_t field_count = 0;
+        
+        std::string hostname;
+        std::string status = "Connecting";
+        std::vector<GPUInfo> gpus;
+        int64_t last_update_us = 0;
+        uint64_t bytes_received = 0;
+    };
+    
+    TripleBuffer<FleetSnapshot> published;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    
+    std::mutex control_mutex; // Guards the fields below
+    std::vector<std::string> requested_endpoints;
+    bool endpoints_changed = false;
+    std::function<void()> update_listener;
+    
+    // Worker thread only
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<PollDescriptor> descriptors;
+    std::vector<Connection*> polled;
+    std::vector<uint8_t> receive_buffer;
+    std::chrono::steady_clock::time_point last_publish;
+    uint64_t publish_version = 0;
+    bool dirty = false;
+    
+    void fail(Connection& connection, const std::string& reason) {
+        if (connection.socket != kInvalidSocket) {
+            closeSocket(connection.socket);
+            connection.socket = kInvalidSocket;
+        }
+        if (connection.state == LinkState::Streaming) {
+            std::cerr << "Fleet agent " << connection.endpoint << " lost: " << reason << std::endl;
+        }
+        connection.state = LinkState::Waiting;
+        connection.status = reason;
+        connection.next_attempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(connection.retry_ms);
+        connection.retry_ms = std::min(kMaxRetryMs, connection.retry_ms * 2);
+        connection.inbox.clear();
+        connection.consumed = 0;
+        connection.greeted = false;
+        dirty = true;
+    }
+    
+    void beginConnect(Connection& connection) {
+        connection.socket = connectTcp(connection.host, connection.port);
+        if (connection.socket == kInvalidSocket) {
+            fail(connection, "Cannot resolve or connect");
+            return;
+        }
+        connection.state = LinkState::Connecting;
+        connection.last_activity = std::chrono::steady_clock::now();
+    }
+    
+    bool handleHello(Connection& connection, ByteReader& reader) {
+        char magic[sizeof(kFleetMagic)];
+        uint64_t version, field_count;
+        for (char& c : magic) {
+            if (!reader.readFixed(c)) return false;
+        }
+        if (std::memcmp(magic, kFleetMagic, sizeof(kFleetMagic)) != 0 || !reader.readVarint(version) ||
+            !reader.readString(connection.hostname) || !reader.readVarint(field_count)) {
+            return false;
+        }
+        if (version != kFleetProtocolVersion || field_count > 63) {
+            connection.status = "Unsupported protocol version " + std::to_string(version);
+            return false;
+        }
+        connection.field_count = static_cast<uint32_t>(field_count);
+        connection.greeted = true;
+        connection.retry_ms = kMinRetryMs;
+        connection.status = "Connected";
+        std::cerr << "Fleet agent " << connection.endpoint << " (" << connection.hostname << ") connected" << std::endl;
+        return true;
+    }
+    
+    bool handleDevices(Connection& connection, ByteReader& reader) {
+        uint64_t generation, count;
+        if (!reader.readVarint(generation) || !reader.readVarint(count) || count > kFleetMaxDevices) return false;
+        std::vector<GPUInfo> gpus(static_cast<size_t>(count));
+        for (GPUInfo& gpu : gpus) {
+            uint8_t is_nvidia;
+            if (!reader.readString(gpu.uuid) || !reader.readString(gpu.name) || !reader.readString(gpu.driver_version) ||
+                !reader.readString(gpu.pci_bus_id) || !reader.readFixed(is_nvidia)) {
+                return false;
+            }
+            gpu.is_nvidia = is_nvidia != 0;
+        }
+        connection.gpus.swap(gpus);
+        return true;
+    }
+    
+    bool handleUpdate(Connection& connection, ByteReader& reader) {
+        uint64_t wall_time_us, changed;
+        if (!reader.readVarint(wall_time_us) || !reader.readVarint(changed)) return false;
+        for (uint64_t i = 0; i < changed; i++) {
+            uint64_t index, mask;
+            if (!reader.readVarint(index) || !reader.readVarint(mask) || index >= connection.gpus.size()) return false;
+            GPUInfo& gpu = connection.gpus[static_cast<size_t>(index)];
+            for (uint32_t f = 0; f < connection.field_count; f++) {
+                if (!(mask & (1ull << f))) continue;
+                int64_t delta;
+                if (!reader.readSignedVarint(delta)) return false;
+                if (f < kTraceFieldCount) {
+                    gpu.*kTraceFields[f].member = static_cast<int>(gpu.*kTraceFields[f].member + delta);
+                }
+            }
+            if (mask & (1ull << connection.field_count)) gpu.stale = !gpu.stale;
+        }
+        return true;
+    }
+    
+    // Handles every complete frame in the inbox; false on a protocol error
+    bool processFrames(Connection& connection) {
+        while (connection.inbox.size() - connection.consumed >= kFleetFrameHeaderBytes) {
+            const uint8_t* header = connection.inbox.data() + connection.consumed;
+            uint32_t length;
+            std::memcpy(&length, header, sizeof(length));
+            if (length > kFleetMaxFrameBytes) return false;
+            if (connection.inbox.size() - connection.consumed < kFleetFrameHeaderBytes + length) break;
+            
+            FleetFrame type = static_cast<FleetFrame>(header[sizeof(uint32_t)]);
+            ByteReader reader(header + kFleetFrameHeaderBytes, length);
+            bool ok = true;
+            if (!connection.greeted) {
+                ok = type == FleetFrame::Hello && handleHello(connection, reader);
+            } else if (type == FleetFrame::Devices) {
+                ok = handleDevices(connection, reader);
+            } else if (type == FleetFrame::Update) {
+                ok = handleUpdate(connection, reader);
+            }
+            if (!ok) return false;
+            
+            connection.consumed += kFleetFrameHeaderBytes + length;
+            connection.last_activity = std::chrono::steady_clock::now();
+            connection.last_update_us = wallClockMicros();
+            dirty = true;
+        }
+        
+        if (connection.consumed == connection.inbox.size()) {
+            connection.inbox.clear();
+            connection.consumed = 0;
+        } else if (connection.consumed >= kReceiveChunk) {
+            connection.inbox.erase(connection.inbox.begin(), connection.inbox.begin() + connection.consumed);
+            connection.consumed = 0;
+        }
+        return true;
+    }
+    
+    void receive(Connection& connection) {
+        int count;
+        while ((count = receiveSome(connection.socket, receive_buffer.data(), receive_buffer.size())) > 0) {
+            connection.inbox.insert(connection.inbox.end(), receive_buffer.begin(), receive_buffer.begin() + count);
+            connection.bytes_received += count;
+        }
+        if (count < 0) {
+            fail(connection, "Connection closed");
+        } else if (!processFrames(connection)) {
+            fail(connection, connection.greeted ? "Protocol error" : "Not a gputune agent");
+        }
+    }
+    
+    void syncEndpoints() {
+        std::vector<std::string> endpoints;
+        {
+            std::lock_guard<std::mutex> lock(control_mutex);
+            if (!endpoints_changed) return;
+            endpoints = requested_endpoints;
+            endpoints_changed = false;
+        }
+        
+        for (size_t i = connections.size(); i-- > 0;) {
+            if (std::find(endpoints.begin(), endpoints.end(), connections[i]->endpoint) == endpoints.end()) {
+                if (connections[i]->socket != kInvalidSocket) closeSocket(connections[i]->socket);
+                connections.erase(connections.begin() + i);
+            }
+        }
+        for (const std::string& endpoint : endpoints) {
+            auto existing = std::find_if(connections.begin(), connections.end(),
+                                         [&](const std::unique_ptr<Connection>& c) { return c->endpoint == endpoint; });
+            if (existing != connections.end()) continue;
+            std::unique_ptr<Connection> connection(new Connection());
+            connection->endpoint = endpoint;
+            parseEndpoint(endpoint, connection->host, connection->port);
+            connection->next_attempt = std::chrono::steady_clock::now();
+            connections.push_back(std::move(connection));
+        }
+        dirty = true;
+    }
+    
+    void publish() {
+        FleetSnapshot& snapshot = published.writeBuffer();
+        snapshot.nodes.resize(connections.size());
+        size_t device_count = 0;
+        for (const auto& connection : connections) {
+            device_count += connection->gpus.size();
+        }
+        snapshot.devices.resize(device_count);
+        
+        size_t device = 0;
+        for (size_t n = 0; n < connections.size(); n++) {
+            const Connection& connection = *connections[n];
+            bool connected = connection.state == LinkState::Streaming && connection.greeted;
+            FleetNodeStatus& node = snapshot.nodes[n];
+            node.endpoint = connection.endpoint;
+            node.hostname = connection.hostname;
+            node.status = connection.status;
+            node.connected = connected;
+            node.gpu_count = connection.gpus.size();
+            node.last_update_us = connection.last_update_us;
+            node.bytes_received = connection.bytes_received;
+            
+            for (size_t i = 0; i < connection.gpus.size(); i++) {
+                FleetDevice& entry = snapshot.devices[device++];
+                entry.node = static_cast<uint32_t>(n);
+                entry.index = static_cast<uint32_t>(i);
+                entry.gpu = connection.gpus[i];
+                if (!connected) entry.gpu.stale = true;
+            }
+        }
+        snapshot.version = ++publish_version;
+        published.publish();
+        dirty = false;
+        last_publish = std::chrono::steady_clock::now();
+        
+        std::function<void()> listener;
+        {
+            std::lock_guard<std::mutex> lock(control_mutex);
+            listener = update_listener;
+        }
+        if (listener) listener();
+    }
+    
+    void workerLoop() {
+        receive_buffer.resize(kReceiveChunk);
+        while (running) {
+            syncEndpoints();
+            
+            auto now = std::chrono::steady_clock::now();
+            descriptors.clear();
+            polled.clear();
+            for (auto& connection : connections) {
+                if (connection->state == LinkState::Waiting && now >= connection->next_attempt) {
+                    beginConnect(*connection);
+                }
+                if (connection->socket == kInvalidSocket) continue;
+                short events = connection->state == LinkState::Connecting ? kPollWrite : kPollRead;
+                descriptors.push_back({connection->socket, events, 0});
+                polled.push_back(connection.get());
+            }
+            
+            if (descriptors.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+            } else {
+                pollSockets(descriptors.data(), descriptors.size(), kPollMs);
+            }
+            
+            for (size_t i = 0; i < polled.size(); i++) {
+                Connection& connection = *polled[i];
+                short revents = descriptors[i].revents;
+                if (!revents) continue;
+                if (connection.state == LinkState::Connecting) {
+                    if (socketError(connection.socket) != 0 || (revents & (POLLERR | POLLNVAL))) {
+                        fail(connection, "Connection refused");
+                    } else {
+                        connection.state = LinkState::Streaming;
+                        connection.status = "Waiting for agent";
+                        connection.last_activity = std::chrono::steady_clock::now();
+                    }
+                } else {
+                    receive(connection);
+                }
+            }
+            
+            now = std::chrono::steady_clock::now();
+            for (auto& connection : connections) {
+                if (connection->state == LinkState::Waiting) continue;
+                int limit_ms = connection->state == LinkState::Connecting ? kConnectTimeoutMs : kFleetTimeoutMs;
+                if (now - connection->last_activity > std::chrono::milliseconds(limit_ms)) {
+                    fail(*connection, "Timed out");
+                }
+            }
+            
+            if (dirty && now - last_publish >= std::chrono::milliseconds(kPublishIntervalMs)) {
+                publish();
+            }
+        }
+        
+        for (auto& connection : connections) {
+            if (connection->socket != kInvalidSocket) closeSocket(connection->socket);
+        }
+        connections.clear();
+    }
+    
+public:
+    FleetCollector() = default;
+    ~FleetCollector() { stop(); }
+    
+    FleetCollector(const FleetCollector&) = delete;
+    FleetCollector& operator=(const FleetCollector&) = delete;
+    
+    // "host:port"; the port is required
+    static bool parseEndpoint(const std::string& endpoint, std::string& host, int& port) {
+        size_t colon = endpoint.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 >= endpoint.size()) return false;
+        host = endpoint.substr(0, colon);
+        char* end = nullptr;
+        long value = std::strtol(endpoint.c_str() + colon + 1, &end, 10);
+        if (*end != '\0' || value <= 0 || value > 65535) return false;
+        port = static_cast<int>(value);
+        return true;
+    }
+    
+    // Starts streaming from the agent at endpoint; false if it isn't host:port
+    bool addAgent(const std::string& endpoint) {
+        std::string host;
+        int port;
+        if (!parseEndpoint(endpoint, host, port)) return false;
+        
+        if (!running) {
+            if (!startSockets()) return false;
+            running = true;
+            worker = std::thread([this] { workerLoop(); });
+        }
+        
+        std::lock_guard<std::mutex> lock(control_mutex);
+        if (std::find(requested_endpoints.begin(), requested_endpoints.end(), endpoint) == requested_endpoints.end()) {
+            requested_endpoints.push_back(endpoint);
+        }
+        endpoints_changed = true; // Also rebuilds the connections after a stop()
+        return true;
+    }
+    
+    void removeAgent(const std::string& endpoint) {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        auto it = std::find(requested_endpoints.begin(), requested_endpoints.end(), endpoint);
+        if (it != requested_endpoints.end()) {
+            requested_endpoints.erase(it);
+            endpoints_changed = true;
+        }
+    }
+    
+    std::vector<std::string> agents() {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        return requested_endpoints;
+    }
+    
+    void stop() {
+        if (!running) return;
+        running = false;
+        if (worker.joinable()) {
+            worker.join();
+        }
+        cleanupSockets();
+    }
+    
+    // Called on the collector thread after each publish; keep it cheap
+    void setUpdateListener(std::function<void()> listener) {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        update_listener = std::move(listener);
+    }
+    
+    // UI thread: swaps in the newest merged view if there is one
+    bool fetch() { return published.fetch(); }
+    const FleetSnapshot& snapshot() const { return published.readBuffer(); }
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+
+// Per-frame scratch memory for the UI thread: strings formatted during a frame
+// live here until reset() at the start of the next one, so frame code never
+// heap-allocates temporaries. Capacity is fixed; a request that doesn't fit
+// gets a truncated string rather than an allocation.
+class FrameArena {
+public:
+    static constexpr size_t kCapacity = 64 * 1024;
+    
+private:
+    char buffer[kCapacity];
+    size_t used = 0;
+    size_t peak = 0;
+    
+public:
+    void reset() { used = 0; }
+    
+    // printf-style; the result is valid until the next reset()
+    const char* format(const char* fmt, ...) {
+        char* out = buffer + used;
+        size_t space = kCapacity - used;
+        if (space < 2) return "";
+        
+        va_list args;
+        va_start(args, fmt);
+        int length = std::vsnprintf(out, space, fmt, args);
+        va_end(args);
+        
+        if (length < 0) {
+            out[0] = '\0';
+            length = 0;
+        }
+        used += std::min<size_t>(static_cast<size_t>(length), space - 1) + 1;
+        if (used > peak) peak = used;
+        return out;
+    }
+    
+    size_t bytesUsed() const { return used; }
+    size_t peakBytes() const { return peak; } // High-water mark, to size kCapacity
+};
@@ -0,0 +1,1944 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <functional>
+#include <unordered_map>
+#include <limits>
+
+#ifdef __APPLE__
+    #include <Metal/Metal.h>
+    #include <IOKit/IOKitLib.h>
+#endif
+
+// NVIDIA Management Library (NVML) for GPU control, loaded at runtime
+#include "nvml_api.h"
+
+#include "metric_history.h"
+#include "worker_pool.h"
+#include "fan_control.h"
+#include "event_log.h"
+#include "alert_rules.h"
+#include "latency_histogram.h"
+
+// One compute process running on a GPU
+struct GPUProcessInfo {
+    unsigned int pid = 0;
+    std::string name;
+    int memory_used = 0;         // MB
+    int sm_utilization = 0;      // %, over NVML's last sampling period
+    int memory_utilization = 0;  // %
+    int encoder_utilization = 0; // %
+    int decoder_utilization = 0; // %
+};
+
+// Data throughput of one active NVLink, MB/s
+struct NvLinkThroughput {
+    unsigned int link = 0;
+    int tx = 0;
+    int rx = 0;
+};
+
+class GPUInfo {
+public:
+    std::string name;
+    std::string driver_version;
+    std::string uuid;
+    std::string pci_bus_id;
+    int temperature = 0;
+    int memory_used = 0;
+    int memory_total = 0;
+    int gpu_utilization = 0;
+    int memory_utilization = 0;
+    int power_usage = 0;
+    int power_limit = 0;
+    int power_limit_min = 0;
+    int core_clock = 0;
+    int memory_clock = 0;
+    int fan_speed = 0;
+    bool is_nvidia = false;
+    bool stale = false; // Missed the last sweep's deadline; values are from an earlier sweep
+    bool fan_control_active = false; // Fans are being driven from target_fan_curve
+    int fan_control_target = 0;      // Last speed (%) the control loop commanded
+    uint32_t throttle_reasons = 0;   // kThrottle* bits, read with the clocks
+    int pcie_tx = 0;                 // MB/s
+    int pcie_rx = 0;                 // MB/s
+    int nvlink_tx = 0;               // MB/s, all links
+    int nvlink_rx = 0;               // MB/s, all links
+    int encoder_utilization = 0;     // %
+    int decoder_utilization = 0;     // %
+    bool ecc_enabled = false;
+    int ecc_corrected = 0;           // Single-bit errors since the driver loaded
+    int ecc_uncorrected = 0;         // Double-bit errors since the driver loaded
+    std::vector<NvLinkThroughput> nvlinks; // Active links, by link number
+    std::vector<GPUProcessInfo> processes; // Compute processes, most memory first
+    
+    // Tuning parameters
+    int target_core_clock = 0;
+    int target_memory_clock = 0;
+    int target_fan_curve[5] = {30, 40, 50, 70, 85}; // Fan speeds at kFanCurveTemperatures
+    int target_power_limit = 100; // Percentage
+    bool target_fan_control = false; // Drive fans from target_fan_curve once applied
+};
+
+// NVML queries that are sampled together, each group on its own interval
+enum class MetricGroup {
+    Temperature,
+    Utilization,
+    Power,
+    Memory,
+    Clocks,
+    Fan,
+    Limits, // Power limit constraints and memory total; almost never change
+    Processes, // Per-process memory and utilization
+    Interconnect, // PCIe, NVLink and ECC counters in one field-value batch, plus codec load
+    FanControl, // Not a query: the fan curve control loop's tick
+    Count
+};
+
+static constexpr int kMetricGroupCount = static_cast<int>(MetricGroup::Count);
+static constexpr uint32_t kAllMetricGroups = (1u << kMetricGroupCount) - 1;
+
+inline uint32_t metricGroupBit(MetricGroup group) { return 1u << static_cast<int>(group); }
+
+inline const char* metricGroupName(MetricGroup group) {
+    switch (group) {
+        case MetricGroup::Temperature: return "Temperature";
+        case MetricGroup::Utilization: return "Utilization";
+        case MetricGroup::Power: return "Power";
+        case MetricGroup::Memory: return "Memory";
+        case MetricGroup::Clocks: return "Clocks";
+        case MetricGroup::Fan: return "Fan";
+        case MetricGroup::Limits: return "Limits";
+        case MetricGroup::Processes: return "Processes";
+        case MetricGroup::Interconnect: return "Interconnect";
+        case MetricGroup::FanControl: return "Fan Control";
+        default: return "Unknown";
+    }
+}
+
+// Default per-group intervals: power and utilization fast enough to catch spikes,
+// slow-moving values rarely
+inline std::chrono::milliseconds defaultSampleInterval(MetricGroup group) {
+    switch (group) {
+        case MetricGroup::Temperature: return std::chrono::milliseconds(500);
+        case MetricGroup::Utilization: return std::chrono::milliseconds(100);
+        case MetricGroup::Power: return std::chrono::milliseconds(100);
+        case MetricGroup::Memory: return std::chrono::milliseconds(1000);
+        case MetricGroup::Clocks: return std::chrono::milliseconds(250);
+        case MetricGroup::Fan: return std::chrono::milliseconds(1000);
+        case MetricGroup::Limits: return std::chrono::milliseconds(30000);
+        case MetricGroup::Processes: return std::chrono::milliseconds(1000);
+        case MetricGroup::Interconnect: return std::chrono::milliseconds(1000);
+        case MetricGroup::FanControl: return std::chrono::milliseconds(250);
+        default: return std::chrono::milliseconds(1000);
+    }
+}
+
+// Min-heap of metric groups keyed by their next due time. Owned by the sampler thread.
+class SampleScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+private:
+    struct Entry {
+        Clock::time_point due;
+        MetricGroup group;
+        bool operator>(const Entry& other) const { return due > other.due; }
+    };
+    
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    
+public:
+    // Schedules every group to be sampled immediately
+    void reset(Clock::time_point now) {
+        queue = {};
+        for (int i = 0; i < kMetricGroupCount; i++) {
+            queue.push({now, static_cast<MetricGroup>(i)});
+        }
+    }
+    
+    // Pops every group that is due and reschedules it one interval later. Ticks that
+    // were missed entirely are skipped rather than replayed back to back.
+    template <typename IntervalFn>
+    uint32_t takeDue(Clock::time_point now, IntervalFn interval_for) {
+        uint32_t due_mask = 0;
+        while (!queue.empty() && queue.top().due <= now) {
+            Entry entry = queue.top();
+            queue.pop();
+            due_mask |= metricGroupBit(entry.group);
+            
+            entry.due += interval_for(entry.group);
+            if (entry.due <= now) {
+                entry.due = now + interval_for(entry.group);
+            }
+            queue.push(entry);
+        }
+        return due_mask;
+    }
+    
+    // Moves the groups in group_mask to one (new) interval from now
+    template <typename IntervalFn>
+    void reschedule(uint32_t group_mask, Clock::time_point now, IntervalFn interval_for) {
+        std::vector<Entry> entries;
+        while (!queue.empty()) {
+            entries.push_back(queue.top());
+            queue.pop();
+        }
+        for (Entry& entry : entries) {
+            if (group_mask & metricGroupBit(entry.group)) {
+                entry.due = now + interval_for(entry.group);
+            }
+            queue.push(entry);
+        }
+    }
+    
+    Clock::time_point nextDue() const { return queue.top().due; }
+};
+
+#ifdef GPUTUNE_HAVE_NVML
+// NVML sample buffers ingested in batch mode, one nvmlDeviceGetSamples call each
+struct BufferedSampleSource {
+    nvmlSamplingType_t type;
+    MetricGroup group;
+    HistoryMetric metric;
+    float scale; // Raw NVML unit to history unit
+};
+
+static const BufferedSampleSource kBufferedSampleSources[] = {
+    {NVML_TOTAL_POWER_SAMPLES, MetricGroup::Power, HistoryMetric::Power, 0.001f}, // mW -> W
+    {NVML_GPU_UTILIZATION_SAMPLES, MetricGroup::Utilization, HistoryMetric::GPUUtilization, 1.0f},
+    {NVML_MEMORY_UTILIZATION_SAMPLES, MetricGroup::Utilization, HistoryMetric::MemoryUtilization, 1.0f},
+    {NVML_PROCESSOR_CLK_SAMPLES, MetricGroup::Clocks, HistoryMetric::CoreClock, 1.0f},
+    {NVML_MEMORY_CLK_SAMPLES, MetricGroup::Clocks, HistoryMetric::MemoryClock, 1.0f},
+};
+
+static constexpr int kBufferedSampleSourceCount = sizeof(kBufferedSampleSources) / sizeof(kBufferedSampleSources[0]);
+#endif
+
+// What one entry of a device's Interconnect field-value batch feeds
+enum class InterconnectField : uint8_t {
+    EccMode,
+    EccCorrected,
+    EccUncorrected,
+    PcieTx, // Cumulative counters from here on; reported as rates
+    PcieRx,
+    NvLinkTx,
+    NvLinkRx
+};
+
+// Sampler-owned bookkeeping for one field of the batch
+struct InterconnectSlot {
+    InterconnectField kind = InterconnectField::EccMode;
+    unsigned int link = 0;
+    unsigned long long bytes_per_unit = 1; // Counter unit -> bytes
+    unsigned long long last_value = 0;
+    int64_t last_timestamp_us = 0;         // 0 until a first reading
+    int rate = 0;                          // MB/s over the last two readings
+};
+
+// Sampler-owned cursor into one of NVML's internal sample buffers
+struct BufferedSampleCursor {
+    unsigned long long last_timestamp = 0;
+    unsigned int capacity = 0; // 0 = not supported on this device, poll instead
+};
+
+// Resolved driver handle for a detected GPU, plus properties that stay fixed
+// while the device is present. Filled once by detectGPUs() and only read after.
+struct GPUDevice {
+    void* handle = nullptr;
+    unsigned int index = 0;
+    unsigned int power_limit_min = 0; // mW
+    unsigned int power_limit_max = 0; // mW
+    unsigned int power_limit_default = 0; // mW
+    std::string pci_bus_id;
+};
+
+// Per-device sampling state. A worker that is querying the device owns working,
+// the cursors and the scratch buffer until it clears busy; it then copies the
+// result into latest for the sampler to merge. Shared so a task still stuck in
+// the driver after its deadline (or a re-detection) keeps valid memory.
+struct DeviceSampleState {
+    void* handle = nullptr;
+    size_t gpu_index = 0;
+    GPUInfo working;
+    std::shared_ptr<GPUHistory> history;
+    std::vector<BufferedSampleCursor> cursors;
+#ifdef GPUTUNE_HAVE_NVML
+    std::vector<nvmlSample_t> scratch;
+#endif
+    std::atomic<bool> busy{false};
+    
+    std::mutex result_mutex;
+    GPUInfo latest;             // Guarded by result_mutex
+    uint64_t latest_sweep = 0;  // Guarded by result_mutex
+    uint64_t merged_sweep = 0;  // Sampler thread only
+    
+    // Fan curve control loop. The UI's request is copied in under control_mutex;
+    // the controller itself belongs to the owner of the state like working does.
+    std::mutex control_mutex;
+    FanCurveSettings requested_fan_curve; // Guarded by control_mutex
+    FanCurveController fan_controller;
+    unsigned int fan_count = 0;
+    std::chrono::steady_clock::time_point last_fan_tick;
+    
+    // Per-process accounting, owned like working. Utilization samples are read
+    // from last_process_timestamp on; names are looked up once per PID and the
+    // entry is dropped when the process exits.
+    struct ProcessCacheEntry {
+        std::string name;
+        bool name_resolved = false;
+        unsigned long long sample_timestamp = 0;
+        int sm_utilization = 0;
+        int memory_utilization = 0;
+        int encoder_utilization = 0;
+        int decoder_utilization = 0;
+        uint64_t last_seen_pass = 0;
+    };
+    std::unordered_map<unsigned int, ProcessCacheEntry> process_cache;
+    unsigned long long last_process_timestamp = 0;
+    uint64_t process_pass = 0;
+#ifdef GPUTUNE_HAVE_NVML
+    std::vector<nvmlProcessInfo_t> process_scratch;
+    std::vector<nvmlProcessUtilizationSample_t> process_samples;
+#endif
+    
+    // Interconnect group, owned like working. The field batch is worked out on
+    // the first pass from what the device answers and then sent as is.
+    bool interconnect_probed = false;
+    bool pcie_polled = false; // No PCIe byte counters; nvmlDeviceGetPcieThroughput instead
+    std::vector<InterconnectSlot> interconnect_slots;
+#ifdef GPUTUNE_HAVE_NVML
+    std::vector<nvmlFieldValue_t> field_values; // Parallel to interconnect_slots
+#endif
+};
+
+// Result of enumerating the driver's devices: parallel lists, in driver order
+struct DeviceScan {
+    std::vector<GPUInfo> gpus; // Static properties only
+    std::vector<GPUDevice> devices;
+};
+
+// One complete sweep of every detected GPU, as published by the sampler thread
+struct MonitorSnapshot {
+    std::vector<GPUInfo> gpus;
+    uint64_t generation = 0; // Device set the sweep belongs to (bumped when it changes)
+    uint64_t version = 0;
+    std::chrono::steady_clock::time_point timestamp;
+    int64_t wall_time_us = 0; // Same instant on the wallClockMicros() timebase, for recordings
+};
+
+// Lock-free single-producer/single-consumer triple buffer. The sampler fills the
+// back buffer and swaps it into the middle slot; the UI swaps the middle slot into
+// its front buffer only when a newer snapshot is waiting, so neither side blocks.
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr int kIndexMask = 0x3;
+    static constexpr int kFreshBit = 0x4;
+    
+    T buffers[3];
+    std::atomic<int> middle{1};
+    int back = 0;  // Owned by the producer
+    int front = 2; // Owned by the consumer
+    
+public:
+    T& writeBuffer() { return buffers[back]; }
+    
+    void publish() {
+        back = middle.exchange(back | kFreshBit, std::memory_order_acq_rel) & kIndexMask;
+    }
+    
+    // Returns true if a newer snapshot was swapped into the read buffer
+    bool fetch() {
+        if (!(middle.load(std::memory_order_acquire) & kFreshBit)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+    
+    const T& readBuffer() const { return buffers[front]; }
+};
+
+using SnapshotBuffer = TripleBuffer<MonitorSnapshot>;
+
+class GPUMonitor {
+private:
+    std::vector<GPUInfo> gpus;         // UI thread view, merged from published snapshots
+    std::vector<GPUInfo> sampled_gpus; // Sampler thread working set
+    std::vector<GPUDevice> devices;    // Parallel to gpus, immutable between detections
+    bool nvml_initialized = false;
+#ifdef GPUTUNE_HAVE_NVML
+    NvmlApi& nvml = nvmlApi();
+#endif
+    
+    // Background sampler
+    std::thread sampler_thread;
+    std::mutex sampler_mutex;
+    std::condition_variable sampler_cv;
+    bool sampler_running = false;
+    std::atomic<int> sample_interval_ms[kMetricGroupCount];
+    std::atomic<uint32_t> rescheduled_groups{0};
+    SnapshotBuffer snapshot_buffer;
+    std::chrono::steady_clock::time_point displayed_snapshot_time; // UI thread only
+    uint64_t device_generation = 0;
+    uint64_t snapshot_version = 0;
+    
+    // Other consumers of published sweeps (exporters, recorders), each with its
+    // own triple buffer so they never contend with the UI or with each other
+    std::mutex subscriber_mutex;
+    std::function<void()> snapshot_listener; // Guarded by subscriber_mutex
+    std::vector<std::shared_ptr<SnapshotBuffer>> snapshot_subscribers; // Guarded by subscriber_mutex
+    
+    // Per-GPU history rings, appended by the sampler and read by the UI. Only
+    // rebuilt by detectGPUs() on the UI thread while the sampler is parked.
+    std::vector<std::shared_ptr<GPUHistory>> histories;
+    
+    // Batch ingest of NVML's buffered samples
+    std::atomic<bool> batch_sampling{true};
+    
+    // Parallel sweeps: one task per device, merged once all have finished or the
+    // deadline passes, whichever comes first
+    std::vector<std::shared_ptr<DeviceSampleState>> device_states; // Parallel to devices
+    std::atomic<int> sweep_deadline_ms{250};
+    uint64_t sweep_id = 0;
+    LatencyHistogram sweep_latency; // Whole updateAllGPUs() passes, including the merge
+    
+    // Throttle transitions and driver events (XID, ECC). Rare, so NVML's event
+    // set is waited on by a thread of its own instead of being polled.
+    GPUEventLog event_log;
+    AlertEngine alert_engine{event_log};
+    std::vector<AlertEngine::Sample> alert_samples; // Sampler thread only
+    std::thread event_thread;
+    std::atomic<bool> event_running{false};
+#ifdef GPUTUNE_HAVE_NVML
+    nvmlEventSet_t event_set = nullptr;
+#endif
+    static constexpr unsigned int kEventWaitMs = 200; // Bounds how long stopping the thread takes
+    
+    // Background re-enumeration. requestRescan() only bumps scan_requests; the
+    // scan thread waits for requests to settle, enumerates off the UI thread and
+    // leaves the result for applyRescan(). It also probes the device count now
+    // and then, so hot-plugged or lost GPUs are noticed without a request.
+    std::thread scan_thread;
+    std::mutex scan_mutex;
+    std::condition_variable scan_cv;
+    std::atomic<bool> scan_running{false};
+    std::atomic<uint64_t> scan_requests{0};  // Bumped per request; a scan started earlier is abandoned
+    std::atomic<uint64_t> scanned_request{0}; // Last request the scan thread picked up
+    std::chrono::steady_clock::time_point last_scan_request; // Guarded by scan_mutex
+    bool scan_ready = false;   // Guarded by scan_mutex
+    DeviceScan scan_result;    // Guarded by scan_mutex
+    std::atomic<unsigned int> known_device_count{0};
+    static constexpr int kRescanDebounceMs = 300;
+    static constexpr int kHotplugProbeMs = 5000;
+    std::unique_ptr<WorkerPool> sampler_pool; // Last member: joined before the rest is destroyed
+    
+public:
+    GPUMonitor() {
+        for (int i = 0; i < kMetricGroupCount; i++) {
+            sample_interval_ms[i] = static_cast<int>(defaultSampleInterval(static_cast<MetricGroup>(i)).count());
+        }
+        initializeNVML();
+        detectGPUs();
+        startScanThread();
+    }
+    
+    ~GPUMonitor() {
+        stopScanThread();
+        stopEventWatcher();
+        stopSampler();
+        releaseFanControl();
+        if (nvml_initialized) {
+#ifdef GPUTUNE_HAVE_NVML
+            nvml.Shutdown();
+#endif
+        }
+    }
+    
+    void initializeNVML() {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml.load()) {
+            std::cout << "NVML not available on this system" << std::endl;
+            return;
+        }
+        
+        nvmlReturn_t result = nvml.Init();
+        if (result == NVML_SUCCESS) {
+            nvml_initialized = true;
+            std::cout << "NVML initialized successfully" << std::endl;
+        } else {
+            std::cout << "Failed to initialize NVML: " << nvml.ErrorString(result) << std::endl;
+        }
+#endif
+    }
+    
+    // Queries every device's handle and static properties. Touches no monitor
+    // state, so it can run on any thread; returns false if cancelled() said to
+    // stop before all devices were read.
+    template <typename Cancelled>
+    bool enumerateDevices(DeviceScan& scan, Cancelled&& cancelled) {
+        scan.gpus.clear();
+        scan.devices.clear();
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized) return true;
+        
+        // Driver version is system-wide, so query it once for all devices
+        char version[NVML_SYSTEM_DRIVER_VERSION_BUFFER_SIZE] = "";
+        nvml.SystemGetDriverVersion(version, NVML_SYSTEM_DRIVER_VERSION_BUFFER_SIZE);
+        
+        unsigned int device_count;
+        if (nvml.DeviceGetCount(&device_count) != NVML_SUCCESS) return true;
+        
+        for (unsigned int i = 0; i < device_count; i++) {
+            if (cancelled()) return false;
+            nvmlDevice_t device;
+            if (nvml.DeviceGetHandleByIndex(i, &device) != NVML_SUCCESS) continue;
+            
+            GPUInfo gpu;
+            gpu.is_nvidia = true;
+            gpu.driver_version = std::string(version);
+            
+            GPUDevice entry;
+            entry.handle = device;
+            entry.index = i;
+            queryStaticProperties(gpu, entry);
+            
+            scan.gpus.push_back(gpu);
+            scan.devices.push_back(entry);
+        }
+#else
+        (void)cancelled;
+#endif
+        return true;
+    }
+    
+    // Synchronous full detection: drops every device's state and history. Used
+    // at startup; later refreshes go through requestRescan()/applyRescan().
+    void detectGPUs() {
+        // The sampler owns the working set, so park it while the device list changes
+        stopEventWatcher();
+        stopSampler();
+        releaseFanControl();
+        event_log.clear();
+        alert_engine.resetState();
+        gpus.clear();
+        devices.clear();
+        device_generation++;
+        histories.clear();
+        device_states.clear();
+        {
+            std::lock_guard<std::mutex> lock(scan_mutex);
+            scan_ready = false; // Whatever a background scan found predates this
+        }
+        
+#ifdef GPUTUNE_HAVE_NVML
+        DeviceScan scan;
+        enumerateDevices(scan, [] { return false; });
+        gpus = std::move(scan.gpus);
+        devices = std::move(scan.devices);
+        known_device_count = static_cast<unsigned int>(devices.size());
+#elif __APPLE__
+        // macOS Metal GPU detection
+        id<MTLDevice> device = MTLCreateSystemDefaultDevice();
+        if (device) {
+            GPUInfo gpu;
+            gpu.name = std::string([device.name UTF8String]);
+            gpu.is_nvidia = false; // Apple Silicon or AMD
+            gpus.push_back(gpu);
+        }
+#endif
+        
+        for (size_t i = 0; i < gpus.size(); i++) {
+            histories.push_back(std::make_shared<GPUHistory>());
+        }
+        
+        for (size_t i = 0; i < devices.size(); i++) {
+            device_states.push_back(createSampleState(i));
+        }
+        resizeSamplerPool();
+        
+        // Initial sweep so the UI has values before the sampler's first publish. It
+        // polls, since the sample buffer cursors only return readings from now on.
+        sampled_gpus = gpus;
+        updateAllGPUs(kAllMetricGroups, false);
+        gpus = sampled_gpus;
+        
+        if (nvml_initialized) {
+            startSampler();
+            startEventWatcher();
+        }
+    }
+    
+    std::shared_ptr<DeviceSampleState> createSampleState(size_t gpu_index) {
+        std::shared_ptr<DeviceSampleState> state = std::make_shared<DeviceSampleState>();
+        state->handle = devices[gpu_index].handle;
+        state->working = gpus[gpu_index];
+        state->gpu_index = gpu_index;
+        state->history = histories[gpu_index];
+        initializeSampleCursors(*state);
+#ifdef GPUTUNE_HAVE_NVML
+        if (nvml.DeviceGetNumFans(static_cast<nvmlDevice_t>(state->handle), &state->fan_count) != NVML_SUCCESS) {
+            state->fan_count = 0;
+        }
+#endif
+        return state;
+    }
+    
+    // One worker per device up to a cap; a single GPU is sampled inline. The pool is
+    // only rebuilt when its size changes, since that waits for any hung task.
+    void resizeSamplerPool() {
+        size_t pool_size = devices.size() > 1 ? std::min<size_t>(devices.size(), 16) : 0;
+        size_t current_size = sampler_pool ? sampler_pool->size() : 0;
+        if (pool_size != current_size) {
+            sampler_pool.reset(pool_size > 0 ? new WorkerPool(pool_size) : nullptr);
+        }
+    }
+    
+    // Asks for a background re-enumeration. Safe to call from any thread and as
+    // often as wanted (e.g. on every key repeat): requests within
+    // kRescanDebounceMs of each other collapse into one scan.
+    void requestRescan() {
+        {
+            std::lock_guard<std::mutex> lock(scan_mutex);
+            last_scan_request = std::chrono::steady_clock::now();
+            scan_requests++;
+        }
+        scan_cv.notify_all();
+    }
+    
+    // True from a request until its scan has been applied (or found nothing new)
+    bool isRescanPending() {
+        if (scan_requests.load() != scanned_request.load()) return true;
+        std::lock_guard<std::mutex> lock(scan_mutex);
+        return scan_ready;
+    }
+    
+    // UI thread, once per frame. Adopts a finished scan if the device set
+    // changed and allow_device_changes is set (callers clear it while
+    // something depends on the current indices, like an auto-tune run; the
+    // scan then waits). Returns true if devices were added, removed or reordered.
+    bool applyRescan(bool allow_device_changes) {
+        DeviceScan scan;
+        {
+            std::lock_guard<std::mutex> lock(scan_mutex);
+            if (!scan_ready) return false;
+            
+            bool unchanged = scan_result.devices.size() == devices.size();
+            for (size_t i = 0; unchanged && i < devices.size(); i++) {
+                unchanged = scan_result.gpus[i].uuid == gpus[i].uuid && scan_result.devices[i].handle == devices[i].handle;
+            }
+            if (unchanged) {
+                scan_ready = false;
+                return false;
+            }
+            if (!allow_device_changes) return false;
+            
+            scan = std::move(scan_result);
+            scan_ready = false;
+        }
+        adoptDevices(scan);
+        return true;
+    }
+    
+    // Properties a re-detection may have changed on a device that is kept
+    static void copyStaticProperties(const GPUInfo& found, GPUInfo& target) {
+        target.name = found.name;
+        target.driver_version = found.driver_version;
+        target.pci_bus_id = found.pci_bus_id;
+        target.memory_total = found.memory_total;
+        target.power_limit = found.power_limit;
+        target.power_limit_min = found.power_limit_min;
+    }
+    
+    // Switches to a new device set, matching devices by UUID: a device that was
+    // already present keeps its history, sampling state (sample cursors,
+    // process cache, fan control) and the tuning targets in its view, under
+    // its new index. The sampler is parked only for the swap itself.
+    void adoptDevices(DeviceScan& scan) {
+        std::unordered_map<std::string, size_t> previous_index;
+        for (size_t i = 0; i < gpus.size(); i++) {
+            if (!gpus[i].uuid.empty()) previous_index.emplace(gpus[i].uuid, i);
+        }
+        
+        stopEventWatcher();
+        stopSampler();
+        
+        std::vector<int> old_to_new(gpus.size(), -1);
+        std::vector<GPUInfo> new_gpus;
+        std::vector<std::shared_ptr<GPUHistory>> new_histories;
+        std::vector<std::shared_ptr<DeviceSampleState>> new_states(scan.devices.size());
+        size_t kept = 0;
+        
+        for (size_t j = 0; j < scan.devices.size(); j++) {
+            const GPUInfo& found = scan.gpus[j];
+            auto match = previous_index.find(found.uuid);
+            // A state still stuck in a hung worker can't be touched, so that device starts over
+            if (match == previous_index.end() || old_to_new[match->second] >= 0 || device_states[match->second]->busy) {
+                new_gpus.push_back(found);
+                new_histories.push_back(std::make_shared<GPUHistory>());
+                continue;
+            }
+            
+            size_t i = match->second;
+            old_to_new[i] = static_cast<int>(j);
+            kept++;
+            
+            GPUInfo view = gpus[i]; // Latest readings and tuning targets
+            copyStaticProperties(found, view);
+            new_gpus.push_back(view);
+            new_histories.push_back(histories[i]);
+            
+            new_states[j] = device_states[i];
+            new_states[j]->handle = scan.devices[j].handle;
+            new_states[j]->gpu_index = j;
+            // The sampler publishes working (and merges latest), so they get the new properties too
+            copyStaticProperties(found, new_states[j]->working);
+            {
+                std::lock_guard<std::mutex> lock(new_states[j]->result_mutex);
+                copyStaticProperties(found, new_states[j]->latest);
+            }
+        }
+        
+        // Devices that are gone can't be driven any more; put back what we can
+        for (size_t i = 0; i < device_states.size(); i++) {
+            DeviceSampleState& state = *device_states[i];
+            if (old_to_new[i] < 0 && !state.busy && state.fan_controller.isDriving()) {
+                restoreDefaultFanPolicy(state);
+            }
+        }
+        
+        size_t removed = gpus.size() - kept;
+        gpus = std::move(new_gpus);
+        devices = std::move(scan.devices);
+        histories = std::move(new_histories);
+        device_generation++;
+        for (size_t j = 0; j < new_states.size(); j++) {
+            if (!new_states[j]) new_states[j] = createSampleState(j);
+        }
+        device_states = std::move(new_states);
+        resizeSamplerPool();
+        event_log.remapGPUs(old_to_new);
+        alert_engine.remapGPUs(old_to_new, devices.size());
+        known_device_count = static_cast<unsigned int>(devices.size());
+        
+        std::cerr << "GPU set changed: " << devices.size() << " devices (" << kept << " kept, "
+                  << devices.size() - kept << " added, " << removed << " removed)" << std::endl;
+        
+        sampled_gpus = gpus;
+        if (nvml_initialized) {
+            startSampler();
+            startEventWatcher();
+        }
+    }
+    
+    void startScanThread() {
+        if (!nvml_initialized || scan_running) return;
+        scan_running = true;
+        scan_thread = std::thread([this] { scanLoop(); });
+    }
+    
+    void stopScanThread() {
+        {
+            std::lock_guard<std::mutex> lock(scan_mutex);
+            scan_running = false;
+        }
+        scan_cv.notify_all();
+        if (scan_thread.joinable()) {
+            scan_thread.join();
+        }
+    }
+    
+    void scanLoop() {
+        auto debounce = std::chrono::milliseconds(kRescanDebounceMs);
+        std::unique_lock<std::mutex> lock(scan_mutex);
+        while (scan_running) {
+            uint64_t pending = scan_requests.load();
+            if (pending == scanned_request.load()) {
+                bool requested = scan_cv.wait_for(lock, std::chrono::milliseconds(kHotplugProbeMs), [this] {
+                    return !scan_running || scan_requests.load() != scanned_request.load();
+                });
+                if (requested || !scan_running) continue;
+                
+                // Idle probe: a different count means devices came or went
+                lock.unlock();
+                unsigned int count = 0;
+                bool changed = false;
+#ifdef GPUTUNE_HAVE_NVML
+                changed = nvml.DeviceGetCount(&count) == NVML_SUCCESS && count != known_device_count.load();
+#endif
+                lock.lock();
+                if (changed) {
+                    last_scan_request = std::chrono::steady_clock::now() - debounce;
+                    scan_requests++;
+                }
+                continue;
+            }
+            
+            // Let a burst of requests settle; a newer one pushes the deadline out
+            auto ready_at = last_scan_request + debounce;
+            if (std::chrono::steady_clock::now() < ready_at) {
+                scan_cv.wait_until(lock, ready_at, [this] { return !scan_running; });
+                continue;
+            }
+            
+            lock.unlock();
+            DeviceScan scan;
+            bool complete = enumerateDevices(scan, [this, pending] {
+                return !scan_running || scan_requests.load() != pending;
+            });
+            lock.lock();
+            
+            // A request that arrived meanwhile gets a scan of its own
+            if (!complete || scan_requests.load() != pending) continue;
+            scan_result = std::move(scan);
+            scan_ready = true;
+            scanned_request = pending;
+            lock.unlock();
+            notifySnapshotListener(); // Wakes a UI that sleeps between events
+            lock.lock();
+        }
+    }
+    
+    // Sizes the device's NVML sample buffers once; the sizes are fixed by the driver
+    void initializeSampleCursors(DeviceSampleState& state) {
+#ifdef GPUTUNE_HAVE_NVML
+        state.cursors.assign(kBufferedSampleSourceCount, BufferedSampleCursor());
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        unsigned int max_capacity = 0;
+        
+        for (int i = 0; i < kBufferedSampleSourceCount; i++) {
+            nvmlValueType_t value_type;
+            unsigned int count = 0;
+            if (nvml.DeviceGetSamples(device, kBufferedSampleSources[i].type, 0, &value_type, &count, nullptr) == NVML_SUCCESS) {
+                state.cursors[i].capacity = count;
+                state.cursors[i].last_timestamp = static_cast<unsigned long long>(wallClockMicros());
+                max_capacity = std::max(max_capacity, count);
+            }
+        }
+        state.scratch.resize(max_capacity);
+#endif
+    }
+    
+    // Properties that don't change while the device is present: fetched once at detection
+    void queryStaticProperties(GPUInfo& gpu, GPUDevice& entry) {
+#ifdef GPUTUNE_HAVE_NVML
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(entry.handle);
+        
+        char name[NVML_DEVICE_NAME_BUFFER_SIZE];
+        if (nvml.DeviceGetName(device, name, NVML_DEVICE_NAME_BUFFER_SIZE) == NVML_SUCCESS) {
+            gpu.name = std::string(name);
+        }
+        
+        char uuid[NVML_DEVICE_UUID_BUFFER_SIZE];
+        if (nvml.DeviceGetUUID(device, uuid, NVML_DEVICE_UUID_BUFFER_SIZE) == NVML_SUCCESS) {
+            gpu.uuid = std::string(uuid);
+        }
+        
+        nvmlPciInfo_t pci;
+        if (nvml.DeviceGetPciInfo(device, &pci) == NVML_SUCCESS) {
+            gpu.pci_bus_id = std::string(pci.busId);
+            entry.pci_bus_id = gpu.pci_bus_id;
+        }
+        
+        nvmlMemory_t memory;
+        if (nvml.DeviceGetMemoryInfo(device, &memory) == NVML_SUCCESS) {
+            gpu.memory_total = memory.total / (1024 * 1024);
+        }
+        
+        unsigned int min_limit, max_limit;
+        if (nvml.DeviceGetPowerManagementLimitConstraints(device, &min_limit, &max_limit) == NVML_SUCCESS) {
+            entry.power_limit_min = min_limit;
+            entry.power_limit_max = max_limit;
+            gpu.power_limit_min = min_limit / 1000;
+            gpu.power_limit = max_limit / 1000;
+        }
+        
+        unsigned int default_limit;
+        if (nvml.DeviceGetPowerManagementDefaultLimit(device, &default_limit) == NVML_SUCCESS) {
+            entry.power_limit_default = default_limit;
+        } else {
+            entry.power_limit_default = entry.power_limit_max;
+        }
+#endif
+    }
+    
+    // Volatile metrics only; static properties come from queryStaticProperties().
+    // group_mask selects which metric groups to query (see MetricGroup). Runs on
+    // whichever thread owns the state: a pool worker, or the sampler/UI thread
+    // directly when there is a single GPU.
+    void updateGPUInfo(DeviceSampleState& state, uint32_t group_mask = kAllMetricGroups, bool use_buffered = true) {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized) return;
+        
+        GPUInfo& gpu = state.working;
+        GPUHistory& history = *state.history;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        int64_t now_us = wallClockMicros();
+        
+        // Buffered samples first: every reading NVML took since the last call, in
+        // one call per metric. Metrics without a buffer on this device are polled.
+        uint32_t buffered_mask = 0;
+        if (batch_sampling && use_buffered) {
+            buffered_mask = ingestBufferedSamples(state, group_mask);
+        }
+        
+        FanCurveSettings fan_settings;
+        bool fan_tick = false;
+        if (group_mask & metricGroupBit(MetricGroup::FanControl)) {
+            std::lock_guard<std::mutex> lock(state.control_mutex);
+            fan_settings = state.requested_fan_curve;
+            fan_tick = fan_settings.enabled || state.fan_controller.isDriving();
+        }
+        
+        // Temperature; always fresh for a fan control tick
+        if ((group_mask & metricGroupBit(MetricGroup::Temperature)) || fan_tick) {
+            unsigned int temp;
+            nvmlReturn_t result = nvml.DeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &temp);
+            if (result == NVML_SUCCESS) {
+                gpu.temperature = temp;
+                recordSample(history, HistoryMetric::Temperature, now_us, gpu.temperature);
+            } else if (result == NVML_ERROR_GPU_IS_LOST) {
+                requestRescan(); // Fell off the bus; debounced, so once per sweep is fine
+            }
+        }
+        
+        // Memory info
+        if (group_mask & metricGroupBit(MetricGroup::Memory)) {
+            nvmlMemory_t memory;
+            if (nvml.DeviceGetMemoryInfo(device, &memory) == NVML_SUCCESS) {
+                gpu.memory_used = memory.used / (1024 * 1024); // Convert to MB
+                if (gpu.memory_total > 0) {
+                    recordSample(history, HistoryMetric::MemoryUsage, now_us, (float)gpu.memory_used / gpu.memory_total * 100.0f);
+                }
+            }
+        }
+        
+        // Utilization
+        if ((group_mask & ~buffered_mask) & metricGroupBit(MetricGroup::Utilization)) {
+            nvmlUtilization_t util;
+            if (nvml.DeviceGetUtilizationRates(device, &util) == NVML_SUCCESS) {
+                gpu.gpu_utilization = util.gpu;
+                gpu.memory_utilization = util.memory;
+                recordSample(history, HistoryMetric::GPUUtilization, now_us, gpu.gpu_utilization);
+                recordSample(history, HistoryMetric::MemoryUtilization, now_us, gpu.memory_utilization);
+            }
+        }
+        
+        // Power usage
+        if ((group_mask & ~buffered_mask) & metricGroupBit(MetricGroup::Power)) {
+            unsigned int power;
+            if (nvml.DeviceGetPowerUsage(device, &power) == NVML_SUCCESS) {
+                gpu.power_usage = power / 1000; // Convert to watts
+                recordSample(history, HistoryMetric::Power, now_us, power / 1000.0f);
+            }
+        }
+        
+        // Clock speeds
+        if ((group_mask & ~buffered_mask) & metricGroupBit(MetricGroup::Clocks)) {
+            unsigned int clock;
+            if (nvml.DeviceGetClockInfo(device, NVML_CLOCK_GRAPHICS, &clock) == NVML_SUCCESS) {
+                gpu.core_clock = clock;
+                recordSample(history, HistoryMetric::CoreClock, now_us, gpu.core_clock);
+            }
+            if (nvml.DeviceGetClockInfo(device, NVML_CLOCK_MEM, &clock) == NVML_SUCCESS) {
+                gpu.memory_clock = clock;
+                recordSample(history, HistoryMetric::MemoryClock, now_us, gpu.memory_clock);
+            }
+        }
+        
+        // Fan speed
+        if (group_mask & metricGroupBit(MetricGroup::Fan)) {
+            unsigned int fan;
+            if (nvml.DeviceGetFanSpeed(device, &fan) == NVML_SUCCESS) {
+                gpu.fan_speed = fan;
+                recordSample(history, HistoryMetric::FanSpeed, now_us, gpu.fan_speed);
+            }
+        }
+        
+        // Limits: refreshed rarely for display; the setters keep using the
+        // constraints cached at detection time
+        if (group_mask & metricGroupBit(MetricGroup::Limits)) {
+            nvmlMemory_t memory;
+            if (nvml.DeviceGetMemoryInfo(device, &memory) == NVML_SUCCESS) {
+                gpu.memory_total = memory.total / (1024 * 1024);
+            }
+            unsigned int min_limit, max_limit;
+            if (nvml.DeviceGetPowerManagementLimitConstraints(device, &min_limit, &max_limit) == NVML_SUCCESS) {
+                gpu.power_limit_min = min_limit / 1000;
+                gpu.power_limit = max_limit / 1000;
+            }
+        }
+        
+        // Why the clocks are where they are; changes in the limiting reasons are logged
+        if (group_mask & metricGroupBit(MetricGroup::Clocks)) {
+            unsigned long long reasons;
+            if (nvml.DeviceGetCurrentClocksThrottleReasons(device, &reasons) == NVML_SUCCESS) {
+                gpu.throttle_reasons = static_cast<uint32_t>(reasons);
+                event_log.recordThrottle(state.gpu_index, now_us, gpu.throttle_reasons & kThrottleLimitingMask);
+            }
+        }
+        
+        if (group_mask & metricGroupBit(MetricGroup::Processes)) {
+            updateProcesses(state);
+        }
+        
+        if (group_mask & metricGroupBit(MetricGroup::Interconnect)) {
+            updateInterconnect(state, now_us);
+        }
+        
+        if (fan_tick) {
+            runFanControl(state, fan_settings);
+        }
+#endif
+    }
+    
+    // PCIe and NVLink traffic and the ECC error counts from one
+    // nvmlDeviceGetFieldValues call, rather than a query per metric and link.
+    // Encoder and decoder load have no field IDs and stay two plain queries;
+    // nvmlDeviceGetPcieThroughput, which blocks for its 20 ms sampling window,
+    // is only used on devices without the PCIe byte counters.
+    void updateInterconnect(DeviceSampleState& state, int64_t now_us) {
+#ifdef GPUTUNE_HAVE_NVML
+        GPUInfo& gpu = state.working;
+        GPUHistory& history = *state.history;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        
+        if (!state.interconnect_probed) probeInterconnect(state);
+        
+        bool pcie_read = false;
+        gpu.nvlinks.clear();
+        if (!state.field_values.empty()) {
+            // Field IDs and scopes are inputs and survive the call, so the batch is sent as is
+            nvmlReturn_t result = nvml.DeviceGetFieldValues(device, static_cast<int>(state.field_values.size()),
+                                                             state.field_values.data());
+            for (size_t i = 0; result == NVML_SUCCESS && i < state.field_values.size(); i++) {
+                const nvmlFieldValue_t& field = state.field_values[i];
+                InterconnectSlot& slot = state.interconnect_slots[i];
+                bool nvlink = slot.kind == InterconnectField::NvLinkTx || slot.kind == InterconnectField::NvLinkRx;
+                if (nvlink && (gpu.nvlinks.empty() || gpu.nvlinks.back().link != slot.link)) {
+                    gpu.nvlinks.push_back({slot.link, 0, 0});
+                }
+                if (field.nvmlReturn != NVML_SUCCESS) continue;
+                
+                unsigned long long value = counterValue(field.value, field.valueType);
+                if (slot.kind >= InterconnectField::PcieTx) {
+                    advanceCounter(slot, value, field.timestamp > 0 ? field.timestamp : now_us);
+                }
+                switch (slot.kind) {
+                    case InterconnectField::EccMode: gpu.ecc_enabled = value != 0; break;
+                    case InterconnectField::EccCorrected: gpu.ecc_corrected = clampCount(value); break;
+                    case InterconnectField::EccUncorrected: gpu.ecc_uncorrected = clampCount(value); break;
+                    case InterconnectField::PcieTx: gpu.pcie_tx = slot.rate; pcie_read = true; break;
+                    case InterconnectField::PcieRx: gpu.pcie_rx = slot.rate; pcie_read = true; break;
+                    case InterconnectField::NvLinkTx: gpu.nvlinks.back().tx = slot.rate; break;
+                    case InterconnectField::NvLinkRx: gpu.nvlinks.back().rx = slot.rate; break;
+                }
+            }
+        }
+        
+        if (state.pcie_polled) {
+            unsigned int tx_kbps, rx_kbps;
+            nvmlReturn_t result = nvml.DeviceGetPcieThroughput(device, NVML_PCIE_UTIL_TX_BYTES, &tx_kbps);
+            if (result == NVML_SUCCESS && nvml.DeviceGetPcieThroughput(device, NVML_PCIE_UTIL_RX_BYTES, &rx_kbps) == NVML_SUCCESS) {
+                gpu.pcie_tx = static_cast<int>(tx_kbps / 1000);
+                gpu.pcie_rx = static_cast<int>(rx_kbps / 1000);
+                pcie_read = true;
+            } else if (result == NVML_ERROR_NOT_SUPPORTED || result == NVML_ERROR_FUNCTION_NOT_FOUND) {
+                state.pcie_polled = false;
+            }
+        }
+        if (pcie_read) {
+            recordSample(history, HistoryMetric::PCIeTx, now_us, gpu.pcie_tx);
+            recordSample(history, HistoryMetric::PCIeRx, now_us, gpu.pcie_rx);
+        }
+        
+        gpu.nvlink_tx = 0;
+        gpu.nvlink_rx = 0;
+        for (const NvLinkThroughput& link : gpu.nvlinks) {
+            gpu.nvlink_tx += link.tx;
+            gpu.nvlink_rx += link.rx;
+        }
+        if (!gpu.nvlinks.empty()) {
+            recordSample(history, HistoryMetric::NVLinkTx, now_us, gpu.nvlink_tx);
+            recordSample(history, HistoryMetric::NVLinkRx, now_us, gpu.nvlink_rx);
+        }
+        
+        unsigned int utilization, period_us;
+        if (nvml.DeviceGetEncoderUtilization(device, &utilization, &period_us) == NVML_SUCCESS) {
+            gpu.encoder_utilization = static_cast<int>(utilization);
+            recordSample(history, HistoryMetric::EncoderUtilization, now_us, gpu.encoder_utilization);
+        }
+        if (nvml.DeviceGetDecoderUtilization(device, &utilization, &period_us) == NVML_SUCCESS) {
+            gpu.decoder_utilization = static_cast<int>(utilization);
+            recordSample(history, HistoryMetric::DecoderUtilization, now_us, gpu.decoder_utilization);
+        }
+#endif
+    }
+    
+#ifdef GPUTUNE_HAVE_NVML
+    // Works out the device's field batch: ECC and PCIe counters, then a TX/RX
+    // pair per NVLink it reports. Fields the device rejects are dropped, so the
+    // steady-state call only carries readings that can succeed. The probe's
+    // counter readings seed the rates, which are then valid from the next pass.
+    void probeInterconnect(DeviceSampleState& state) {
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        std::vector<InterconnectSlot>& slots = state.interconnect_slots;
+        std::vector<nvmlFieldValue_t>& fields = state.field_values;
+        slots.clear();
+        fields.clear();
+        
+        nvmlFieldValue_t link_count = {};
+        link_count.fieldId = NVML_FI_DEV_NVLINK_LINK_COUNT;
+        nvmlReturn_t result = nvml.DeviceGetFieldValues(device, 1, &link_count);
+        if (result != NVML_SUCCESS) {
+            // Try again next pass unless the driver simply can't batch
+            state.interconnect_probed = result == NVML_ERROR_FUNCTION_NOT_FOUND || result == NVML_ERROR_NOT_SUPPORTED;
+            state.pcie_polled = state.interconnect_probed;
+            return;
+        }
+        
+        auto add = [&](unsigned int field_id, unsigned int scope, InterconnectField kind,
+                       unsigned long long bytes_per_unit) {
+            nvmlFieldValue_t field = {};
+            field.fieldId = field_id;
+            field.scopeId = scope;
+            fields.push_back(field);
+            InterconnectSlot slot;
+            slot.kind = kind;
+            slot.link = scope;
+            slot.bytes_per_unit = bytes_per_unit;
+            slots.push_back(slot);
+        };
+        add(NVML_FI_DEV_ECC_CURRENT, 0, InterconnectField::EccMode, 1);
+        add(NVML_FI_DEV_ECC_SBE_VOL_TOTAL, 0, InterconnectField::EccCorrected, 1);
+        add(NVML_FI_DEV_ECC_DBE_VOL_TOTAL, 0, InterconnectField::EccUncorrected, 1);
+#ifdef NVML_FI_DEV_PCIE_COUNT_TX_BYTES
+        add(NVML_FI_DEV_PCIE_COUNT_TX_BYTES, 0, InterconnectField::PcieTx, 1);
+        add(NVML_FI_DEV_PCIE_COUNT_RX_BYTES, 0, InterconnectField::PcieRx, 1);
+#endif
+#ifdef NVML_FI_DEV_NVLINK_THROUGHPUT_DATA_TX
+        unsigned int links = 0;
+        if (link_count.nvmlReturn == NVML_SUCCESS) {
+            links = static_cast<unsigned int>(std::min<unsigned long long>(
+                counterValue(link_count.value, link_count.valueType), NVML_NVLINK_MAX_LINKS));
+        }
+        for (unsigned int link = 0; link < links; link++) {
+            add(NVML_FI_DEV_NVLINK_THROUGHPUT_DATA_TX, link, InterconnectField::NvLinkTx, 1024); // KiB
+            add(NVML_FI_DEV_NVLINK_THROUGHPUT_DATA_RX, link, InterconnectField::NvLinkRx, 1024);
+        }
+#endif
+        
+        result = nvml.DeviceGetFieldValues(device, static_cast<int>(fields.size()), fields.data());
+        if (result != NVML_SUCCESS) {
+            slots.clear();
+            fields.clear();
+            return;
+        }
+        
+        int64_t now_us = wallClockMicros();
+        size_t kept = 0;
+        bool pcie_counters = false;
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (fields[i].nvmlReturn != NVML_SUCCESS) continue;
+            if (slots[i].kind >= InterconnectField::PcieTx) {
+                advanceCounter(slots[i], counterValue(fields[i].value, fields[i].valueType),
+                               fields[i].timestamp > 0 ? fields[i].timestamp : now_us);
+            }
+            pcie_counters |= slots[i].kind == InterconnectField::PcieTx;
+            fields[kept] = fields[i];
+            slots[kept] = slots[i];
+            kept++;
+        }
+        fields.resize(kept);
+        slots.resize(kept);
+        state.pcie_polled = !pcie_counters;
+        state.interconnect_probed = true;
+    }
+#endif
+    
+    // Compute processes with their memory and SM/memory/codec utilization. A busy
+    // node can run hundreds, so a pass costs one call for the process list, one
+    // for the utilization samples newer than the last one seen, and a name lookup
+    // only for PIDs that weren't there last time.
+    void updateProcesses(DeviceSampleState& state) {
+#ifdef GPUTUNE_HAVE_NVML
+        static constexpr unsigned long long kSampleMaxAgeUs = 5000000; // Older than this reads as idle
+        static constexpr size_t kInitialCapacity = 64;
+        
+        GPUInfo& gpu = state.working;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        
+        if (state.process_scratch.empty()) state.process_scratch.resize(kInitialCapacity);
+        unsigned int count = static_cast<unsigned int>(state.process_scratch.size());
+        nvmlReturn_t result = nvml.DeviceGetComputeRunningProcesses(device, &count, state.process_scratch.data());
+        if (result == NVML_ERROR_INSUFFICIENT_SIZE) {
+            state.process_scratch.resize(count + count / 4 + 1); // Headroom for processes starting meanwhile
+            count = static_cast<unsigned int>(state.process_scratch.size());
+            result = nvml.DeviceGetComputeRunningProcesses(device, &count, state.process_scratch.data());
+        }
+        if (result != NVML_SUCCESS) {
+            gpu.processes.clear();
+            return;
+        }
+        
+        // Only samples taken since the last pass; the newest one per PID wins
+        if (state.process_samples.empty()) state.process_samples.resize(kInitialCapacity);
+        unsigned int sample_count = static_cast<unsigned int>(state.process_samples.size());
+        result = nvml.DeviceGetProcessUtilization(device, state.process_samples.data(), &sample_count,
+                                                  state.last_process_timestamp);
+        if (result == NVML_ERROR_INSUFFICIENT_SIZE) {
+            state.process_samples.resize(sample_count + sample_count / 4 + 1);
+            sample_count = static_cast<unsigned int>(state.process_samples.size());
+            result = nvml.DeviceGetProcessUtilization(device, state.process_samples.data(), &sample_count,
+                                                      state.last_process_timestamp);
+        }
+        if (result == NVML_SUCCESS) {
+            for (unsigned int i = 0; i < sample_count; i++) {
+                const nvmlProcessUtilizationSample_t& sample = state.process_samples[i];
+                DeviceSampleState::ProcessCacheEntry& entry = state.process_cache[sample.pid];
+                if (sample.timeStamp >= entry.sample_timestamp) {
+                    entry.sample_timestamp = sample.timeStamp;
+                    entry.sm_utilization = static_cast<int>(sample.smUtil);
+                    entry.memory_utilization = static_cast<int>(sample.memUtil);
+                    entry.encoder_utilization = static_cast<int>(sample.encUtil);
+                    entry.decoder_utilization = static_cast<int>(sample.decUtil);
+                }
+                state.last_process_timestamp = std::max(state.last_process_timestamp, sample.timeStamp);
+            }
+        }
+        
+        uint64_t pass = ++state.process_pass;
+        unsigned long long now_us = static_cast<unsigned long long>(wallClockMicros());
+        gpu.processes.resize(count);
+        for (unsigned int i = 0; i < count; i++) {
+            const nvmlProcessInfo_t& info = state.process_scratch[i];
+            DeviceSampleState::ProcessCacheEntry& entry = state.process_cache[info.pid];
+            entry.last_seen_pass = pass;
+            if (!entry.name_resolved) {
+                char name[256] = "";
+                if (nvml.SystemGetProcessName(info.pid, name, sizeof(name)) == NVML_SUCCESS) {
+                    const char* base = name; // NVML returns the full path on Linux
+                    for (const char* c = name; *c; c++) {
+                        if (*c == '/' || *c == '\\') base = c + 1;
+                    }
+                    entry.name = base;
+                }
+                entry.name_resolved = true; // Failures (e.g. another user's process) aren't retried
+            }
+            
+            GPUProcessInfo& process = gpu.processes[i];
+            process.pid = info.pid;
+            process.name = entry.name;
+            // NVML_VALUE_NOT_AVAILABLE (all ones) under WDDM, where memory isn't tracked per process
+            process.memory_used = info.usedGpuMemory == ~0ull ? 0 : static_cast<int>(info.usedGpuMemory / (1024 * 1024));
+            bool recent = entry.sample_timestamp + kSampleMaxAgeUs >= now_us;
+            process.sm_utilization = recent ? entry.sm_utilization : 0;
+            process.memory_utilization = recent ? entry.memory_utilization : 0;
+            process.encoder_utilization = recent ? entry.encoder_utilization : 0;
+            process.decoder_utilization = recent ? entry.decoder_utilization : 0;
+        }
+        std::sort(gpu.processes.begin(), gpu.processes.end(), [](const GPUProcessInfo& a, const GPUProcessInfo& b) {
+            return a.memory_used != b.memory_used ? a.memory_used > b.memory_used : a.pid < b.pid;
+        });
+        
+        // Forget exited processes, so a reused PID gets its name looked up again
+        for (auto it = state.process_cache.begin(); it != state.process_cache.end();) {
+            if (it->second.last_seen_pass != pass) {
+                it = state.process_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+#endif
+    }
+    
+    // One control loop step: curve -> hysteresis -> rate limit -> driver. Fans go
+    // back to the driver's automatic policy when control is switched off or the
+    // driver refuses a manual speed (no permission, unsupported board).
+    void runFanControl(DeviceSampleState& state, const FanCurveSettings& settings) {
+#ifdef GPUTUNE_HAVE_NVML
+        GPUInfo& gpu = state.working;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        auto now = std::chrono::steady_clock::now();
+        
+        if (!settings.enabled || state.fan_count == 0) {
+            if (state.fan_controller.isDriving()) {
+                restoreDefaultFanPolicy(state);
+            }
+            gpu.fan_control_active = false;
+            return;
+        }
+        
+        float elapsed = state.fan_controller.isDriving()
+            ? std::chrono::duration<float>(now - state.last_fan_tick).count() : 0.0f;
+        state.last_fan_tick = now;
+        
+        int speed = state.fan_controller.step(settings.curve, static_cast<float>(gpu.temperature), elapsed);
+        gpu.fan_control_target = speed;
+        if (!state.fan_controller.needsApply(speed)) return;
+        
+        for (unsigned int fan = 0; fan < state.fan_count; fan++) {
+            nvmlReturn_t result = nvml.DeviceSetFanSpeed_v2(device, fan, static_cast<unsigned int>(speed));
+            if (result != NVML_SUCCESS) {
+                std::cout << "Fan control disabled for " << gpu.name << ": " << nvml.ErrorString(result) << std::endl;
+                restoreDefaultFanPolicy(state);
+                {
+                    std::lock_guard<std::mutex> lock(state.control_mutex);
+                    state.requested_fan_curve.enabled = false;
+                }
+                gpu.fan_control_active = false;
+                return;
+            }
+        }
+        state.fan_controller.markApplied(speed);
+        gpu.fan_control_active = true;
+#endif
+    }
+    
+    void restoreDefaultFanPolicy(DeviceSampleState& state) {
+#ifdef GPUTUNE_HAVE_NVML
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        for (unsigned int fan = 0; fan < state.fan_count; fan++) {
+            nvml.DeviceSetDefaultFanSpeed_v2(device, fan);
+        }
+#endif
+        state.fan_controller.reset();
+    }
+    
+    // Hands every fan we are driving back to the driver. Only called while the
+    // sampler is parked; a device still stuck in a worker is left alone.
+    void releaseFanControl() {
+        for (const auto& state : device_states) {
+            if (state->busy || !state->fan_controller.isDriving()) continue;
+            restoreDefaultFanPolicy(*state);
+        }
+    }
+    
+    // Safe to call from any thread; the sampler picks it up on its next fan control tick
+    bool setFanCurve(size_t gpu_index, const int curve[kFanCurvePoints], bool enabled) {
+        if (gpu_index >= device_states.size()) return false;
+        DeviceSampleState& state = *device_states[gpu_index];
+        if (enabled && state.fan_count == 0) return false;
+        
+        std::lock_guard<std::mutex> lock(state.control_mutex);
+        state.requested_fan_curve.enabled = enabled;
+        std::copy(curve, curve + kFanCurvePoints, state.requested_fan_curve.curve);
+        return true;
+    }
+    
+    // The fan curve last handed to setFanCurve(), whether or not it is driving yet
+    bool getFanCurve(size_t gpu_index, FanCurveSettings& settings) {
+        if (gpu_index >= device_states.size()) return false;
+        DeviceSampleState& state = *device_states[gpu_index];
+        std::lock_guard<std::mutex> lock(state.control_mutex);
+        settings = state.requested_fan_curve;
+        return true;
+    }
+    
+    unsigned int getFanCount(size_t gpu_index) const {
+        return gpu_index < device_states.size() ? device_states[gpu_index]->fan_count : 0;
+    }
+    
+    // Runs on the sampler thread, or the UI thread while the sampler is parked.
+    // Each device is queried by its own pool task; devices whose task misses the
+    // sweep deadline keep their previous values and are flagged stale. A device
+    // still busy from an earlier sweep isn't queued again until it returns.
+    void updateAllGPUs(uint32_t group_mask = kAllMetricGroups, bool use_buffered = true) {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized) return;
+        
+        uint64_t sweep = ++sweep_id;
+        
+        if (!sampler_pool) {
+            for (size_t i = 0; i < device_states.size(); i++) {
+                updateGPUInfo(*device_states[i], group_mask, use_buffered);
+                sampled_gpus[i] = device_states[i]->working;
+            }
+            return;
+        }
+        
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(sweep_deadline_ms.load());
+        
+        std::vector<std::shared_ptr<DeviceSampleState>> queued;
+        for (const auto& state : device_states) {
+            if (!state->busy.exchange(true, std::memory_order_acquire)) {
+                queued.push_back(state);
+            }
+        }
+        
+        std::shared_ptr<CompletionLatch> latch = std::make_shared<CompletionLatch>(static_cast<int>(queued.size()));
+        for (const auto& state : queued) {
+            sampler_pool->submit([this, state, latch, sweep, group_mask, use_buffered] {
+                updateGPUInfo(*state, group_mask, use_buffered);
+                {
+                    std::lock_guard<std::mutex> lock(state->result_mutex);
+                    state->latest = state->working;
+                    state->latest_sweep = sweep;
+                }
+                state->busy.store(false, std::memory_order_release);
+                latch->countDown();
+            }, [state, latch] {
+                // Never ran (the pool was rebuilt); the device must not look hung forever
+                state->busy.store(false, std::memory_order_release);
+                latch->countDown();
+            });
+        }
+        latch->waitUntil(deadline);
+        
+        // Late results from an earlier sweep are still newer than what we have
+        for (size_t i = 0; i < device_states.size(); i++) {
+            DeviceSampleState& state = *device_states[i];
+            std::lock_guard<std::mutex> lock(state.result_mutex);
+            if (state.latest_sweep > state.merged_sweep) {
+                sampled_gpus[i] = state.latest;
+                state.merged_sweep = state.latest_sweep;
+            }
+            sampled_gpus[i].stale = state.latest_sweep != sweep;
+        }
+#endif
+    }
+    
+    std::chrono::milliseconds getSweepDeadline() const {
+        return std::chrono::milliseconds(sweep_deadline_ms.load());
+    }
+    
+    // How long a sweep waits for slow devices before publishing without them
+    void setSweepDeadline(std::chrono::milliseconds deadline) {
+        sweep_deadline_ms = std::max(10, static_cast<int>(deadline.count()));
+    }
+    
+    // Pulls all buffered samples newer than each cursor for the sources in group_mask,
+    // appends them to the history and updates the instantaneous values from the newest
+    // one. Returns the groups fully covered, which then don't need polling.
+    uint32_t ingestBufferedSamples(DeviceSampleState& state, uint32_t group_mask) {
+        uint32_t covered_mask = 0;
+#ifdef GPUTUNE_HAVE_NVML
+        uint32_t unsupported_mask = 0;
+        GPUInfo& gpu = state.working;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(state.handle);
+        
+        for (int i = 0; i < kBufferedSampleSourceCount; i++) {
+            const BufferedSampleSource& source = kBufferedSampleSources[i];
+            uint32_t group_bit = metricGroupBit(source.group);
+            if (!(group_mask & group_bit)) continue;
+            
+            BufferedSampleCursor& cursor = state.cursors[i];
+            if (cursor.capacity == 0) {
+                unsupported_mask |= group_bit;
+                continue;
+            }
+            covered_mask |= group_bit;
+            
+            nvmlValueType_t value_type;
+            unsigned int count = cursor.capacity;
+            nvmlReturn_t result = nvml.DeviceGetSamples(device, source.type, cursor.last_timestamp,
+                                                       &value_type, &count, state.scratch.data());
+            if (result != NVML_SUCCESS || count == 0) continue; // NVML_ERROR_NOT_FOUND: nothing new
+            
+            float latest = 0.0f;
+            bool received = false;
+            MetricHistory& history = (*state.history)[source.metric];
+            for (unsigned int s = 0; s < count; s++) {
+                const nvmlSample_t& sample = state.scratch[s];
+                if (sample.timeStamp <= cursor.last_timestamp) continue;
+                latest = sampleValue(sample.sampleValue, value_type) * source.scale;
+                history.append(static_cast<int64_t>(sample.timeStamp), latest);
+                cursor.last_timestamp = sample.timeStamp;
+                received = true;
+            }
+            if (!received) continue;
+            
+            switch (source.metric) {
+                case HistoryMetric::Power: gpu.power_usage = static_cast<int>(latest); break;
+                case HistoryMetric::GPUUtilization: gpu.gpu_utilization = static_cast<int>(latest); break;
+                case HistoryMetric::MemoryUtilization: gpu.memory_utilization = static_cast<int>(latest); break;
+                case HistoryMetric::CoreClock: gpu.core_clock = static_cast<int>(latest); break;
+                case HistoryMetric::MemoryClock: gpu.memory_clock = static_cast<int>(latest); break;
+                default: break;
+            }
+        }
+        covered_mask &= ~unsupported_mask;
+#endif
+        return covered_mask;
+    }
+    
+#ifdef GPUTUNE_HAVE_NVML
+    static float sampleValue(const nvmlValue_t& value, nvmlValueType_t type) {
+        switch (type) {
+            case NVML_VALUE_TYPE_DOUBLE: return static_cast<float>(value.dVal);
+            case NVML_VALUE_TYPE_UNSIGNED_INT: return static_cast<float>(value.uiVal);
+            case NVML_VALUE_TYPE_UNSIGNED_LONG: return static_cast<float>(value.ulVal);
+            case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG: return static_cast<float>(value.ullVal);
+            case NVML_VALUE_TYPE_SIGNED_LONG_LONG: return static_cast<float>(value.sllVal);
+            default: return static_cast<float>(value.uiVal);
+        }
+    }
+    
+    static unsigned long long counterValue(const nvmlValue_t& value, nvmlValueType_t type) {
+        switch (type) {
+            case NVML_VALUE_TYPE_DOUBLE: return value.dVal > 0.0 ? static_cast<unsigned long long>(value.dVal) : 0;
+            case NVML_VALUE_TYPE_UNSIGNED_INT: return value.uiVal;
+            case NVML_VALUE_TYPE_UNSIGNED_LONG: return value.ulVal;
+            case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG: return value.ullVal;
+            case NVML_VALUE_TYPE_SIGNED_LONG_LONG: return value.sllVal > 0 ? static_cast<unsigned long long>(value.sllVal) : 0;
+            default: return value.uiVal;
+        }
+    }
+#endif
+    
+    // Steps a cumulative counter to a new reading and updates its rate. NVML
+    // caches some counters, so a reading with the previous timestamp is skipped
+    // rather than read as zero traffic; a counter that went backwards was reset.
+    static void advanceCounter(InterconnectSlot& slot, unsigned long long value, int64_t timestamp_us) {
+        if (timestamp_us <= slot.last_timestamp_us) return;
+        if (slot.last_timestamp_us > 0 && value >= slot.last_value) {
+            double bytes = static_cast<double>(value - slot.last_value) * slot.bytes_per_unit;
+            slot.rate = static_cast<int>(bytes / (timestamp_us - slot.last_timestamp_us)); // Bytes per us = MB/s
+        }
+        slot.last_value = value;
+        slot.last_timestamp_us = timestamp_us;
+    }
+    
+    static int clampCount(unsigned long long value) {
+        return static_cast<int>(std::min<unsigned long long>(value, std::numeric_limits<int>::max()));
+    }
+    
+    static void recordSample(GPUHistory& history, HistoryMetric metric, int64_t timestamp_us, float value) {
+        history[metric].append(timestamp_us, value);
+    }
+    
+    // Copies the values of gpu_index's samples newer than since_us, oldest first.
+    // Lock-free; safe to call from the UI thread while the sampler is appending.
+    bool copyHistory(size_t gpu_index, HistoryMetric metric, int64_t since_us,
+                     std::vector<MetricSample>& scratch, std::vector<float>& out) const {
+        out.clear();
+        if (gpu_index >= histories.size()) return false;
+        (*histories[gpu_index])[metric].copySince(since_us, scratch, out);
+        return true;
+    }
+    
+    // The store itself, for readers that follow it incrementally; nullptr if out of range
+    const MetricHistory* history(size_t gpu_index, HistoryMetric metric) const {
+        if (gpu_index >= histories.size()) return nullptr;
+        return &(*histories[gpu_index])[metric];
+    }
+    
+    bool copyRollups(size_t gpu_index, HistoryMetric metric, int tier, int64_t since_us,
+                     std::vector<RollupBucket>& out) const {
+        out.clear();
+        if (gpu_index >= histories.size()) return false;
+        (*histories[gpu_index])[metric].copyRollups(tier, since_us, out);
+        return true;
+    }
+    
+    bool isBatchSampling() const { return batch_sampling; }
+    void setBatchSampling(bool enabled) { batch_sampling = enabled; }
+    
+    std::chrono::milliseconds getSampleInterval(MetricGroup group) const {
+        return std::chrono::milliseconds(sample_interval_ms[static_cast<int>(group)].load());
+    }
+    
+    // Safe to call from any thread; takes effect on the sampler's next wakeup
+    void setSampleInterval(MetricGroup group, std::chrono::milliseconds interval) {
+        int ms = std::max(10, static_cast<int>(interval.count()));
+        sample_interval_ms[static_cast<int>(group)] = ms;
+        rescheduled_groups |= metricGroupBit(group);
+        sampler_cv.notify_all();
+    }
+    
+    // Registers every device for the events NVML can deliver asynchronously and
+    // starts the thread waiting on them. Devices (or drivers) that support none
+    // are skipped; if none do, no thread is started.
+    void startEventWatcher() {
+#ifdef GPUTUNE_HAVE_NVML
+        static constexpr unsigned long long kWatchedEvents = nvmlEventTypeXidCriticalError |
+            nvmlEventTypeSingleBitEccError | nvmlEventTypeDoubleBitEccError | nvmlEventTypeClock;
+        
+        if (event_running || devices.empty()) return;
+        nvmlEventSet_t set;
+        if (nvml.EventSetCreate(&set) != NVML_SUCCESS) return;
+        
+        size_t registered = 0;
+        for (const GPUDevice& entry : devices) {
+            nvmlDevice_t device = static_cast<nvmlDevice_t>(entry.handle);
+            unsigned long long supported = 0;
+            if (nvml.DeviceGetSupportedEventTypes(device, &supported) != NVML_SUCCESS) continue;
+            unsigned long long types = supported & kWatchedEvents;
+            if (types && nvml.DeviceRegisterEvents(device, types, set) == NVML_SUCCESS) registered++;
+        }
+        if (registered == 0) {
+            nvml.EventSetFree(set);
+            return;
+        }
+        
+        event_set = set;
+        event_running = true;
+        event_thread = std::thread([this] { eventLoop(); });
+#endif
+    }
+    
+    void stopEventWatcher() {
+        event_running = false;
+        if (event_thread.joinable()) {
+            event_thread.join();
+        }
+#ifdef GPUTUNE_HAVE_NVML
+        if (event_set) {
+            nvml.EventSetFree(event_set);
+            event_set = nullptr;
+        }
+#endif
+    }
+    
+    // devices doesn't change while this runs: detectGPUs() stops the thread first
+    void eventLoop() {
+#ifdef GPUTUNE_HAVE_NVML
+        while (event_running) {
+            nvmlEventData_t data;
+            nvmlReturn_t result = nvml.EventSetWait(event_set, &data, kEventWaitMs);
+            if (result == NVML_ERROR_TIMEOUT) continue;
+            if (result != NVML_SUCCESS) {
+                // Don't spin on a persistent failure (e.g. a GPU fell off the bus)
+                std::this_thread::sleep_for(std::chrono::milliseconds(kEventWaitMs));
+                continue;
+            }
+            
+            size_t gpu_index = devices.size();
+            for (size_t i = 0; i < devices.size(); i++) {
+                if (devices[i].handle == static_cast<void*>(data.device)) gpu_index = i;
+            }
+            if (gpu_index == devices.size()) continue;
+            
+            int64_t now_us = wallClockMicros();
+            if (data.eventType & nvmlEventTypeClock) {
+                // Clocks moved: catch the reason now rather than at the next Clocks sample
+                unsigned long long reasons;
+                if (nvml.DeviceGetCurrentClocksThrottleReasons(data.device, &reasons) == NVML_SUCCESS) {
+                    event_log.recordThrottle(gpu_index, now_us, static_cast<uint32_t>(reasons) & kThrottleLimitingMask);
+                }
+                continue;
+            }
+            
+            GPUEvent event;
+            event.timestamp_us = now_us;
+            event.gpu_index = static_cast<uint16_t>(gpu_index);
+            if (data.eventType & nvmlEventTypeXidCriticalError) {
+                event.kind = GPUEventKind::XidError;
+                event.data = static_cast<uint32_t>(data.eventData);
+            } else if (data.eventType & nvmlEventTypeDoubleBitEccError) {
+                event.kind = GPUEventKind::EccDoubleBit;
+            } else if (data.eventType & nvmlEventTypeSingleBitEccError) {
+                event.kind = GPUEventKind::EccSingleBit;
+            } else {
+                continue;
+            }
+            event_log.append(event);
+        }
+#endif
+    }
+    
+    const GPUEventLog& events() const { return event_log; }
+    
+    // Threshold and rate rules, evaluated by the sampler after every sweep
+    AlertEngine& alerts() { return alert_engine; }
+    const AlertEngine& alerts() const { return alert_engine; }
+    
+    // formatGPUEvent(), with alert events described by their rule's text
+    void formatEvent(const GPUEvent& event, char* out, size_t size) const {
+        if (event.kind == GPUEventKind::Alert) {
+            alert_engine.describe(event, out, size);
+        } else {
+            formatGPUEvent(event, out, size);
+        }
+    }
+    
+    // Sampler thread only. Stale GPUs are skipped, so a device that missed the
+    // deadline neither fires nor clears alerts on old values.
+    void evaluateAlerts() {
+        if (!alert_engine.hasRules()) return;
+        alert_samples.resize(sampled_gpus.size());
+        for (size_t i = 0; i < sampled_gpus.size(); i++) {
+            const GPUInfo& gpu = sampled_gpus[i];
+            AlertEngine::Sample& sample = alert_samples[i];
+            float* values = sample.values;
+            sample.valid = !gpu.stale;
+            values[static_cast<int>(AlertMetric::Temperature)] = static_cast<float>(gpu.temperature);
+            values[static_cast<int>(AlertMetric::GPUUtilization)] = static_cast<float>(gpu.gpu_utilization);
+            values[static_cast<int>(AlertMetric::MemoryUtilization)] = static_cast<float>(gpu.memory_utilization);
+            values[static_cast<int>(AlertMetric::PowerUsage)] = static_cast<float>(gpu.power_usage);
+            values[static_cast<int>(AlertMetric::PowerPercent)] =
+                gpu.power_limit > 0 ? 100.0f * gpu.power_usage / gpu.power_limit : 0.0f;
+            values[static_cast<int>(AlertMetric::MemoryPercent)] =
+                gpu.memory_total > 0 ? 100.0f * gpu.memory_used / gpu.memory_total : 0.0f;
+            values[static_cast<int>(AlertMetric::CoreClock)] = static_cast<float>(gpu.core_clock);
+            values[static_cast<int>(AlertMetric::MemoryClock)] = static_cast<float>(gpu.memory_clock);
+            values[static_cast<int>(AlertMetric::FanSpeed)] = static_cast<float>(gpu.fan_speed);
+            values[static_cast<int>(AlertMetric::PcieTx)] = static_cast<float>(gpu.pcie_tx);
+            values[static_cast<int>(AlertMetric::PcieRx)] = static_cast<float>(gpu.pcie_rx);
+            values[static_cast<int>(AlertMetric::NvLinkTx)] = static_cast<float>(gpu.nvlink_tx);
+            values[static_cast<int>(AlertMetric::NvLinkRx)] = static_cast<float>(gpu.nvlink_rx);
+            values[static_cast<int>(AlertMetric::EncoderUtilization)] = static_cast<float>(gpu.encoder_utilization);
+            values[static_cast<int>(AlertMetric::DecoderUtilization)] = static_cast<float>(gpu.decoder_utilization);
+            values[static_cast<int>(AlertMetric::EccCorrected)] = static_cast<float>(gpu.ecc_corrected);
+            values[static_cast<int>(AlertMetric::EccUncorrected)] = static_cast<float>(gpu.ecc_uncorrected);
+        }
+        alert_engine.evaluate(alert_samples, wallClockMicros());
+    }
+    
+    LatencyHistogram& sweepLatency() { return sweep_latency; }
+    
+    // Calls visit(name, histogram) for every NVML entry point; nothing without NVML
+    template <typename Visitor>
+    void forEachNvmlCallLatency(Visitor&& visit) {
+#ifdef GPUTUNE_HAVE_NVML
+        nvml.forEachCallLatency(visit);
+#else
+        (void)visit;
+#endif
+    }
+    
+    // When the sweep last merged by pollSnapshot() was taken (default-constructed before the first)
+    std::chrono::steady_clock::time_point displayedSnapshotTime() const { return displayed_snapshot_time; }
+    
+    void startSampler() {
+        std::lock_guard<std::mutex> lock(sampler_mutex);
+        if (sampler_running) return;
+        sampler_running = true;
+        uint64_t generation = device_generation;
+        sampler_thread = std::thread([this, generation] { samplerLoop(generation); });
+    }
+    
+    void stopSampler() {
+        {
+            std::lock_guard<std::mutex> lock(sampler_mutex);
+            sampler_running = false;
+        }
+        sampler_cv.notify_all();
+        if (sampler_thread.joinable()) {
+            sampler_thread.join();
+        }
+    }
+    
+    void samplerLoop(uint64_t generation) {
+        auto interval_for = [this](MetricGroup group) { return getSampleInterval(group); };
+        
+        SampleScheduler scheduler;
+        scheduler.reset(SampleScheduler::Clock::now());
+        
+        std::unique_lock<std::mutex> lock(sampler_mutex);
+        while (sampler_running) {
+            lock.unlock();
+            
+            auto now = SampleScheduler::Clock::now();
+            if (uint32_t changed = rescheduled_groups.exchange(0)) {
+                scheduler.reschedule(changed, now, interval_for);
+            }
+            
+            uint32_t due_mask = scheduler.takeDue(now, interval_for);
+            if (due_mask) {
+                {
+                    ScopedLatencyTimer timer(sweep_latency);
+                    updateAllGPUs(due_mask);
+                    evaluateAlerts();
+                }
+                
+                MonitorSnapshot& snapshot = snapshot_buffer.writeBuffer();
+                snapshot.gpus = sampled_gpus;
+                snapshot.generation = generation;
+                snapshot.version = ++snapshot_version;
+                snapshot.timestamp = SampleScheduler::Clock::now();
+                snapshot.wall_time_us = wallClockMicros();
+                publishToSubscribers(snapshot);
+                snapshot_buffer.publish();
+                notifySnapshotListener();
+            }
+            
+            lock.lock();
+            sampler_cv.wait_until(lock, scheduler.nextDue(), [this] {
+                return !sampler_running || rescheduled_groups != 0;
+            });
+        }
+    }
+    
+    // Called on the sampler thread after every publish, so a UI that sleeps between
+    // events can wake up for new data. Must be cheap and safe to call from any
+    // thread. Once this returns, the previous listener is no longer being run.
+    void setSnapshotListener(std::function<void()> listener) {
+        std::lock_guard<std::mutex> lock(subscriber_mutex);
+        snapshot_listener = std::move(listener);
+    }
+    
+    void notifySnapshotListener() {
+        std::lock_guard<std::mutex> lock(subscriber_mutex);
+        if (snapshot_listener) {
+            snapshot_listener();
+        }
+    }
+    
+    // Returns a buffer that receives a copy of every sweep published from now on.
+    // The caller is its only consumer and may fetch() from any one thread;
+    // reading it never calls into NVML or holds up the sampler.
+    std::shared_ptr<SnapshotBuffer> subscribeSnapshots() {
+        std::shared_ptr<SnapshotBuffer> buffer = std::make_shared<SnapshotBuffer>();
+        std::lock_guard<std::mutex> lock(subscriber_mutex);
+        snapshot_subscribers.push_back(buffer);
+        return buffer;
+    }
+    
+    void unsubscribeSnapshots(const std::shared_ptr<SnapshotBuffer>& buffer) {
+        std::lock_guard<std::mutex> lock(subscriber_mutex);
+        snapshot_subscribers.erase(std::remove(snapshot_subscribers.begin(), snapshot_subscribers.end(), buffer),
+                                   snapshot_subscribers.end());
+    }
+    
+    // Sampler thread only; copies into each subscriber's back buffer, reusing its storage
+    void publishToSubscribers(const MonitorSnapshot& snapshot) {
+        std::lock_guard<std::mutex> lock(subscriber_mutex);
+        for (const auto& buffer : snapshot_subscribers) {
+            buffer->writeBuffer() = snapshot;
+            buffer->publish();
+        }
+    }
+    
+    // Called from the UI thread every frame. Never touches the driver: it only
+    // merges the latest published snapshot (if any) into the UI view, keeping the
+    // tuning targets the user is editing. Returns true when new data arrived.
+    bool pollSnapshot() {
+        if (!snapshot_buffer.fetch()) return false;
+        
+        const MonitorSnapshot& snapshot = snapshot_buffer.readBuffer();
+        if (snapshot.generation != device_generation || snapshot.gpus.size() != gpus.size()) {
+            return false; // Sweep from before the last detectGPUs()
+        }
+        
+        for (size_t i = 0; i < gpus.size(); i++) {
+            GPUInfo& view = gpus[i];
+            int target_core_clock = view.target_core_clock;
+            int target_memory_clock = view.target_memory_clock;
+            int target_power_limit = view.target_power_limit;
+            bool target_fan_control = view.target_fan_control;
+            int target_fan_curve[5];
+            std::copy(view.target_fan_curve, view.target_fan_curve + 5, target_fan_curve);
+            
+            view = snapshot.gpus[i];
+            
+            view.target_core_clock = target_core_clock;
+            view.target_memory_clock = target_memory_clock;
+            view.target_power_limit = target_power_limit;
+            view.target_fan_control = target_fan_control;
+            std::copy(target_fan_curve, target_fan_curve + 5, view.target_fan_curve);
+        }
+        displayed_snapshot_time = snapshot.timestamp;
+        return true;
+    }
+    
+    // Direct device controls for tools such as the auto-tuner and ProfileApplier.
+    // Callable from any thread (NVML is thread-safe) as long as the device set
+    // doesn't change meanwhile (detectGPUs() or applyRescan()).
+    size_t deviceCount() const { return devices.size(); }
+    
+    const GPUDevice* getDevice(size_t gpu_index) const {
+        return gpu_index < devices.size() ? &devices[gpu_index] : nullptr;
+    }
+    
+    // Supported memory clocks, highest first, or empty if the board doesn't report any
+    std::vector<unsigned int> getSupportedMemoryClocks(size_t gpu_index) const {
+        std::vector<unsigned int> clocks;
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return clocks;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(devices[gpu_index].handle);
+        unsigned int count = 0;
+        if (nvml.DeviceGetSupportedMemoryClocks(device, &count, nullptr) != NVML_ERROR_INSUFFICIENT_SIZE || count == 0) {
+            return clocks;
+        }
+        clocks.resize(count);
+        if (nvml.DeviceGetSupportedMemoryClocks(device, &count, clocks.data()) != NVML_SUCCESS) count = 0;
+        clocks.resize(count);
+        std::sort(clocks.begin(), clocks.end(), std::greater<unsigned int>());
+#endif
+        return clocks;
+    }
+    
+    // Graphics clocks supported together with memory_clock, highest first
+    std::vector<unsigned int> getSupportedGraphicsClocks(size_t gpu_index, unsigned int memory_clock) const {
+        std::vector<unsigned int> clocks;
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return clocks;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(devices[gpu_index].handle);
+        unsigned int count = 0;
+        if (nvml.DeviceGetSupportedGraphicsClocks(device, memory_clock, &count, nullptr) != NVML_ERROR_INSUFFICIENT_SIZE ||
+            count == 0) {
+            return clocks;
+        }
+        clocks.resize(count);
+        if (nvml.DeviceGetSupportedGraphicsClocks(device, memory_clock, &count, clocks.data()) != NVML_SUCCESS) count = 0;
+        clocks.resize(count);
+        std::sort(clocks.begin(), clocks.end(), std::greater<unsigned int>());
+#endif
+        return clocks;
+    }
+    
+    bool setApplicationClocks(size_t gpu_index, unsigned int memory_clock, unsigned int core_clock) {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return false;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(devices[gpu_index].handle);
+        return nvml.DeviceSetApplicationsClocks(device, memory_clock, core_clock) == NVML_SUCCESS;
+#endif
+        return false;
+    }
+    
+    // Application clocks currently in effect, for restoring them later
+    bool getApplicationClocks(size_t gpu_index, unsigned int& memory_clock, unsigned int& core_clock) const {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return false;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(devices[gpu_index].handle);
+        return nvml.DeviceGetApplicationsClock(device, NVML_CLOCK_MEM, &memory_clock) == NVML_SUCCESS &&
+               nvml.DeviceGetApplicationsClock(device, NVML_CLOCK_GRAPHICS, &core_clock) == NVML_SUCCESS;
+#endif
+        return false;
+    }
+    
+    bool resetApplicationClocks(size_t gpu_index) {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return false;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(devices[gpu_index].handle);
+        return nvml.DeviceResetApplicationsClocks(device) == NVML_SUCCESS;
+#endif
+        return false;
+    }
+    
+    // Clamped to the board's constraints
+    bool setPowerLimit(size_t gpu_index, unsigned int limit_mw) {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return false;
+        const GPUDevice& entry = devices[gpu_index];
+        limit_mw = std::max(entry.power_limit_min, std::min(limit_mw, entry.power_limit_max));
+        return nvml.DeviceSetPowerManagementLimit(static_cast<nvmlDevice_t>(entry.handle), limit_mw) == NVML_SUCCESS;
+#endif
+        return false;
+    }
+    
+    bool getPowerLimit(size_t gpu_index, unsigned int& limit_mw) const {
+#ifdef GPUTUNE_HAVE_NVML
+        if (!nvml_initialized || gpu_index >= devices.size()) return false;
+        nvmlDevice_t device = static_cast<nvmlDevice_t>(devices[gpu_index].handle);
+        return nvml.DeviceGetPowerManagementLimit(device, &limit_mw) == NVML_SUCCESS;
+#endif
+        return false;
+    }
+    
+    std::vector<GPUInfo>& getGPUs() { return gpus; }
+    bool isNVMLAvailable() const { return nvml_initialized; }
+    
+    // Bumped whenever the device set changes; lets the UI cache per-device data such as labels
+    uint64_t deviceGeneration() const { return device_generation; }
+};
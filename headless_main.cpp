@@ -0,0 +1,446 @@
+// Headless entry point for display-less nodes: runs GPUMonitor and its sampler
+// and reports snapshots on stdout, without creating a window or initializing
+// GLFW, OpenGL or ImGui. Links against the monitoring core only. Optionally
+// serves the same snapshots to Prometheus on /metrics.
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+#include "gpu_monitor.h"
+#include "metrics_exporter.h"
+#include "trace_file.h"
+#include "auto_tuner.h"
+#include "fleet.h"
+#include "profile_apply.h"
+#include "profile_store.h"
+#include "power_balancer.h"
+
+static std::atomic<bool> stop_requested{false};
+
+static void handleStopSignal(int) {
+    stop_requested = true;
+}
+
+struct HeadlessOptions {
+    int report_interval_ms = 1000;
+    long report_count = 0; // 0 = run until SIGINT/SIGTERM
+    bool csv = false;
+    bool quiet = false;  // No stdout reports, e.g. when only serving metrics
+    int metrics_port = 0; // 0 = exporter disabled
+    std::string metrics_address = "0.0.0.0";
+    std::string record_path; // Empty = no recording
+    int fleet_port = 0; // 0 = fleet agent disabled
+    std::string fleet_address = "0.0.0.0";
+    int fleet_interval_ms = 500;
+    bool autotune = false; // Search every GPU's most efficient settings, then exit
+    AutoTuneOptions autotune_options;
+    // Apply a profile to the selected GPUs, then exit
+    bool apply = false;
+    TuningProfile apply_profile;
+    DeviceSelector apply_selector;
+    bool apply_all_or_nothing = true;
+    std::string apply_profile_path; // Per-GPU profiles by UUID, instead of apply_profile
+    std::string apply_diff_path;    // Profile diff brought onto apply_profile_path's profiles first
+    // Write the diff that turns one profile file into another, then exit
+    std::string diff_base_path;
+    std::string diff_target_path;
+    std::string diff_output_path;
+    PowerBudgetOptions power_budget; // budget_w 0 = no node power budget
+    std::vector<std::string> alert_rules;
+};
+
+class HeadlessApp {
+private:
+    HeadlessOptions options;
+    GPUMonitor monitor;
+    MetricsExporter exporter{monitor};
+    TraceRecorder recorder{monitor};
+    AutoTuner tuner{monitor};
+    ProfileApplier applier{monitor};
+    PowerBalancer balancer{monitor};
+    FleetAgent agent{monitor};
+    std::vector<GPUEvent> events;
+    uint64_t last_event_sequence = 0;
+    
+public:
+    explicit HeadlessApp(const HeadlessOptions& opts) : options(opts) {}
+    
+    void printReport() {
+        const auto& gpus = monitor.getGPUs();
+        long long timestamp_ms = wallClockMicros() / 1000;
+        
+        for (size_t i = 0; i < gpus.size(); i++) {
+            const auto& gpu = gpus[i];
+            if (options.csv) {
+                std::printf("%lld,%zu,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+                            timestamp_ms, i, gpu.uuid.c_str(), gpu.temperature,
+                            gpu.gpu_utilization, gpu.memory_utilization,
+                            gpu.power_usage, gpu.power_limit,
+                            gpu.core_clock, gpu.memory_clock,
+                            gpu.memory_used, gpu.memory_total, gpu.fan_speed,
+                            gpu.pcie_tx, gpu.pcie_rx, gpu.nvlink_tx, gpu.nvlink_rx,
+                            gpu.encoder_utilization, gpu.decoder_utilization,
+                            gpu.ecc_corrected, gpu.ecc_uncorrected);
+            } else {
+                char throttle[96];
+                formatThrottleReasons(gpu.throttle_reasons & kThrottleLimitingMask, throttle, sizeof(throttle));
+                std::printf("[%lld] GPU %zu %s | %d C | util %d%% | mem util %d%% | %d/%d W | "
+                            "%d/%d MHz | %d/%d MB | fan %d%% | PCIe %d/%d MB/s | NVLink %d/%d MB/s | "
+                            "enc %d%% dec %d%% | ECC %d/%d%s%s%s\n",
+                            timestamp_ms, i, gpu.name.c_str(), gpu.temperature,
+                            gpu.gpu_utilization, gpu.memory_utilization,
+                            gpu.power_usage, gpu.power_limit,
+                            gpu.core_clock, gpu.memory_clock,
+                            gpu.memory_used, gpu.memory_total, gpu.fan_speed,
+                            gpu.pcie_tx, gpu.pcie_rx, gpu.nvlink_tx, gpu.nvlink_rx,
+                            gpu.encoder_utilization, gpu.decoder_utilization,
+                            gpu.ecc_corrected, gpu.ecc_uncorrected,
+                            throttle[0] ? " | limited by " : "", throttle,
+                            gpu.stale ? " (stale)" : "");
+            }
+        }
+        if (!options.csv) {
+            printEvents();
+        }
+        std::fflush(stdout);
+    }
+    
+    // Throttle transitions and XID/ECC events logged since the last report
+    void printEvents() {
+        monitor.events().copyAfter(last_event_sequence, events);
+        for (const GPUEvent& event : events) {
+            char text[128];
+            monitor.formatEvent(event, text, sizeof(text));
+            std::printf("[%lld] GPU %u event: %s\n", (long long)(event.timestamp_us / 1000), event.gpu_index, text);
+            last_event_sequence = std::max(last_event_sequence, event.sequence);
+        }
+    }
+    
+    static void printTrial(const char* label, const AutoTuneTrial& trial) {
+        std::printf("  %-8s core %s, memory %s, limit %u W: %.1f GFLOPS, %.1f W, %.2f GFLOPS/W, max %.0f C\n",
+                    label, trial.core_clock ? std::to_string(trial.core_clock).c_str() : "stock",
+                    trial.memory_clock ? std::to_string(trial.memory_clock).c_str() : "stock",
+                    trial.power_limit_mw / 1000, trial.gflops, trial.watts, trial.perf_per_watt,
+                    trial.max_temperature);
+    }
+    
+    // Tunes all GPUs at once (each has its own search thread) and prints the best points
+    int runAutoTune() {
+        const auto& gpus = monitor.getGPUs();
+        for (size_t i = 0; i < gpus.size(); i++) {
+            tuner.start(i, options.autotune_options);
+        }
+        
+        std::vector<std::string> last_status(gpus.size());
+        while (tuner.isAnyRunning()) {
+            if (stop_requested) tuner.cancelAll();
+            monitor.pollSnapshot();
+            for (size_t i = 0; i < gpus.size(); i++) {
+                std::string status = tuner.getStatus(i);
+                if (!options.quiet && status != last_status[i]) {
+                    std::printf("GPU %zu: %s\n", i, status.c_str());
+                    std::fflush(stdout);
+                    last_status[i] = status;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        tuner.wait();
+        
+        int exit_code = 0;
+        for (size_t i = 0; i < gpus.size(); i++) {
+            AutoTuneResult result = tuner.getResult(i);
+            std::printf("GPU %zu %s: %s\n", i, gpus[i].name.c_str(),
+                        result.complete ? "tuned" : result.error.empty() ? "cancelled" : result.error.c_str());
+            if (result.has_best) {
+                printTrial("stock", result.baseline);
+                printTrial("best", result.best);
+            }
+            if (!result.complete) exit_code = 1;
+        }
+        return exit_code;
+    }
+    
+    // Rebalances once per budget period; limit changes go to stderr so CSV on stdout stays clean
+    void updatePowerBudget() {
+        if (!balancer.isActive()) return;
+        monitor.pollSnapshot(); // The balancer reads the view, which only moves when polled
+        if (!balancer.update() || options.quiet) return;
+        const PowerBalanceStatus& status = balancer.status();
+        std::fprintf(stderr, "Power budget: limits %u / %u W, drawing %u W:", status.total_limit_w,
+                     options.power_budget.budget_w, status.total_usage_w);
+        for (size_t i = 0; i < status.limit_w.size(); i++) {
+            std::fprintf(stderr, " GPU %zu %u W (%s)", i, status.limit_w[i], powerDemandName(status.demand[i]));
+        }
+        std::fprintf(stderr, "%s\n", status.feasible ? "" : "; budget below the minimum limits");
+        if (!status.error.empty()) std::fprintf(stderr, "Power budget: %s\n", status.error.c_str());
+    }
+    
+    // Applies the profile from the command line and prints one line per GPU
+    int runApply() {
+        ProfileApplyReport report;
+        if (options.apply_profile_path.empty()) {
+            report = applier.apply(options.apply_profile, options.apply_selector, options.apply_all_or_nothing);
+        } else {
+            ProfileFile file;
+            std::string error;
+            if (!file.open(options.apply_profile_path, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            // With a diff, lookups go to an updated copy instead of the file itself
+            ProfileStore patched;
+            if (!options.apply_diff_path.empty()) {
+                MappedFile diff;
+                file.copyTo(patched);
+                if (!diff.open(options.apply_diff_path)) {
+                    std::cerr << "Cannot open " << options.apply_diff_path << std::endl;
+                    return 1;
+                }
+                if (!patched.applyDiff(diff.bytes(), diff.length(), error)) {
+                    std::cerr << options.apply_diff_path << ": " << error << std::endl;
+                    return 1;
+                }
+            }
+            const auto& gpus = monitor.getGPUs();
+            std::vector<std::pair<size_t, TuningProfile>> assignments;
+            for (size_t i = 0; i < gpus.size(); i++) {
+                const ProfileRecord* record =
+                    options.apply_diff_path.empty() ? file.find(gpus[i].uuid) : patched.find(gpus[i].uuid);
+                if (record && options.apply_selector.matches(i, gpus[i])) {
+                    assignments.emplace_back(i, profileFromRecord(*record));
+                }
+            }
+            report = applier.applyEach(assignments, options.apply_all_or_nothing);
+        }
+        for (const DeviceApplyResult& result : report.devices) {
+            std::printf("GPU %zu %s: %s%s%s%s\n", result.gpu_index, result.name.c_str(), applyOutcomeName(result.outcome),
+                        result.detail.empty() ? "" : " - ", result.detail.c_str(),
+                        result.rollback_incomplete ? " (could not restore previous settings)" : "");
+        }
+        std::printf("Applied to %zu of %zu GPUs in %.1f ms\n", report.applied, report.devices.size(), report.duration_ms);
+        if (report.devices.empty()) {
+            std::cerr << "No GPU matches the selection" << std::endl;
+        }
+        return report.succeeded() ? 0 : 1;
+    }
+    
+    int run() {
+        if (monitor.getGPUs().empty()) {
+            std::cerr << "No NVIDIA GPUs detected or NVML not available" << std::endl;
+            return 1;
+        }
+        
+        if (options.autotune) {
+            return runAutoTune();
+        }
+        
+        if (options.apply) {
+            return runApply();
+        }
+        
+        std::string alert_error;
+        if (!options.alert_rules.empty() && !monitor.alerts().setRules(options.alert_rules, alert_error)) {
+            std::cerr << "Invalid --alert rule: " << alert_error << std::endl;
+            return 2;
+        }
+        
+        if (options.metrics_port > 0 && !exporter.start(options.metrics_address, options.metrics_port)) {
+            return 1;
+        }
+        
+        if (!options.record_path.empty() && !recorder.start(options.record_path)) {
+            return 1;
+        }
+        
+        if (options.fleet_port > 0 &&
+            !agent.start(options.fleet_address, options.fleet_port, options.fleet_interval_ms)) {
+            return 1;
+        }
+        
+        if (options.power_budget.budget_w > 0) {
+            balancer.start(options.power_budget);
+        }
+        
+        if (options.csv && !options.quiet) {
+            std::printf("timestamp_ms,gpu,uuid,temperature_c,gpu_util_pct,mem_util_pct,"
+                        "power_w,power_limit_w,core_clock_mhz,mem_clock_mhz,"
+                        "mem_used_mb,mem_total_mb,fan_pct,pcie_tx_mbps,pcie_rx_mbps,nvlink_tx_mbps,nvlink_rx_mbps,"
+                        "encoder_util_pct,decoder_util_pct,ecc_corrected,ecc_uncorrected\n");
+        }
+        
+        long reports = 0;
+        auto next_report = std::chrono::steady_clock::now();
+        while (!stop_requested) {
+            monitor.applyRescan(true); // Hot-plugged or lost GPUs, found by the monitor's probe
+            monitor.pollSnapshot();
+            if (!options.quiet) {
+                printReport();
+            }
+            
+            if (options.report_count > 0 && ++reports >= options.report_count) break;
+            
+            // Sleep in short steps so SIGINT/SIGTERM stop us promptly
+            next_report += std::chrono::milliseconds(options.report_interval_ms);
+            while (!stop_requested && std::chrono::steady_clock::now() < next_report) {
+                updatePowerBudget();
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+        balancer.stop(); // Puts the original limits back
+        return 0;
+    }
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --interval <ms>   Report period in milliseconds (default 1000)\n"
+              << "  --count <n>       Stop after n reports (default: run until signalled)\n"
+              << "  --csv             Print CSV instead of human-readable lines\n"
+              << "  --quiet           Don't print reports (useful with --metrics-port)\n"
+              << "  --metrics-port <port>    Serve Prometheus metrics on http://<address>:<port>/metrics\n"
+              << "  --metrics-address <ip>   Address the exporter binds to (default 0.0.0.0)\n"
+              << "  --record <file>   Append every sweep to a binary recording (replay it in the GUI)\n"
+              << "  --fleet-port <port>      Stream snapshots to fleet collectors (the GUI's Tools > Fleet)\n"
+              << "  --fleet-address <ip>     Address the fleet agent binds to (default 0.0.0.0)\n"
+              << "  --fleet-interval <ms>    Fleet update period in milliseconds (default 500)\n"
+              << "  --autotune        Search each GPU's most efficient clocks and power limit, then exit\n"
+              << "  --autotune-trial <s>     Seconds per auto-tune trial (default 3)\n"
+              << "  --autotune-temp-limit <C> Abort trials at this temperature (default 83)\n"
+              << "  --power-limit <%>        Set the power limit (percent of board maximum) on the selected GPUs, then exit\n"
+              << "  --clocks <core>,<mem>    Set application clocks (MHz) on the selected GPUs, then exit\n"
+              << "  --apply-profile <file>   Apply each GPU's profile from an exported profile file, then exit\n"
+              << "  --profile-diff <file>    With --apply-profile: bring the profiles up to date with a diff first\n"
+              << "  --make-profile-diff <base> <new> <out>  Write the diff that turns profile file base into new, then exit\n"
+              << "  --select <text>   Only apply to GPUs whose name contains text (default: all)\n"
+              << "  --best-effort     Keep the GPUs that succeeded when others fail (default: undo all)\n"
+              << "  --power-budget <W>       Keep the sum of all power limits within W, moving headroom to busy GPUs\n"
+              << "  --power-period <s>       Seconds between power budget rebalances (default 2)\n"
+              << "  --alert <rule>    Log an event when a rule fires, e.g. \"temp > 85 for 30s\" or \"power spike > 20%/s\"\n"
+              << "                    (repeatable; metrics: " << alertMetricList() << ")\n"
+              << "  --help            Show this help\n";
+}
+
+static bool parseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        
+        if (std::strcmp(arg, "--interval") == 0 && has_value) {
+            options.report_interval_ms = std::max(10, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--count") == 0 && has_value) {
+            options.report_count = std::max(0L, std::atol(argv[++i]));
+        } else if (std::strcmp(arg, "--csv") == 0) {
+            options.csv = true;
+        } else if (std::strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        } else if (std::strcmp(arg, "--metrics-port") == 0 && has_value) {
+            options.metrics_port = std::atoi(argv[++i]);
+            if (options.metrics_port <= 0 || options.metrics_port > 65535) return false;
+        } else if (std::strcmp(arg, "--metrics-address") == 0 && has_value) {
+            options.metrics_address = argv[++i];
+        } else if (std::strcmp(arg, "--record") == 0 && has_value) {
+            options.record_path = argv[++i];
+        } else if (std::strcmp(arg, "--fleet-port") == 0 && has_value) {
+            options.fleet_port = std::atoi(argv[++i]);
+            if (options.fleet_port <= 0 || options.fleet_port > 65535) return false;
+        } else if (std::strcmp(arg, "--fleet-address") == 0 && has_value) {
+            options.fleet_address = argv[++i];
+        } else if (std::strcmp(arg, "--fleet-interval") == 0 && has_value) {
+            options.fleet_interval_ms = std::max(10, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--autotune") == 0) {
+            options.autotune = true;
+        } else if (std::strcmp(arg, "--autotune-trial") == 0 && has_value) {
+            options.autotune_options.trial_seconds = std::max(0.5, std::atof(argv[++i]));
+        } else if (std::strcmp(arg, "--autotune-temp-limit") == 0 && has_value) {
+            options.autotune_options.temperature_limit_c = std::max(40, std::atoi(argv[++i]));
+        } else if (std::strcmp(arg, "--power-limit") == 0 && has_value) {
+            options.apply_profile.power_limit_percent = std::atoi(argv[++i]);
+            if (options.apply_profile.power_limit_percent <= 0) return false;
+            options.apply = true;
+        } else if (std::strcmp(arg, "--clocks") == 0 && has_value) {
+            unsigned int core = 0, memory = 0;
+            if (std::sscanf(argv[++i], "%u,%u", &core, &memory) != 2 || core == 0 || memory == 0) return false;
+            options.apply_profile.core_clock = core;
+            options.apply_profile.memory_clock = memory;
+            options.apply = true;
+        } else if (std::strcmp(arg, "--apply-profile") == 0 && has_value) {
+            options.apply_profile_path = argv[++i];
+            options.apply = true;
+        } else if (std::strcmp(arg, "--profile-diff") == 0 && has_value) {
+            options.apply_diff_path = argv[++i];
+        } else if (std::strcmp(arg, "--make-profile-diff") == 0 && i + 3 < argc) {
+            options.diff_base_path = argv[++i];
+            options.diff_target_path = argv[++i];
+            options.diff_output_path = argv[++i];
+        } else if (std::strcmp(arg, "--select") == 0 && has_value) {
+            options.apply_selector.name_filter = argv[++i];
+        } else if (std::strcmp(arg, "--best-effort") == 0) {
+            options.apply_all_or_nothing = false;
+        } else if (std::strcmp(arg, "--power-budget") == 0 && has_value) {
+            int budget_w = std::atoi(argv[++i]);
+            if (budget_w <= 0) return false;
+            options.power_budget.budget_w = static_cast<unsigned int>(budget_w);
+        } else if (std::strcmp(arg, "--alert") == 0 && has_value) {
+            options.alert_rules.push_back(argv[++i]);
+        } else if (std::strcmp(arg, "--power-period") == 0 && has_value) {
+            options.power_budget.period_seconds = std::max(0.1, std::atof(argv[++i]));
+        } else {
+            return false;
+        }
+    }
+    return options.apply_diff_path.empty() || !options.apply_profile_path.empty();
+}
+
+// Handles --make-profile-diff; needs no GPUs
+static int writeProfileDiff(const HeadlessOptions& options) {
+    ProfileFile base_file, target_file;
+    std::string error;
+    if (!base_file.open(options.diff_base_path, error) || !target_file.open(options.diff_target_path, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    ProfileStore base, target;
+    base_file.copyTo(base);
+    target_file.copyTo(target);
+    std::vector<uint8_t> diff;
+    target.encodeDiff(base, diff);
+    if (!writeFileReplacing(options.diff_output_path, diff, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::printf("Wrote %zu-byte diff from revision %llu to %llu\n", diff.size(),
+                (unsigned long long)base.getRevision(), (unsigned long long)target.getRevision());
+    return 0;
+}
+
+// Entry point
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return argc > 1 && std::strcmp(argv[1], "--help") == 0 ? 0 : 2;
+    }
+    
+    if (!options.diff_output_path.empty()) {
+        return writeProfileDiff(options);
+    }
+    
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    
+    try {
+        HeadlessApp app(options);
+        return app.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <imgui.h>
+#include <GL/gl3w.h>
+
+#include "metric_history.h"
+
+// History charts drawn straight from GPU memory instead of ImGui::PlotLines.
+// Each chart mirrors one MetricHistory (raw samples or one rollup tier) in a
+// persistent ring-buffer VBO: a frame uploads only the records appended since
+// the previous one, and each series is a single glDrawArrays issued from an
+// ImGui draw callback. The ring is stored twice (slot i and i + capacity) so
+// any window of up to capacity records is contiguous in the buffer.
+//
+// Needs the GL 3.3 core context to be current. GL objects are created lazily;
+// call release() while the context is still alive.
+class HistoryPlotter {
+private:
+    // Per vertex: value, or for rollups two vertices per bucket {min, mean} {max, mean}
+    static constexpr int kSampleFloats = 1;
+    static constexpr int kBucketFloats = 4;
+    
+    struct Series {
+        HistoryPlotter* owner = nullptr;
+        GLuint buffer = 0;
+        GLuint line_array = 0; // Sample value, or bucket mean
+        GLuint band_array = 0; // Bucket min/max as a triangle strip
+        uint64_t source_id = 0;
+        int tier = -2;         // -1 for raw samples
+        size_t capacity = 0;
+        uint64_t oldest = 0;   // Source index range mirrored in the ring
+        uint64_t uploaded = 0;
+        std::vector<int64_t> timestamps; // Ring-indexed, for windowing and hover
+        std::vector<float> values;
+        
+        // What the draw callback renders this frame
+        uint64_t window_first = 0; // Source index of the first record shown
+        GLint first = 0;
+        GLsizei count = 0;
+        float scale_max = 1.0f;
+        ImVec4 line_color;
+        ImVec4 band_color;
+        ImVec2 rect_min;
+        ImVec2 rect_max;
+    };
+    
+    Series series[kHistoryMetricCount];
+    std::vector<MetricSample> sample_scratch;
+    std::vector<RollupBucket> bucket_scratch;
+    std::vector<float> upload_scratch;
+    
+    GLuint program = 0;
+    bool program_failed = false;
+    GLint first_location = -1;
+    GLint span_location = -1;
+    GLint divisor_location = -1;
+    GLint scale_location = -1;
+    GLint color_location = -1;
+    
+    static GLuint compileShader(GLenum type, const char* source) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint ok = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+        if (!ok) {
+            char log[512] = "";
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cerr << "History plot shader failed to compile: " << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+    
+    bool ensureProgram() {
+        if (program) return true;
+        if (program_failed) return false;
+        
+        // x comes from the vertex's position in the window, so only values are stored
+        static const char* kVertexShader =
+            "#version 330 core\n"
+            "layout(location = 0) in float value;\n"
+            "uniform float u_first;\n"
+            "uniform float u_span;\n"
+            "uniform float u_divisor;\n"
+            "uniform float u_scale;\n"
+            "void main() {\n"
+            "    float index = floor(float(gl_VertexID) / u_divisor) - u_first;\n"
+            "    float x = u_span > 0.0 ? index / u_span : 0.0;\n"
+            "    float y = clamp(value / u_scale, 0.0, 1.0);\n"
+            "    gl_Position = vec4(x * 2.0 - 1.0, y * 2.0 - 1.0, 0.0, 1.0);\n"
+            "}\n";
+        static const char* kFragmentShader =
+            "#version 330 core\n"
+            "uniform vec4 u_color;\n"
+            "out vec4 frag_color;\n"
+            "void main() {\n"
+            "    frag_color = u_color;\n"
+            "}\n";
+        
+        program_failed = true; // Until proven otherwise; don't retry every frame
+        GLuint vertex = compileShader(GL_VERTEX_SHADER, kVertexShader);
+        GLuint fragment = compileShader(GL_FRAGMENT_SHADER, kFragmentShader);
+        if (!vertex || !fragment) {
+            if (vertex) glDeleteShader(vertex);
+            if (fragment) glDeleteShader(fragment);
+            return false;
+        }
+        
+        GLuint linked = glCreateProgram();
+        glAttachShader(linked, vertex);
+        glAttachShader(linked, fragment);
+        glLinkProgram(linked);
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        GLint ok = GL_FALSE;
+        glGetProgramiv(linked, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            std::cerr << "History plot shader failed to link" << std::endl;
+            glDeleteProgram(linked);
+            return false;
+        }
+        
+        program = linked;
+        program_failed = false;
+        first_location = glGetUniformLocation(program, "u_first");
+        span_location = glGetUniformLocation(program, "u_span");
+        divisor_location = glGetUniformLocation(program, "u_divisor");
+        scale_location = glGetUniformLocation(program, "u_scale");
+        color_location = glGetUniformLocation(program, "u_color");
+        return true;
+    }
+    
+    static void releaseSeries(Series& s) {
+        if (s.buffer) glDeleteBuffers(1, &s.buffer);
+        if (s.line_array) glDeleteVertexArrays(1, &s.line_array);
+        if (s.band_array) glDeleteVertexArrays(1, &s.band_array);
+        s.buffer = s.line_array = s.band_array = 0;
+        s.source_id = 0;
+        s.tier = -2;
+        s.oldest = s.uploaded = 0;
+    }
+    
+    // Points the series at a new source: reallocates the VBO and starts the mirror over
+    void resetSeries(Series& s, const MetricHistory& history, int tier) {
+        if (!s.buffer) {
+            glGenBuffers(1, &s.buffer);
+            glGenVertexArrays(1, &s.line_array);
+            glGenVertexArrays(1, &s.band_array);
+        }
+        s.owner = this;
+        s.source_id = history.id();
+        s.tier = tier;
+        s.capacity = tier < 0 ? kHistoryCapacity : kRollupCapacity;
+        s.oldest = s.uploaded = 0;
+        s.timestamps.assign(s.capacity, 0);
+        s.values.assign(s.capacity, 0.0f);
+        
+        int floats = tier < 0 ? kSampleFloats : kBucketFloats;
+        glBindBuffer(GL_ARRAY_BUFFER, s.buffer);
+        glBufferData(GL_ARRAY_BUFFER, 2 * s.capacity * floats * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        
+        glBindVertexArray(s.line_array);
+        glEnableVertexAttribArray(0);
+        if (tier < 0) {
+            glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), nullptr);
+        } else {
+            glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, kBucketFloats * sizeof(float),
+                                  reinterpret_cast<const void*>(sizeof(float)));
+            glBindVertexArray(s.band_array);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+        }
+        glBindVertexArray(0);
+    }
+    
+    // Uploads the records appended to the source since the last call
+    void sync(Series& s, const MetricHistory& history, int tier) {
+        if (s.source_id != history.id() || s.tier != tier) resetSeries(s, history, tier);
+        
+        uint64_t available = tier < 0 ? history.sampleCount() : history.rollupCount(tier);
+        if (available == s.uploaded) return;
+        
+        int floats = tier < 0 ? kSampleFloats : kBucketFloats;
+        uint64_t begin = 0;
+        size_t count;
+        if (tier < 0) {
+            sample_scratch.resize(kHistoryCapacity);
+            count = history.copySamplesFrom(s.uploaded, sample_scratch.data(), sample_scratch.size(), begin);
+        } else {
+            bucket_scratch.resize(kRollupCapacity);
+            count = history.copyRollupsFrom(tier, s.uploaded, bucket_scratch.data(), bucket_scratch.size(), begin);
+        }
+        
+        uint64_t end = begin + count;
+        if (begin > s.uploaded) {
+            s.oldest = begin; // The source lapped us; older mirrored records no longer connect
+        } else if (end > s.capacity) {
+            s.oldest = std::max(s.oldest, end - s.capacity);
+        }
+        
+        // At most two runs: up to the end of the ring, then from its start
+        glBindBuffer(GL_ARRAY_BUFFER, s.buffer);
+        size_t done = 0;
+        while (done < count) {
+            size_t slot = static_cast<size_t>((begin + done) % s.capacity);
+            size_t run = std::min(count - done, s.capacity - slot);
+            upload_scratch.resize(run * floats);
+            for (size_t i = 0; i < run; i++) {
+                size_t ring_slot = slot + i;
+                if (tier < 0) {
+                    const MetricSample& sample = sample_scratch[done + i];
+                    s.timestamps[ring_slot] = sample.timestamp_us;
+                    s.values[ring_slot] = sample.value;
+                    upload_scratch[i] = sample.value;
+                } else {
+                    const RollupBucket& bucket = bucket_scratch[done + i];
+                    s.timestamps[ring_slot] = bucket.start_us;
+                    s.values[ring_slot] = bucket.mean;
+                    float* out = &upload_scratch[i * kBucketFloats];
+                    out[0] = bucket.min;
+                    out[1] = bucket.mean;
+                    out[2] = bucket.max;
+                    out[3] = bucket.mean;
+                }
+            }
+            GLsizeiptr bytes = static_cast<GLsizeiptr>(run * floats * sizeof(float));
+            GLintptr offset = static_cast<GLintptr>(slot * floats * sizeof(float));
+            GLintptr mirror = static_cast<GLintptr>((slot + s.capacity) * floats * sizeof(float));
+            glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, upload_scratch.data());
+            glBufferSubData(GL_ARRAY_BUFFER, mirror, bytes, upload_scratch.data());
+            done += run;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        s.uploaded = end;
+    }
+    
+    // Oldest mirrored record newer than since_us (timestamps only grow)
+    static uint64_t firstAfter(const Series& s, int64_t since_us) {
+        uint64_t low = s.oldest;
+        uint64_t high = s.uploaded;
+        while (low < high) {
+            uint64_t mid = low + (high - low) / 2;
+            if (s.timestamps[mid % s.capacity] > since_us) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+    
+    static void drawCallback(const ImDrawList*, const ImDrawCmd* cmd) {
+        const Series& s = *static_cast<const Series*>(cmd->UserCallbackData);
+        const HistoryPlotter& plotter = *s.owner;
+        const ImDrawData* data = ImGui::GetDrawData();
+        
+        // ImGui coordinates are top-left based; GL's are bottom-left framebuffer pixels
+        ImVec2 scale = data->FramebufferScale;
+        float framebuffer_height = data->DisplaySize.y * scale.y;
+        auto toFramebufferX = [&](float x) { return (x - data->DisplayPos.x) * scale.x; };
+        auto toFramebufferY = [&](float y) { return framebuffer_height - (y - data->DisplayPos.y) * scale.y; };
+        
+        float clip_x0 = toFramebufferX(cmd->ClipRect.x);
+        float clip_y0 = toFramebufferY(cmd->ClipRect.w);
+        float clip_x1 = toFramebufferX(cmd->ClipRect.z);
+        float clip_y1 = toFramebufferY(cmd->ClipRect.y);
+        if (clip_x1 <= clip_x0 || clip_y1 <= clip_y0) return;
+        glScissor(static_cast<GLint>(clip_x0), static_cast<GLint>(clip_y0),
+                  static_cast<GLsizei>(clip_x1 - clip_x0), static_cast<GLsizei>(clip_y1 - clip_y0));
+        
+        float x0 = toFramebufferX(s.rect_min.x);
+        float y0 = toFramebufferY(s.rect_max.y);
+        glViewport(static_cast<GLint>(std::lround(x0)), static_cast<GLint>(std::lround(y0)),
+                   static_cast<GLsizei>(std::lround((s.rect_max.x - s.rect_min.x) * scale.x)),
+                   static_cast<GLsizei>(std::lround((s.rect_max.y - s.rect_min.y) * scale.y)));
+        
+        glUseProgram(plotter.program);
+        glUniform1f(plotter.first_location, static_cast<float>(s.first));
+        glUniform1f(plotter.span_location, static_cast<float>(s.count - 1));
+        glUniform1f(plotter.scale_location, s.scale_max);
+        
+        if (s.tier >= 0) {
+            glUniform1f(plotter.divisor_location, 2.0f);
+            glUniform4f(plotter.color_location, s.band_color.x, s.band_color.y, s.band_color.z, s.band_color.w);
+            glBindVertexArray(s.band_array);
+            glDrawArrays(GL_TRIANGLE_STRIP, s.first * 2, s.count * 2);
+        }
+        glUniform1f(plotter.divisor_location, 1.0f);
+        glUniform4f(plotter.color_location, s.line_color.x, s.line_color.y, s.line_color.z, s.line_color.w);
+        glBindVertexArray(s.line_array);
+        glDrawArrays(GL_LINE_STRIP, s.first, s.count);
+    }
+    
+public:
+    HistoryPlotter() = default;
+    HistoryPlotter(const HistoryPlotter&) = delete;
+    HistoryPlotter& operator=(const HistoryPlotter&) = delete;
+    
+    // Chart of the part of history newer than since_us, as an ImGui item of
+    // the given size: raw samples when tier < 0, else that rollup tier's means
+    // over a min/max band. history may be nullptr (empty chart).
+    void draw(HistoryMetric metric, const MetricHistory* history, int tier, int64_t since_us, float scale_max,
+              const ImVec4& line_color, const ImVec4& band_color, const ImVec2& size) {
+        const ImGuiStyle& style = ImGui::GetStyle();
+        ImVec2 frame_min = ImGui::GetCursorScreenPos();
+        ImVec2 frame_max(frame_min.x + size.x, frame_min.y + size.y);
+        ImGui::Dummy(size);
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        draw_list->AddRectFilled(frame_min, frame_max, ImGui::GetColorU32(ImGuiCol_FrameBg), style.FrameRounding);
+        
+        Series& s = series[static_cast<int>(metric)];
+        s.count = 0;
+        if (!history || scale_max <= 0.0f || !ensureProgram()) return;
+        
+        sync(s, *history, tier);
+        uint64_t first = firstAfter(s, since_us);
+        if (s.uploaded - first < 2) return;
+        
+        s.window_first = first;
+        s.first = static_cast<GLint>(first % s.capacity);
+        s.count = static_cast<GLsizei>(s.uploaded - first);
+        s.scale_max = scale_max;
+        s.line_color = line_color;
+        s.band_color = band_color;
+        s.rect_min = ImVec2(frame_min.x + style.FramePadding.x, frame_min.y + style.FramePadding.y);
+        s.rect_max = ImVec2(frame_max.x - style.FramePadding.x, frame_max.y - style.FramePadding.y);
+        draw_list->AddCallback(&HistoryPlotter::drawCallback, &s);
+        draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+        
+        if (ImGui::IsItemHovered() && s.rect_max.x > s.rect_min.x) {
+            float t = (ImGui::GetIO().MousePos.x - s.rect_min.x) / (s.rect_max.x - s.rect_min.x);
+            t = std::min(std::max(t, 0.0f), 1.0f);
+            uint64_t index = first + static_cast<uint64_t>(std::lround(t * (s.count - 1)));
+            ImGui::SetTooltip("%.1f", s.values[index % s.capacity]);
+        }
+    }
+    
+    // Largest value on the chart drawn for metric this frame, 0 if it was empty.
+    // Lets callers scale metrics that have no fixed maximum.
+    float windowPeak(HistoryMetric metric) const {
+        const Series& s = series[static_cast<int>(metric)];
+        float peak = 0.0f;
+        for (GLsizei i = 0; i < s.count; i++) {
+            peak = std::max(peak, s.values[(s.window_first + i) % s.capacity]);
+        }
+        return peak;
+    }
+    
+    // Screen x of timestamp_us on the chart drawn for metric this frame, or -1
+    // if it falls outside what's shown. Lets callers overlay markers.
+    float timeToX(HistoryMetric metric, int64_t timestamp_us) const {
+        const Series& s = series[static_cast<int>(metric)];
+        if (s.count < 2) return -1.0f;
+        uint64_t last = s.window_first + s.count - 1;
+        if (timestamp_us < s.timestamps[s.window_first % s.capacity] ||
+            timestamp_us > s.timestamps[last % s.capacity]) return -1.0f;
+        
+        uint64_t low = s.window_first;
+        uint64_t high = last;
+        while (low < high) { // First record at or after timestamp_us
+            uint64_t mid = low + (high - low) / 2;
+            if (s.timestamps[mid % s.capacity] < timestamp_us) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        float t = static_cast<float>(low - s.window_first) / (s.count - 1);
+        return s.rect_min.x + (s.rect_max.x - s.rect_min.x) * t;
+    }
+    
+    // Frees the GL objects; the context must still be current
+    void release() {
+        for (Series& s : series) {
+            releaseSeries(s);
+        }
+        if (program) glDeleteProgram(program);
+        program = 0;
+    }
+};
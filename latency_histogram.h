@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Lock-free log-linear latency histogram in nanoseconds, HDR style: every power
+// of two is split into 8 linear sub-buckets, so any recorded value lands in a
+// bucket at most 12.5% wider than itself. Any number of threads may record()
+// concurrently (relaxed atomic increments, no locks) while others summarize().
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40; // 2^41 ns is ~37 minutes; longer values clamp
+    static constexpr int kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+    
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t p50_ns = 0; // Upper bound of the bucket holding the percentile
+        uint64_t p99_ns = 0;
+        uint64_t max_ns = 0; // Exact
+    };
+    
+private:
+    std::atomic<uint64_t> buckets[kBucketCount];
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    
+    static int highestBit(uint64_t value) {
+        int bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+    }
+    
+    static int bucketIndex(uint64_t ns) {
+        if (ns < kSubBuckets) return static_cast<int>(ns);
+        int exponent = highestBit(ns);
+        if (exponent > kMaxExponent) return kBucketCount - 1;
+        int sub_bucket = static_cast<int>((ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+        return (exponent - kSubBucketBits + 1) * kSubBuckets + sub_bucket;
+    }
+    
+    // Largest value that maps to the bucket
+    static uint64_t bucketUpperBound(int index) {
+        if (index < kSubBuckets) return static_cast<uint64_t>(index);
+        int exponent = index / kSubBuckets + kSubBucketBits - 1;
+        uint64_t sub_bucket = static_cast<uint64_t>(index % kSubBuckets);
+        uint64_t width = 1ull << (exponent - kSubBucketBits);
+        return (1ull << exponent) + (sub_bucket + 1) * width - 1;
+    }
+    
+public:
+    LatencyHistogram() { reset(); }
+    
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+    
+    void record(uint64_t ns) {
+        buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t previous = max_ns.load(std::memory_order_relaxed);
+        while (ns > previous && !max_ns.compare_exchange_weak(previous, ns, std::memory_order_relaxed)) {
+        }
+    }
+    
+    // Not atomic with respect to concurrent record()s, which may land either side
+    void reset() {
+        for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        sum_ns.store(0, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+    }
+    
+    uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    
+    // Records the time since start and returns now, so back-to-back phases can chain
+    std::chrono::steady_clock::time_point recordSince(std::chrono::steady_clock::time_point start) {
+        auto now = std::chrono::steady_clock::now();
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count()));
+        return now;
+    }
+    
+    // One pass over the buckets. Concurrent records can make the percentiles
+    // lag the count by a sample or two, which is fine for monitoring.
+    Summary summarize() const {
+        Summary summary;
+        summary.count = count.load(std::memory_order_relaxed);
+        summary.sum_ns = sum_ns.load(std::memory_order_relaxed);
+        summary.max_ns = max_ns.load(std::memory_order_relaxed);
+        if (summary.count == 0) return summary;
+        
+        uint64_t p50_rank = (summary.count + 1) / 2;
+        uint64_t p99_rank = summary.count - summary.count / 100;
+        uint64_t seen = 0;
+        bool have_p50 = false;
+        for (int i = 0; i < kBucketCount; i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (!have_p50 && seen >= p50_rank) {
+                summary.p50_ns = bucketUpperBound(i);
+                have_p50 = true;
+            }
+            if (seen >= p99_rank) {
+                summary.p99_ns = bucketUpperBound(i);
+                break;
+            }
+        }
+        // Bucket bounds can overshoot the largest value actually seen
+        if (summary.p50_ns > summary.max_ns) summary.p50_ns = summary.max_ns;
+        if (summary.p99_ns > summary.max_ns) summary.p99_ns = summary.max_ns;
+        return summary;
+    }
+};
+
+// Records the lifetime of the scope into a histogram
+class ScopedLatencyTimer {
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+    
+public:
+    explicit ScopedLatencyTimer(LatencyHistogram& target)
+        : histogram(target), start(std::chrono::steady_clock::now()) {}
+    
+    ~ScopedLatencyTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+    
+    ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+    ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+};
@@ -1,21 +1,21 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <thread>
 #include <chrono>
 #include <memory>
 #include <map>
+#include <algorithm>
+#include <ctime>
+#include <cstring>
 
 // Cross-platform headers
 #ifdef _WIN32
+    #define NOMINMAX
     #include <windows.h>
     #include <d3d11.h>
     #include <dxgi.h>
     #pragma comment(lib, "d3d11.lib")
     #pragma comment(lib, "dxgi.lib")
-#elif __APPLE__
-    #include <Metal/Metal.h>
-    #include <IOKit/IOKitLib.h>
 #endif
 
 // Dear ImGui for modern GUI
@@ -25,213 +25,169 @@
 #include <GLFW/glfw3.h>
 #include <GL/gl3w.h>
 
-// NVIDIA Management Library (NVML) for GPU control
-#ifdef _WIN32
-    #include <nvml.h>
-    #pragma comment(lib, "nvml.lib")
-#endif
+// Monitoring core (no UI dependencies)
+#include "gpu_monitor.h"
+#include "trace_file.h"
+#include "auto_tuner.h"
+#include "fleet.h"
+#include "history_plot.h"
+#include "frame_arena.h"
+#include "alloc_counter.h"
+#include "latency_histogram.h"
+#include "metric_store.h"
+#include "profile_apply.h"
+#include "profile_store.h"
+#include "power_balancer.h"
 
-class GPUInfo {
-public:
-    std::string name;
-    std::string driver_version;
-    int temperature = 0;
-    int memory_used = 0;
-    int memory_total = 0;
-    int gpu_utilization = 0;
-    int memory_utilization = 0;
-    int power_usage = 0;
-    int power_limit = 0;
-    int core_clock = 0;
-    int memory_clock = 0;
-    int fan_speed = 0;
-    bool is_nvidia = false;
-    
-    // Tuning parameters
-    int target_core_clock = 0;
-    int target_memory_clock = 0;
-    int target_fan_curve[5] = {30, 40, 50, 70, 85}; // Fan speeds at different temps
-    int target_power_limit = 100; // Percentage
-};
-
-class GPUMonitor {
+class GPUTuneApp {
 private:
-    std::vector<GPUInfo> gpus;
-    bool nvml_initialized = false;
+    GLFWwindow* window;
+    GPUMonitor monitor;
+    TraceRecorder recorder{monitor};
+    TraceReplay replay;
+    AutoTuner tuner{monitor};
+    AutoTuneOptions autotune_options;
+    ProfileApplier profile_applier{monitor};
+    ProfileApplyReport apply_report; // Shown in the "Apply Result" popup
+    bool apply_all_or_nothing = true;
+    PowerBalancer power_balancer{monitor};
+    FleetCollector fleet;
+    bool show_about = false;
+    bool show_recording = false;
+    bool show_fleet = false;
+    bool show_events = false;
+    int selected_gpu = 0;
+    bool f5_was_down = false;  // F5 rescans on the press, not on every held frame
+    int graph_span_index = 0;
+    HistoryPlotter history_plot; // VBO-backed Performance Graphs
     
-public:
-    GPUMonitor() {
-        initializeNVML();
-        detectGPUs();
-    }
+    // GPU selector labels, rebuilt only when the device set changes
+    std::vector<std::string> gpu_labels;
+    std::vector<const char*> gpu_label_items;
+    uint64_t gpu_labels_generation = UINT64_MAX;
     
-    ~GPUMonitor() {
-        if (nvml_initialized) {
-#ifdef _WIN32
-            nvmlShutdown();
-#endif
-        }
-    }
+    // Dashboard text per GPU, formatted when the sampler publishes a new
+    // snapshot instead of on every frame
+    struct GPUText {
+        char temperature[16], utilization[16], power[16], memory_used[16];
+        char core_clock[16], memory_clock[16], fan_speed[16], memory_utilization[16];
+        char temperature_bar[32], utilization_bar[32], memory_utilization_bar[32];
+        char memory_bar[32], power_bar[32], fan_bar[32];
+        char encoder_bar[32], decoder_bar[32];
+        char pcie[48], nvlink[48], ecc[64];
+        char throttle[96]; // Limiting throttle reasons, "" if none
+    };
+    std::vector<GPUText> gpu_text;
+    uint64_t gpu_text_generation = UINT64_MAX;
+    bool gpu_text_stale = true;
     
-    void initializeNVML() {
-#ifdef _WIN32
-        nvmlReturn_t result = nvmlInit();
-        if (result == NVML_SUCCESS) {
-            nvml_initialized = true;
-            std::cout << "NVML initialized successfully" << std::endl;
-        } else {
-            std::cout << "Failed to initialize NVML: " << nvmlErrorString(result) << std::endl;
-        }
-#endif
-    }
+    // Auto-tune result shown for autotune_view_gpu, copied only when the tuner's version moves
+    AutoTuneResult autotune_view;
+    std::string autotune_status;
+    uint64_t autotune_version = 0;
+    int autotune_view_gpu = -1;
     
-    void detectGPUs() {
-        gpus.clear();
-        
-#ifdef _WIN32
-        if (nvml_initialized) {
-            unsigned int device_count;
-            nvmlReturn_t result = nvmlDeviceGetCount(&device_count);
-            
-            if (result == NVML_SUCCESS) {
-                for (unsigned int i = 0; i < device_count; i++) {
-                    nvmlDevice_t device;
-                    result = nvmlDeviceGetHandleByIndex(i, &device);
-                    
-                    if (result == NVML_SUCCESS) {
-                        GPUInfo gpu;
-                        gpu.is_nvidia = true;
-                        
-                        char name[NVML_DEVICE_NAME_BUFFER_SIZE];
-                        nvmlDeviceGetName(device, name, NVML_DEVICE_NAME_BUFFER_SIZE);
-                        gpu.name = std::string(name);
-                        
-                        // Get driver version
-                        char version[NVML_SYSTEM_DRIVER_VERSION_BUFFER_SIZE];
-                        nvmlSystemGetDriverVersion(version, NVML_SYSTEM_DRIVER_VERSION_BUFFER_SIZE);
-                        gpu.driver_version = std::string(version);
-                        
-                        updateGPUInfo(gpu, device, i);
-                        gpus.push_back(gpu);
-                    }
-                }
-            }
-        }
-#elif __APPLE__
-        // macOS Metal GPU detection
-        id<MTLDevice> device = MTLCreateSystemDefaultDevice();
-        if (device) {
-            GPUInfo gpu;
-            gpu.name = std::string([device.name UTF8String]);
-            gpu.is_nvidia = false; // Apple Silicon or AMD
-            gpus.push_back(gpu);
-        }
-#endif
-    }
+    // Column-wise copies of the live metrics behind the node and fleet summaries,
+    // rebuilt once per new sweep instead of walking GPUInfo every frame
+    MetricStore node_metrics;
+    MetricStore fleet_metrics; // Local GPUs first, then every agent's, like the fleet table
+    MetricSummary node_summary;
+    MetricSummary fleet_summary;
     
-    void updateGPUInfo(GPUInfo& gpu, void* device_handle, int index) {
-#ifdef _WIN32
-        if (!nvml_initialized) return;
-        
-        nvmlDevice_t device = static_cast<nvmlDevice_t>(device_handle);
-        
-        // Temperature
-        unsigned int temp;
-        if (nvmlDeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &temp) == NVML_SUCCESS) {
-            gpu.temperature = temp;
-        }
-        
-        // Memory info
-        nvmlMemory_t memory;
-        if (nvmlDeviceGetMemoryInfo(device, &memory) == NVML_SUCCESS) {
-            gpu.memory_used = memory.used / (1024 * 1024); // Convert to MB
-            gpu.memory_total = memory.total / (1024 * 1024);
-        }
-        
-        // Utilization
-        nvmlUtilization_t util;
-        if (nvmlDeviceGetUtilizationRates(device, &util) == NVML_SUCCESS) {
-            gpu.gpu_utilization = util.gpu;
-            gpu.memory_utilization = util.memory;
-        }
-        
-        // Power usage
-        unsigned int power;
-        if (nvmlDeviceGetPowerUsage(device, &power) == NVML_SUCCESS) {
-            gpu.power_usage = power / 1000; // Convert to watts
-        }
-        
-        // Power limit
-        unsigned int power_limit;
-        if (nvmlDeviceGetPowerManagementLimitConstraints(device, &power_limit, &power_limit) == NVML_SUCCESS) {
-            gpu.power_limit = power_limit / 1000;
-        }
-        
-        // Clock speeds
-        unsigned int clock;
-        if (nvmlDeviceGetClockInfo(device, NVML_CLOCK_GRAPHICS, &clock) == NVML_SUCCESS) {
-            gpu.core_clock = clock;
-        }
-        if (nvmlDeviceGetClockInfo(device, NVML_CLOCK_MEM, &clock) == NVML_SUCCESS) {
-            gpu.memory_clock = clock;
-        }
-        
-        // Fan speed
-        unsigned int fan;
-        if (nvmlDeviceGetFanSpeed(device, &fan) == NVML_SUCCESS) {
-            gpu.fan_speed = fan;
-        }
-#endif
-    }
+    // Copy of the monitor's event log, refreshed when its version moves
+    std::vector<GPUEvent> events;
+    uint64_t events_version = UINT64_MAX;
     
-    void updateAllGPUs() {
-#ifdef _WIN32
-        if (!nvml_initialized) return;
-        
-        for (size_t i = 0; i < gpus.size(); i++) {
-            nvmlDevice_t device;
-            if (nvmlDeviceGetHandleByIndex(i, &device) == NVML_SUCCESS) {
-                updateGPUInfo(gpus[i], device, i);
-            }
-        }
-#endif
-    }
+    // Alert rules, evaluated by the monitor's sampler; status copied when it changes
+    bool show_alerts = false;
+    char alert_rules_text[2048] = "temp > 85 for 30s\npower spike > 20%/s\n";
+    std::string alert_error;
+    std::vector<AlertEngine::RuleStatus> alert_status;
+    uint64_t alert_status_version = UINT64_MAX;
     
-    bool applyGPUSettings(int gpu_index, const GPUInfo& settings) {
-#ifdef _WIN32
-        if (!nvml_initialized || gpu_index >= gpus.size()) return false;
-        
-        nvmlDevice_t device;
-        if (nvmlDeviceGetHandleByIndex(gpu_index, &device) != NVML_SUCCESS) {
-            return false;
-        }
-        
-        // Apply power limit
-        if (settings.target_power_limit > 0) {
-            unsigned int power_limit = settings.target_power_limit * gpus[gpu_index].power_limit / 100;
-            nvmlDeviceSetPowerManagementLimitConstraints(device, power_limit * 1000, power_limit * 1000);
-        }
-        
-        // Apply clock speeds (requires admin privileges)
-        if (settings.target_core_clock > 0) {
-            nvmlDeviceSetApplicationsClocks(device, settings.target_memory_clock, settings.target_core_clock);
-        }
-        
-        return true;
-#endif
-        return false;
-    }
+    // Temporaries formatted during a frame; reset at the start of each one
+    FrameArena frame_arena;
+    uint64_t frame_allocations = 0;     // Heap allocations on the UI thread during the last frame
+    uint64_t allocating_frames = 0;     // Steady-state frames that allocated at all
+    static constexpr int kWarmupFrames = 120; // Containers and ImGui buffers reach their size by then
     
-    std::vector<GPUInfo>& getGPUs() { return gpus; }
-};
-
-class GPUTuneApp {
-private:
-    GLFWwindow* window;
-    GPUMonitor monitor;
-    bool show_about = false;
-    int selected_gpu = 0;
-    std::chrono::steady_clock::time_point last_update;
+    // Self-profiling, shown in the Diagnostics window. GL submit is CPU time; the
+    // GPU work itself is asynchronous and mostly waited for in the swap.
+    LatencyHistogram frame_latency;    // Whole frame, excluding the idle wait before it
+    LatencyHistogram ui_build_latency; // NewFrame() through ImGui::Render()
+    LatencyHistogram gl_submit_latency;
+    LatencyHistogram swap_latency;
+    LatencyHistogram data_age;         // Age of the displayed sweep when presented
+    bool show_diagnostics = false;
+    
+    // Device tables scroll inside this many rows and submit only the visible ones
+    static constexpr int kMaxVisibleTableRows = 16;
+    
+    // Redraw policy: in low-power mode the loop sleeps until input arrives or the
+    // sampler publishes, instead of rendering every vsync on the GPU being measured
+    bool low_power_mode = true;
+    int background_frame_cap = 5; // FPS while minimized or unfocused
+    static constexpr int kSettleFrames = 3;          // Extra frames after input, for ImGui state changes
+    static constexpr double kIdleRedrawSeconds = 1.0; // Redraw at least this often
+    size_t frame_vertex_bytes = 0; // Vertex and index data the last frame submitted
+    
+    // Compact overlay: the same window, borderless and on top, with one line per
+    // GPU. It only renders when a displayed value changes or the mouse is on it,
+    // so it costs next to nothing on the GPU it is watching.
+    struct OverlayRow {
+        char name[12];
+        char temperature[12];
+        char power[12];
+        char utilization[8];
+        int temperature_c;
+        bool power_high;
+        bool utilization_high;
+        bool alert;
+    };
+    static constexpr size_t kOverlayMaxRows = MetricSummary::kHottestCount; // More GPUs: the hottest, after a summary
+    bool overlay_mode = false;
+    bool overlay_toggle_requested = false; // Switched between frames, not while ImGui is building one
+    std::vector<OverlayRow> overlay_rows;
+    std::vector<OverlayRow> overlay_scratch;
+    char overlay_summary[96] = "";
+    int overlay_redraw_frames = 0;
+    double overlay_cursor_x = -1.0, overlay_cursor_y = -1.0;
+    int overlay_mouse_state = -1; // Hovered and button bits, to notice interaction without rendering
+    bool overlay_dragging = false;
+    int drag_window_x = 0, drag_window_y = 0;
+    double drag_screen_x = 0.0, drag_screen_y = 0.0;
+    int saved_window_x = 0, saved_window_y = 0, saved_window_w = 1400, saved_window_h = 900;
+    bool f9_was_down = false;
+    
+    // Recording & replay
+    char record_path[512] = "gputune-trace.gtr";
+    char replay_path[512] = "gputune-trace.gtr";
+    std::string replay_error;
+    int replay_speed_index = 0;
+    double last_replay_update = 0.0;
+    
+    // Profile export/import, keyed by GPU UUID so one file can cover a fleet
+    bool show_profiles = false;
+    char profile_path[512] = "gputune-profiles.gtp";
+    bool profile_as_text = false;     // Export the human-readable form instead
+    bool profile_apply_on_import = false;
+    std::string profile_status;
+    bool profile_status_ok = true;
+    
+    // The tuning tab's GPU's supported clocks, queried when the GPU or the
+    // memory target changes rather than every frame
+    int clock_table_gpu = -1;
+    std::vector<unsigned int> supported_memory_clocks;
+    unsigned int core_table_memory_clock = 0; // Memory clock supported_core_clocks belongs to
+    std::vector<unsigned int> supported_core_clocks;
+    
+    // Node power budget
+    bool show_power_budget = false;
+    PowerBudgetOptions power_budget_options;
+    
+    // Fleet
+    char fleet_endpoint[256] = "localhost:9500";
+    std::string fleet_error;
     
     // Theme colors
     ImVec4 primary_color = ImVec4(0.2f, 0.6f, 1.0f, 1.0f);
@@ -244,10 +200,16 @@ public:
     GPUTuneApp() {
         initializeGLFW();
         setupImGui();
-        last_update = std::chrono::steady_clock::now();
     }
     
     ~GPUTuneApp() {
+        // The listener posts GLFW events, so detach it before GLFW goes away
+        monitor.setSnapshotListener(nullptr);
+        fleet.setUpdateListener(nullptr);
+        fleet.stop();
+        recorder.stop();
+        tuner.cancelAll();
+        history_plot.release(); // While the GL context still exists
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
@@ -283,6 +245,9 @@ public:
     
     void setupImGui() {
         IMGUI_CHECKVERSION();
+#ifdef GPUTUNE_COUNT_ALLOCATIONS
+        ImGui::SetAllocatorFunctions(countedImGuiAlloc, countedImGuiFree); // Must precede CreateContext
+#endif
         ImGui::CreateContext();
         ImGuiIO& io = ImGui::GetIO();
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -345,18 +310,13 @@ public:
         ImGui_ImplOpenGL3_Init("#version 330");
     }
     
-    void drawProgressBar(const char* label, float value, float max_value, ImVec4 color, const char* overlay = nullptr) {
-        ImGui::Text("%s", label);
+    // overlay comes pre-formatted (see GPUText) so drawing doesn't format anything
+    void drawProgressBar(const char* label, float value, float max_value, ImVec4 color, const char* overlay) {
+        ImGui::TextUnformatted(label);
         ImGui::SameLine(200);
         
         ImGui::PushStyleColor(ImGuiCol_PlotHistogram, color);
-        char buf[32];
-        if (overlay) {
-            sprintf(buf, "%s", overlay);
-        } else {
-            sprintf(buf, "%.1f/%.1f", value, max_value);
-        }
-        ImGui::ProgressBar(value / max_value, ImVec2(-1, 0), buf);
+        ImGui::ProgressBar(max_value > 0.0f ? value / max_value : 0.0f, ImVec2(-1, 0), overlay);
         ImGui::PopStyleColor();
     }
     
@@ -374,6 +334,66 @@ public:
         ImGui::EndChild();
     }
     
+    void refreshGPULabels(const std::vector<GPUInfo>& gpus) {
+        if (gpu_labels_generation == monitor.deviceGeneration() && gpu_labels.size() == gpus.size()) return;
+        
+        gpu_labels.resize(gpus.size());
+        gpu_label_items.resize(gpus.size());
+        for (size_t i = 0; i < gpus.size(); i++) {
+            gpu_labels[i] = std::to_string(i) + ": " + gpus[i].name; // Identical boards need telling apart
+        }
+        for (size_t i = 0; i < gpus.size(); i++) {
+            gpu_label_items[i] = gpu_labels[i].c_str();
+        }
+        gpu_labels_generation = monitor.deviceGeneration();
+    }
+    
+    void refreshGPUText(const std::vector<GPUInfo>& gpus) {
+        if (!gpu_text_stale && gpu_text_generation == monitor.deviceGeneration() && gpu_text.size() == gpus.size()) return;
+        
+        gpu_text.resize(gpus.size());
+        for (size_t i = 0; i < gpus.size(); i++) {
+            const GPUInfo& gpu = gpus[i];
+            GPUText& text = gpu_text[i];
+            snprintf(text.temperature, sizeof(text.temperature), "%d", gpu.temperature);
+            snprintf(text.utilization, sizeof(text.utilization), "%d", gpu.gpu_utilization);
+            snprintf(text.power, sizeof(text.power), "%d", gpu.power_usage);
+            snprintf(text.memory_used, sizeof(text.memory_used), "%d", gpu.memory_used);
+            snprintf(text.core_clock, sizeof(text.core_clock), "%d", gpu.core_clock);
+            snprintf(text.memory_clock, sizeof(text.memory_clock), "%d", gpu.memory_clock);
+            snprintf(text.fan_speed, sizeof(text.fan_speed), "%d", gpu.fan_speed);
+            snprintf(text.memory_utilization, sizeof(text.memory_utilization), "%d", gpu.memory_utilization);
+            
+            snprintf(text.temperature_bar, sizeof(text.temperature_bar), "%d°C", gpu.temperature);
+            snprintf(text.utilization_bar, sizeof(text.utilization_bar), "%.1f/%.1f", (float)gpu.gpu_utilization, 100.0f);
+            snprintf(text.memory_utilization_bar, sizeof(text.memory_utilization_bar), "%.1f/%.1f",
+                     (float)gpu.memory_utilization, 100.0f);
+            snprintf(text.memory_bar, sizeof(text.memory_bar), "%d/%d MB", gpu.memory_used, gpu.memory_total);
+            snprintf(text.power_bar, sizeof(text.power_bar), "%d/%d W", gpu.power_usage, gpu.power_limit);
+            snprintf(text.fan_bar, sizeof(text.fan_bar), "%.1f/%.1f", (float)gpu.fan_speed, 100.0f);
+            snprintf(text.encoder_bar, sizeof(text.encoder_bar), "%d%%", gpu.encoder_utilization);
+            snprintf(text.decoder_bar, sizeof(text.decoder_bar), "%d%%", gpu.decoder_utilization);
+            snprintf(text.pcie, sizeof(text.pcie), "TX %d MB/s   RX %d MB/s", gpu.pcie_tx, gpu.pcie_rx);
+            snprintf(text.nvlink, sizeof(text.nvlink), "TX %d MB/s   RX %d MB/s (%zu links)", gpu.nvlink_tx,
+                     gpu.nvlink_rx, gpu.nvlinks.size());
+            if (gpu.ecc_enabled) {
+                snprintf(text.ecc, sizeof(text.ecc), "%d corrected, %d uncorrected since driver load",
+                         gpu.ecc_corrected, gpu.ecc_uncorrected);
+            } else {
+                snprintf(text.ecc, sizeof(text.ecc), "Disabled or not supported");
+            }
+            formatThrottleReasons(gpu.throttle_reasons & kThrottleLimitingMask, text.throttle, sizeof(text.throttle));
+        }
+        gpu_text_generation = monitor.deviceGeneration();
+        gpu_text_stale = false;
+    }
+    
+    // Outer height for a scrolling table of row_count rows plus the header
+    static float tableHeight(size_t row_count) {
+        size_t visible = std::min<size_t>(std::max<size_t>(row_count, 1), kMaxVisibleTableRows);
+        return (visible + 1) * (ImGui::GetTextLineHeightWithSpacing() + 2.0f * ImGui::GetStyle().CellPadding.y) + 4.0f;
+    }
+    
     void drawGPUMonitoring() {
         auto& gpus = monitor.getGPUs();
         if (gpus.empty()) {
@@ -383,51 +403,49 @@ public:
         
         // GPU Selection
         if (gpus.size() > 1) {
-            std::vector<std::string> gpu_names;
-            for (const auto& gpu : gpus) {
-                gpu_names.push_back(gpu.name);
-            }
-            
+            refreshGPULabels(gpus);
             ImGui::Text("Select GPU:");
             ImGui::SameLine();
-            
-            std::vector<const char*> gpu_names_cstr;
-            for (const auto& name : gpu_names) {
-                gpu_names_cstr.push_back(name.c_str());
-            }
-            
-            ImGui::Combo("##gpu_select", &selected_gpu, gpu_names_cstr.data(), gpu_names_cstr.size());
+            ImGui::Combo("##gpu_select", &selected_gpu, gpu_label_items.data(), static_cast<int>(gpu_label_items.size()));
+            drawSummaryLine("Node", node_summary);
             ImGui::Separator();
         }
         
         if (selected_gpu >= gpus.size()) selected_gpu = 0;
         const auto& gpu = gpus[selected_gpu];
+        refreshGPUText(gpus);
+        const GPUText& text = gpu_text[selected_gpu];
         
         // GPU Information Header
         ImGui::Text("GPU: %s", gpu.name.c_str());
         ImGui::Text("Driver: %s", gpu.driver_version.c_str());
+        if (gpu.stale) {
+            ImGui::TextColored(warning_color, "Device missed the last sampling deadline; showing previous readings");
+        }
+        if (text.throttle[0]) {
+            ImGui::TextColored(warning_color, "Clocks limited by: %s", text.throttle);
+        }
+        for (const AlertEngine::RuleStatus& rule : alert_status) {
+            if (static_cast<size_t>(selected_gpu) < rule.active.size() && rule.active[selected_gpu]) {
+                ImGui::TextColored(danger_color, "Alert: %s", rule.text.c_str());
+            }
+        }
         ImGui::Separator();
         
         // Metrics Cards Row 1
         ImGui::BeginGroup();
         {
-            char temp_str[16], util_str[16], power_str[16], mem_str[16];
-            sprintf(temp_str, "%d", gpu.temperature);
-            sprintf(util_str, "%d", gpu.gpu_utilization);
-            sprintf(power_str, "%d", gpu.power_usage);
-            sprintf(mem_str, "%d", gpu.memory_used);
-            
             ImVec4 temp_color = gpu.temperature > 80 ? danger_color : (gpu.temperature > 70 ? warning_color : accent_color);
             ImVec4 util_color = gpu.gpu_utilization > 90 ? warning_color : primary_color;
             ImVec4 power_color = gpu.power_usage > (gpu.power_limit * 0.9f) ? warning_color : accent_color;
             
-            drawMetricCard("Temperature", temp_str, "°C", temp_color);
+            drawMetricCard("Temperature", text.temperature, "°C", temp_color);
             ImGui::SameLine();
-            drawMetricCard("GPU Usage", util_str, "%", util_color);
+            drawMetricCard("GPU Usage", text.utilization, "%", util_color);
             ImGui::SameLine();
-            drawMetricCard("Power", power_str, "W", power_color);
+            drawMetricCard("Power", text.power, "W", power_color);
             ImGui::SameLine();
-            drawMetricCard("Memory", mem_str, "MB", primary_color);
+            drawMetricCard("Memory", text.memory_used, "MB", primary_color);
         }
         ImGui::EndGroup();
         
@@ -436,19 +454,13 @@ public:
         // Metrics Cards Row 2
         ImGui::BeginGroup();
         {
-            char core_clock_str[16], mem_clock_str[16], fan_str[16], mem_util_str[16];
-            sprintf(core_clock_str, "%d", gpu.core_clock);
-            sprintf(mem_clock_str, "%d", gpu.memory_clock);
-            sprintf(fan_str, "%d", gpu.fan_speed);
-            sprintf(mem_util_str, "%d", gpu.memory_utilization);
-            
-            drawMetricCard("Core Clock", core_clock_str, "MHz", accent_color);
+            drawMetricCard("Core Clock", text.core_clock, "MHz", accent_color);
             ImGui::SameLine();
-            drawMetricCard("Mem Clock", mem_clock_str, "MHz", accent_color);
+            drawMetricCard("Mem Clock", text.memory_clock, "MHz", accent_color);
             ImGui::SameLine();
-            drawMetricCard("Fan Speed", fan_str, "%", primary_color);
+            drawMetricCard("Fan Speed", text.fan_speed, "%", primary_color);
             ImGui::SameLine();
-            drawMetricCard("Mem Usage", mem_util_str, "%", primary_color);
+            drawMetricCard("Mem Usage", text.memory_utilization, "%", primary_color);
         }
         ImGui::EndGroup();
         
@@ -460,19 +472,106 @@ public:
         ImGui::Text("Detailed Status");
         ImGui::Spacing();
         
-        char temp_overlay[32], mem_overlay[32], power_overlay[32];
-        sprintf(temp_overlay, "%d°C", gpu.temperature);
-        sprintf(mem_overlay, "%d/%d MB", gpu.memory_used, gpu.memory_total);
-        sprintf(power_overlay, "%d/%d W", gpu.power_usage, gpu.power_limit);
-        
         ImVec4 temp_bar_color = gpu.temperature > 80 ? danger_color : (gpu.temperature > 70 ? warning_color : accent_color);
         
-        drawProgressBar("Temperature:", gpu.temperature, 100, temp_bar_color, temp_overlay);
-        drawProgressBar("GPU Utilization:", gpu.gpu_utilization, 100, primary_color);
-        drawProgressBar("Memory Utilization:", gpu.memory_utilization, 100, primary_color);
-        drawProgressBar("Memory Usage:", gpu.memory_used, gpu.memory_total, primary_color, mem_overlay);
-        drawProgressBar("Power Usage:", gpu.power_usage, gpu.power_limit, accent_color, power_overlay);
-        drawProgressBar("Fan Speed:", gpu.fan_speed, 100, primary_color);
+        drawProgressBar("Temperature:", gpu.temperature, 100, temp_bar_color, text.temperature_bar);
+        drawProgressBar("GPU Utilization:", gpu.gpu_utilization, 100, primary_color, text.utilization_bar);
+        drawProgressBar("Memory Utilization:", gpu.memory_utilization, 100, primary_color, text.memory_utilization_bar);
+        drawProgressBar("Memory Usage:", gpu.memory_used, gpu.memory_total, primary_color, text.memory_bar);
+        drawProgressBar("Power Usage:", gpu.power_usage, gpu.power_limit, accent_color, text.power_bar);
+        drawProgressBar("Fan Speed:", gpu.fan_speed, 100, primary_color, text.fan_bar);
+        drawProgressBar("Video Encoder:", gpu.encoder_utilization, 100, primary_color, text.encoder_bar);
+        drawProgressBar("Video Decoder:", gpu.decoder_utilization, 100, primary_color, text.decoder_bar);
+        
+        drawInterconnect(gpu, text);
+        drawProcesses(gpu);
+    }
+    
+    void drawInterconnect(const GPUInfo& gpu, const GPUText& text) {
+        ImGui::Spacing();
+        ImGui::Text("PCIe:");
+        ImGui::SameLine(200);
+        ImGui::TextUnformatted(text.pcie);
+        ImGui::Text("ECC:");
+        ImGui::SameLine(200);
+        if (gpu.ecc_uncorrected > 0) {
+            ImGui::TextColored(danger_color, "%s", text.ecc);
+        } else {
+            ImGui::TextUnformatted(text.ecc);
+        }
+        if (gpu.nvlinks.empty()) return;
+        
+        ImGui::Text("NVLink:");
+        ImGui::SameLine(200);
+        ImGui::TextUnformatted(text.nvlink);
+        if (!ImGui::CollapsingHeader("NVLink Throughput per Link")) return;
+        if (ImGui::BeginTable("nvlink_table", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                              ImVec2(0, tableHeight(gpu.nvlinks.size())))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Link");
+            ImGui::TableSetupColumn("TX (MB/s)");
+            ImGui::TableSetupColumn("RX (MB/s)");
+            ImGui::TableHeadersRow();
+            for (const NvLinkThroughput& link : gpu.nvlinks) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", link.link);
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", link.tx);
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", link.rx);
+            }
+            ImGui::EndTable();
+        }
+    }
+    
+    void drawProcesses(const GPUInfo& gpu) {
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+        
+        ImGui::Text("Processes (%zu)", gpu.processes.size());
+        if (gpu.processes.empty()) {
+            ImGui::TextDisabled("No compute processes");
+            return;
+        }
+        
+        if (ImGui::BeginTable("process_table", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                              ImVec2(0, tableHeight(gpu.processes.size())))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("PID");
+            ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("Memory");
+            ImGui::TableSetupColumn("SM %");
+            ImGui::TableSetupColumn("Mem %");
+            ImGui::TableSetupColumn("Enc %");
+            ImGui::TableSetupColumn("Dec %");
+            ImGui::TableHeadersRow();
+            
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(gpu.processes.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    const GPUProcessInfo& process = gpu.processes[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", process.pid);
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(process.name.empty() ? "?" : process.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%d MB", process.memory_used);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%d", process.sm_utilization);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%d", process.memory_utilization);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%d", process.encoder_utilization);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%d", process.decoder_utilization);
+                }
+            }
+            ImGui::EndTable();
+        }
     }
     
     void drawGPUTuning() {
@@ -499,12 +598,21 @@ public:
         ImGui::Text("Core Clock Adjustment");
         ImGui::Text("Current: %d MHz", gpu.core_clock);
         ImGui::SliderInt("Target Core Clock (MHz)", &gpu.target_core_clock, gpu.core_clock - 200, gpu.core_clock + 200);
+        unsigned int snapped_core = 0;
+        unsigned int snapped_memory = 0;
+        snapToSupportedClocks(gpu, snapped_core, snapped_memory);
+        if (snapped_core > 0 && static_cast<int>(snapped_core) != gpu.target_core_clock) {
+            ImGui::TextDisabled("Applies as %u MHz, the nearest supported clock", snapped_core);
+        }
         ImGui::Spacing();
         
         // Memory Clock Tuning
         ImGui::Text("Memory Clock Adjustment");
         ImGui::Text("Current: %d MHz", gpu.memory_clock);
         ImGui::SliderInt("Target Memory Clock (MHz)", &gpu.target_memory_clock, gpu.memory_clock - 500, gpu.memory_clock + 500);
+        if (snapped_memory > 0 && static_cast<int>(snapped_memory) != gpu.target_memory_clock) {
+            ImGui::TextDisabled("Applies as %u MHz, the nearest supported clock", snapped_memory);
+        }
         ImGui::Spacing();
         
         // Power Limit
@@ -512,60 +620,707 @@ public:
         ImGui::Text("Current: %d W", gpu.power_limit);
         ImGui::SliderInt("Power Limit (%)", &gpu.target_power_limit, 50, 120);
         ImGui::Text("Target: %d W", (gpu.power_limit * gpu.target_power_limit) / 100);
+        if (power_balancer.isActive()) {
+            ImGui::TextColored(warning_color, "Managed by the node power budget; applied limits are overridden at its next period");
+        }
         ImGui::Spacing();
         
         // Fan Curve
-        ImGui::Text("Fan Curve (Temperature vs Fan Speed %)");
-        ImGui::Text("30°C    50°C    65°C    75°C    85°C");
-        for (int i = 0; i < 5; i++) {
+        ImGui::Text("Fan Curve (Temperature vs Fan Speed %%)");
+        ImGui::Text("%d°C    %d°C    %d°C    %d°C    %d°C", kFanCurveTemperatures[0], kFanCurveTemperatures[1],
+                    kFanCurveTemperatures[2], kFanCurveTemperatures[3], kFanCurveTemperatures[4]);
+        for (int i = 0; i < kFanCurvePoints; i++) {
             ImGui::PushID(i);
             ImGui::SliderInt("", &gpu.target_fan_curve[i], 0, 100);
-            if (i < 4) ImGui::SameLine();
+            if (i < kFanCurvePoints - 1) ImGui::SameLine();
             ImGui::PopID();
         }
+        ImGui::Checkbox("Drive fans from this curve", &gpu.target_fan_control);
+        if (gpu.fan_control_active) {
+            ImGui::TextColored(accent_color, "Fan control active: %d%% at %d°C", gpu.fan_control_target, gpu.temperature);
+        } else {
+            ImGui::TextDisabled("Fans follow the driver's automatic policy");
+        }
         ImGui::Spacing();
         
         // Apply Settings Button
         ImGui::Separator();
         ImGui::Spacing();
         
-        if (ImGui::Button("Apply Settings", ImVec2(150, 40))) {
-            if (monitor.applyGPUSettings(selected_gpu, gpu)) {
-                ImGui::OpenPopup("Success");
-            } else {
-                ImGui::OpenPopup("Error");
+        // Changes device settings the auto-tuner is also driving, so wait for it
+        ImGui::BeginDisabled(tuner.isAnyRunning());
+        if (ImGui::Button("Apply Settings", ImVec2(150, 40))) {
+            applyProfile(snappedProfile(gpu, snapped_core, snapped_memory), DeviceSelector::single(selected_gpu));
+        }
+        if (gpus.size() > 1) {
+            ImGui::SameLine();
+            if (ImGui::Button("Apply to All GPUs", ImVec2(150, 40))) {
+                applyProfile(snappedProfile(gpu, snapped_core, snapped_memory), DeviceSelector::all());
+            }
+        }
+        ImGui::EndDisabled();
+        
+        ImGui::SameLine();
+        if (ImGui::Button("Reset to Default", ImVec2(150, 40))) {
+            gpu.target_core_clock = gpu.core_clock;
+            gpu.target_memory_clock = gpu.memory_clock;
+            gpu.target_power_limit = 100;
+            for (int i = 0; i < 5; i++) {
+                gpu.target_fan_curve[i] = 30 + (i * 15);
+            }
+            gpu.target_fan_control = false;
+        }
+        if (gpus.size() > 1) {
+            ImGui::Checkbox("Undo every GPU if any one fails", &apply_all_or_nothing);
+        }
+        
+        drawApplyResult();
+        
+        drawAutoTune(gpu);
+    }
+    
+    // The supported clock pair nearest the selected GPU's targets, or zeros
+    // where the board reports no tables (the applier then says why)
+    void snapToSupportedClocks(const GPUInfo& gpu, unsigned int& core, unsigned int& memory) {
+        if (clock_table_gpu != selected_gpu) {
+            clock_table_gpu = selected_gpu;
+            supported_memory_clocks = monitor.getSupportedMemoryClocks(selected_gpu);
+            core_table_memory_clock = 0;
+            supported_core_clocks.clear();
+        }
+        if (supported_memory_clocks.empty() || gpu.target_core_clock <= 0) return;
+        memory = nearestClock(supported_memory_clocks, static_cast<unsigned int>(std::max(0, gpu.target_memory_clock)));
+        if (core_table_memory_clock != memory) {
+            core_table_memory_clock = memory;
+            supported_core_clocks = monitor.getSupportedGraphicsClocks(selected_gpu, memory);
+        }
+        if (supported_core_clocks.empty()) return;
+        core = nearestClock(supported_core_clocks, static_cast<unsigned int>(gpu.target_core_clock));
+    }
+    
+    // The sliders move in 1 MHz steps, but the applier only takes exact table entries
+    static TuningProfile snappedProfile(const GPUInfo& gpu, unsigned int core, unsigned int memory) {
+        TuningProfile profile = TuningProfile::fromTargets(gpu);
+        if (core > 0 && memory > 0) {
+            profile.core_clock = core;
+            profile.memory_clock = memory;
+        }
+        return profile;
+    }
+    
+    void applyProfile(const TuningProfile& profile, const DeviceSelector& selector) {
+        apply_report = profile_applier.apply(profile, selector, apply_all_or_nothing);
+        ImGui::OpenPopup("Apply Result");
+    }
+    
+    void drawApplyResult() {
+        if (!ImGui::BeginPopupModal("Apply Result", NULL, ImGuiWindowFlags_AlwaysAutoResize)) return;
+        
+        const ProfileApplyReport& report = apply_report;
+        if (report.succeeded()) {
+            ImGui::TextColored(accent_color, "Settings applied to %zu GPU%s in %.1f ms", report.applied,
+                               report.applied == 1 ? "" : "s", report.duration_ms);
+        } else {
+            ImGui::TextColored(danger_color, "Applied %zu of %zu GPUs (%.1f ms)", report.applied, report.devices.size(),
+                               report.duration_ms);
+            if (report.failed > 0) ImGui::Text("Make sure you're running as administrator.");
+        }
+        
+        if (report.devices.size() > 1 || !report.succeeded()) {
+            ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+            float height = ImGui::GetTextLineHeightWithSpacing() * (std::min<size_t>(report.devices.size(), kMaxVisibleTableRows) + 1.5f);
+            if (ImGui::BeginTable("apply_results", 3, flags, ImVec2(560, height))) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("GPU");
+                ImGui::TableSetupColumn("Result");
+                ImGui::TableSetupColumn("Detail");
+                ImGui::TableHeadersRow();
+                
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(report.devices.size()));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                        const DeviceApplyResult& result = report.devices[row];
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%zu", result.gpu_index);
+                        ImGui::TableNextColumn();
+                        ImVec4 color = result.outcome == ApplyOutcome::Applied ? accent_color :
+                                       (result.outcome == ApplyOutcome::Failed || result.outcome == ApplyOutcome::Rejected
+                                            ? danger_color : warning_color);
+                        ImGui::TextColored(color, "%s", applyOutcomeName(result.outcome));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%s%s", result.detail.c_str(),
+                                    result.rollback_incomplete ? " (could not restore previous settings)" : "");
+                    }
+                }
+                ImGui::EndTable();
+            }
+        }
+        
+        ImGui::Separator();
+        if (ImGui::Button("OK", ImVec2(120, 0))) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+    
+    const char* clockLabel(unsigned int mhz) {
+        return mhz == 0 ? "stock" : frame_arena.format("%u", mhz);
+    }
+    
+    void drawAutoTune(GPUInfo& gpu) {
+        ImGui::Spacing();
+        if (!ImGui::CollapsingHeader("Auto-Tune")) return;
+        
+        ImGui::TextWrapped("Runs a built-in stress kernel at a series of clock and power-limit settings and "
+                           "finds the one with the best throughput per watt that stays error-free and cool.");
+        
+        bool running = tuner.isRunning(selected_gpu);
+        if (running) ImGui::BeginDisabled();
+        float trial_seconds = static_cast<float>(autotune_options.trial_seconds);
+        if (ImGui::SliderFloat("Trial length (s)", &trial_seconds, 1.0f, 30.0f, "%.0f")) {
+            autotune_options.trial_seconds = trial_seconds;
+        }
+        ImGui::SliderInt("Temperature limit (°C)", &autotune_options.temperature_limit_c, 60, 95);
+        float min_throughput = autotune_options.min_throughput_ratio * 100.0f;
+        if (ImGui::SliderFloat("Minimum throughput (% of stock)", &min_throughput, 50.0f, 100.0f, "%.0f")) {
+            autotune_options.min_throughput_ratio = min_throughput / 100.0f;
+        }
+        if (running) ImGui::EndDisabled();
+        
+        if (running) {
+            if (ImGui::Button("Cancel", ImVec2(150, 0))) {
+                tuner.cancel(selected_gpu);
+            }
+        } else if (ImGui::Button("Start Auto-Tune", ImVec2(150, 0))) {
+            tuner.start(selected_gpu, autotune_options);
+        }
+        
+        if (autotune_view_gpu != selected_gpu) {
+            autotune_view_gpu = selected_gpu;
+            autotune_version = UINT64_MAX; // Never a live version, forces a copy
+        }
+        tuner.copyIfChanged(selected_gpu, autotune_version, autotune_view, autotune_status);
+        const AutoTuneResult& result = autotune_view;
+        
+        if (!autotune_status.empty()) {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(autotune_status.c_str());
+        }
+        if (running) {
+            ImGui::PushStyleColor(ImGuiCol_Text, warning_color);
+            ImGui::Text("The GPU is under full load; GPU refresh is disabled until tuning finishes.");
+            ImGui::PopStyleColor();
+        }
+        
+        if (result.trials.empty()) return;
+        
+        if (ImGui::BeginTable("AutoTuneTrials", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_ScrollY, ImVec2(0, 200))) {
+            ImGui::TableSetupColumn("Core MHz");
+            ImGui::TableSetupColumn("Mem MHz");
+            ImGui::TableSetupColumn("Limit W");
+            ImGui::TableSetupColumn("GFLOPS");
+            ImGui::TableSetupColumn("Power W");
+            ImGui::TableSetupColumn("GFLOPS/W");
+            ImGui::TableSetupColumn("Result");
+            ImGui::TableHeadersRow();
+            
+            for (const auto& trial : result.trials) {
+                bool is_best = result.has_best && trial.core_clock == result.best.core_clock &&
+                               trial.memory_clock == result.best.memory_clock &&
+                               trial.power_limit_mw == result.best.power_limit_mw;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(clockLabel(trial.core_clock));
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(clockLabel(trial.memory_clock));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", trial.power_limit_mw / 1000);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", trial.gflops);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", trial.watts);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", trial.perf_per_watt);
+                ImGui::TableNextColumn();
+                if (is_best) {
+                    ImGui::TextColored(accent_color, "Best");
+                } else if (trial.feasible) {
+                    ImGui::Text("OK");
+                } else {
+                    ImGui::TextColored(trial.errors > 0 ? danger_color : warning_color, "%s", trial.note.c_str());
+                }
+            }
+            ImGui::EndTable();
+        }
+        
+        if (result.has_best && !running) {
+            const AutoTuneTrial& best = result.best;
+            ImGui::Text("Best: %.2f GFLOPS/W vs %.2f stock (%.0f%% of stock throughput)", best.perf_per_watt,
+                        result.baseline.perf_per_watt,
+                        result.baseline.gflops > 0.0 ? best.gflops / result.baseline.gflops * 100.0 : 0.0);
+            if (ImGui::Button("Use Best Settings", ImVec2(150, 0))) {
+                // Fills the targets above; Apply Settings makes them stick
+                if (best.core_clock > 0) {
+                    gpu.target_core_clock = static_cast<int>(best.core_clock);
+                    gpu.target_memory_clock = static_cast<int>(best.memory_clock);
+                } else {
+                    gpu.target_core_clock = 0;
+                }
+                const GPUDevice* device = monitor.getDevice(selected_gpu);
+                if (device && device->power_limit_max > 0) {
+                    gpu.target_power_limit = static_cast<int>(
+                        (static_cast<uint64_t>(best.power_limit_mw) * 100 + device->power_limit_max - 1) / device->power_limit_max);
+                }
+            }
+        }
+    }
+    
+    const char* traceOffsetLabel(int64_t offset_us) {
+        long long seconds = std::max<long long>(0, offset_us / 1000000);
+        return frame_arena.format("+%02lld:%02lld:%02lld", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+    }
+    
+    void drawRecording() {
+        if (!show_recording) return;
+        
+        static const double kReplaySpeeds[] = {1.0, 10.0, 60.0, 600.0, 3600.0};
+        static const char* kReplaySpeedLabels[] = {"1x", "10x", "60x", "600x", "3600x"};
+        
+        ImGui::SetNextWindowSize(ImVec2(460, 320), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Recording & Replay", &show_recording)) {
+            ImGui::Text("Record");
+            ImGui::Separator();
+            if (recorder.isRecording()) {
+                ImGui::PushStyleColor(ImGuiCol_Text, danger_color);
+                ImGui::Text("● Recording to %s", recorder.filePath().c_str());
+                ImGui::PopStyleColor();
+                ImGui::Text("%llu sweeps, %.1f MB", (unsigned long long)recorder.recordCount(),
+                            recorder.byteCount() / (1024.0 * 1024.0));
+                if (ImGui::Button("Stop Recording")) {
+                    recorder.stop();
+                }
+            } else {
+                ImGui::InputText("File##record", record_path, sizeof(record_path));
+                if (ImGui::Button("Start Recording")) {
+                    recorder.start(record_path);
+                }
+            }
+            
+            ImGui::Spacing();
+            ImGui::Text("Replay");
+            ImGui::Separator();
+            if (replay.isOpen()) {
+                const char* position = traceOffsetLabel(replay.currentTime() - replay.startTime());
+                ImGui::Text("%s (%.1f MB) at %s%s", replay_path, replay.fileSizeMB(), position,
+                            replay.isFinished() ? ", finished" : "");
+                
+                if (ImGui::Button(replay.isPaused() ? "Resume" : "Pause")) {
+                    replay.setPaused(!replay.isPaused());
+                }
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(100);
+                if (ImGui::Combo("Speed", &replay_speed_index, kReplaySpeedLabels, IM_ARRAYSIZE(kReplaySpeedLabels))) {
+                    replay.setSpeed(kReplaySpeeds[replay_speed_index]);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Close Replay")) {
+                    replay.close();
+                }
+            } else {
+                ImGui::InputText("File##replay", replay_path, sizeof(replay_path));
+                if (ImGui::Button("Open Replay")) {
+                    replay_error.clear();
+                    if (replay.open(replay_path, replay_error)) {
+                        replay.setSpeed(kReplaySpeeds[replay_speed_index]);
+                        last_replay_update = glfwGetTime();
+                        selected_gpu = 0;
+                    }
+                }
+                if (!replay_error.empty()) {
+                    ImGui::TextColored(danger_color, "%s", replay_error.c_str());
+                }
+            }
+            ImGui::TextWrapped("While a replay is open, Performance Graphs show the recording instead of live data.");
+        }
+        ImGui::End();
+    }
+    
+    // After a rescan: keep the same physical GPU selected and rebuild per-device views
+    void onDevicesChanged(const std::string& selected_uuid) {
+        const auto& gpus = monitor.getGPUs();
+        int previous = selected_gpu;
+        selected_gpu = 0;
+        for (size_t i = 0; i < gpus.size(); i++) {
+            if (!selected_uuid.empty() && gpus[i].uuid == selected_uuid) selected_gpu = static_cast<int>(i);
+        }
+        if (selected_gpu != previous) autotune_view_gpu = -1;
+        clock_table_gpu = -1;
+        gpu_text_stale = true;
+        refreshEvents();
+        refreshSummaries();
+    }
+    
+    // Saves every GPU's tuning targets, merged into the file if it already exists
+    void exportProfiles() {
+        ProfileStore store;
+        ProfileFile existing;
+        std::string error;
+        if (existing.open(profile_path, error)) {
+            existing.copyTo(store);
+        }
+        
+        size_t exported = 0;
+        for (const auto& gpu : monitor.getGPUs()) {
+            if (store.set(gpu.uuid, TuningProfile::fromTargets(gpu))) exported++;
+        }
+        error.clear();
+        profile_status_ok = exported > 0 && store.save(profile_path, profile_as_text, error);
+        if (profile_status_ok) {
+            profile_status = "Saved " + std::to_string(exported) + " GPUs (" + std::to_string(store.size()) +
+                             " profiles in file, revision " + std::to_string(store.getRevision()) + ")";
+        } else {
+            profile_status = error.empty() ? "No GPU with a UUID to export" : error;
+        }
+    }
+    
+    // Loads the profiles of the GPUs present into their tuning targets, and optionally applies them
+    void importProfiles() {
+        ProfileFile file;
+        std::string error;
+        if (!file.open(profile_path, error)) {
+            profile_status = error;
+            profile_status_ok = false;
+            return;
+        }
+        
+        auto& gpus = monitor.getGPUs();
+        std::vector<std::pair<size_t, TuningProfile>> assignments;
+        for (size_t i = 0; i < gpus.size(); i++) {
+            const ProfileRecord* record = file.find(gpus[i].uuid);
+            if (!record) continue;
+            TuningProfile profile = profileFromRecord(*record);
+            profile.toTargets(gpus[i]);
+            assignments.emplace_back(i, profile);
+        }
+        
+        profile_status = "Loaded " + std::to_string(assignments.size()) + " of " + std::to_string(gpus.size()) +
+                         " GPUs from " + std::to_string(file.size()) + " profiles";
+        profile_status_ok = !assignments.empty();
+        if (profile_status_ok && profile_apply_on_import) {
+            apply_report = profile_applier.applyEach(assignments, apply_all_or_nothing);
+            profile_status_ok = apply_report.succeeded();
+            char summary[96];
+            std::snprintf(summary, sizeof(summary), "; applied to %zu in %.1f ms", apply_report.applied,
+                          apply_report.duration_ms);
+            profile_status += summary;
+        }
+    }
+    
+    void drawProfiles() {
+        if (!show_profiles) return;
+        
+        ImGui::SetNextWindowSize(ImVec2(480, 240), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Profiles", &show_profiles)) {
+            ImGui::TextWrapped("Clocks, power limit and fan curve per GPU, stored by UUID. Exporting merges into an "
+                               "existing file, so one file can hold a whole fleet.");
+            ImGui::InputText("File##profiles", profile_path, sizeof(profile_path));
+            ImGui::Checkbox("Export as text", &profile_as_text);
+            
+            if (ImGui::Button("Export")) {
+                exportProfiles();
+            }
+            ImGui::SameLine();
+            ImGui::BeginDisabled(tuner.isAnyRunning() && profile_apply_on_import);
+            if (ImGui::Button("Import")) {
+                importProfiles();
+            }
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::Checkbox("Apply after import", &profile_apply_on_import);
+            
+            if (!profile_status.empty()) {
+                ImGui::TextColored(profile_status_ok ? accent_color : danger_color, "%s", profile_status.c_str());
+            }
+            if (profile_apply_on_import && !apply_report.succeeded()) {
+                size_t shown = 0;
+                for (const DeviceApplyResult& result : apply_report.devices) {
+                    if (result.outcome == ApplyOutcome::Applied || shown++ >= 8) continue;
+                    ImGui::TextDisabled("GPU %zu: %s %s", result.gpu_index, applyOutcomeName(result.outcome),
+                                        result.detail.c_str());
+                }
+                if (shown > 8) ImGui::TextDisabled("... and %zu more", shown - 8);
             }
         }
+        ImGui::End();
+    }
+    
+    void drawPowerBudget() {
+        if (!show_power_budget) return;
         
-        ImGui::SameLine();
-        if (ImGui::Button("Reset to Default", ImVec2(150, 40))) {
-            gpu.target_core_clock = gpu.core_clock;
-            gpu.target_memory_clock = gpu.memory_clock;
-            gpu.target_power_limit = 100;
-            for (int i = 0; i < 5; i++) {
-                gpu.target_fan_curve[i] = 30 + (i * 15);
+        ImGui::SetNextWindowSize(ImVec2(520, 320), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Power Budget", &show_power_budget)) {
+            ImGui::TextWrapped("Keeps the sum of all power limits within a node budget, moving headroom from idle "
+                               "GPUs to power-capped busy ones. The original limits come back when it's turned off.");
+            
+            int budget_w = static_cast<int>(power_budget_options.budget_w);
+            if (ImGui::InputInt("Budget (W)", &budget_w, 10, 100)) {
+                power_budget_options.budget_w = static_cast<unsigned int>(std::max(0, budget_w));
+                power_balancer.setOptions(power_budget_options);
+            }
+            float period = static_cast<float>(power_budget_options.period_seconds);
+            if (ImGui::SliderFloat("Period (s)", &period, 0.5f, 10.0f, "%.1f")) {
+                power_budget_options.period_seconds = period;
+                power_balancer.setOptions(power_budget_options);
+            }
+            
+            bool active = power_balancer.isActive();
+            ImGui::BeginDisabled(!active && (power_budget_options.budget_w == 0 || tuner.isAnyRunning()));
+            if (ImGui::Checkbox("Enforce budget", &active)) {
+                if (active) {
+                    power_balancer.start(power_budget_options);
+                } else {
+                    power_balancer.stop();
+                }
+            }
+            ImGui::EndDisabled();
+            
+            const PowerBalanceStatus& status = power_balancer.status();
+            if (active) {
+                ImVec4 total_color = status.total_limit_w > power_budget_options.budget_w ? danger_color : accent_color;
+                ImGui::TextColored(total_color, "Limits %u / %u W, drawing %u W, %llu rebalances%s",
+                                   status.total_limit_w, power_budget_options.budget_w, status.total_usage_w,
+                                   (unsigned long long)status.rebalances, tuner.isAnyRunning() ? " (paused)" : "");
+                if (!status.feasible) {
+                    ImGui::TextColored(danger_color, "Budget is below the GPUs' minimum limits; all run at minimum");
+                }
+                if (!status.error.empty()) {
+                    ImGui::TextColored(danger_color, "%s", status.error.c_str());
+                }
+            }
+            
+            const auto& gpus = monitor.getGPUs();
+            if (active && !status.limit_w.empty() && ImGui::BeginTable("power_budget", 5)) {
+                ImGui::TableSetupColumn("GPU");
+                ImGui::TableSetupColumn("Demand");
+                ImGui::TableSetupColumn("Usage");
+                ImGui::TableSetupColumn("Limit");
+                ImGui::TableSetupColumn("Range");
+                ImGui::TableHeadersRow();
+                for (size_t i = 0; i < gpus.size() && i < status.limit_w.size(); i++) {
+                    const GPUDevice* device = monitor.getDevice(i);
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("%zu %s", i, gpus[i].name.c_str());
+                    ImGui::TableSetColumnIndex(1);
+                    PowerDemand demand = status.demand[i];
+                    ImGui::TextColored(demand == PowerDemand::Starved ? warning_color : accent_color, "%s",
+                                       powerDemandName(demand));
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%d W", gpus[i].power_usage);
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%u W", status.limit_w[i]);
+                    ImGui::TableSetColumnIndex(4);
+                    ImGui::Text("%u-%u W", device ? device->power_limit_min / 1000 : 0,
+                                device ? device->power_limit_max / 1000 : 0);
+                }
+                ImGui::EndTable();
             }
         }
+        ImGui::End();
+    }
+    
+    void refreshSummaries() {
+        const auto& local = monitor.getGPUs();
+        node_metrics.assign(local);
+        node_metrics.summarize(node_summary);
+        
+        const FleetSnapshot& view = fleet.snapshot();
+        fleet_metrics.resize(local.size() + view.devices.size());
+        for (size_t i = 0; i < local.size(); i++) {
+            fleet_metrics.store(i, local[i]);
+        }
+        for (size_t i = 0; i < view.devices.size(); i++) {
+            fleet_metrics.store(local.size() + i, view.devices[i].gpu);
+        }
+        fleet_metrics.summarize(fleet_summary);
+    }
+    
+    void drawSummaryLine(const char* scope, const MetricSummary& summary) {
+        if (summary.gpu_count == 0) return;
+        ImVec4 temp_color = summary.temperature_max > 80 ? danger_color :
+                            (summary.temperature_max > 70 ? warning_color : accent_color);
+        ImGui::Text("%s: %zu GPUs | %lld / %lld W | %.0f%% mean usage | %lld / %lld MB |", scope, summary.gpu_count,
+                    (long long)summary.power_usage_total, (long long)summary.power_limit_total,
+                    summary.gpu_utilization_mean, (long long)summary.memory_used_total, (long long)summary.memory_total);
+        ImGui::SameLine();
+        ImGui::TextColored(temp_color, "%d-%d°C, p95 %d°C", summary.temperature_min, summary.temperature_max,
+                           summary.temperature_p95);
+    }
+    
+    // Host and index of a fleet_metrics row
+    void fleetRowName(uint32_t row, const char*& host, size_t& index) {
+        const auto& local = monitor.getGPUs();
+        if (row < local.size()) {
+            host = "local";
+            index = row;
+            return;
+        }
+        const FleetSnapshot& view = fleet.snapshot();
+        if (row - local.size() >= view.devices.size()) { // GPUs were re-detected since the summary
+            host = "?";
+            index = row;
+            return;
+        }
+        const FleetDevice& device = view.devices[row - local.size()];
+        const FleetNodeStatus& node = view.nodes[device.node];
+        host = node.hostname.empty() ? node.endpoint.c_str() : node.hostname.c_str();
+        index = device.index;
+    }
+    
+    void drawFleetRow(const char* host, size_t index, const GPUInfo& gpu) {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Text("%s", host);
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%zu", index);
+        ImGui::TableSetColumnIndex(2);
+        if (gpu.stale) {
+            ImGui::TextColored(warning_color, "%s (stale)", gpu.name.c_str());
+        } else {
+            ImGui::Text("%s", gpu.name.c_str());
+        }
+        ImGui::TableSetColumnIndex(3);
+        ImVec4 temp_color = gpu.temperature > 80 ? danger_color : (gpu.temperature > 70 ? warning_color : accent_color);
+        ImGui::TextColored(temp_color, "%d°C", gpu.temperature);
+        ImGui::TableSetColumnIndex(4);
+        ImGui::Text("%d%%", gpu.gpu_utilization);
+        ImGui::TableSetColumnIndex(5);
+        ImGui::Text("%d / %d W", gpu.power_usage, gpu.power_limit);
+        ImGui::TableSetColumnIndex(6);
+        ImGui::Text("%d / %d MHz", gpu.core_clock, gpu.memory_clock);
+        ImGui::TableSetColumnIndex(7);
+        ImGui::Text("%d / %d MB", gpu.memory_used, gpu.memory_total);
+        ImGui::TableSetColumnIndex(8);
+        ImGui::Text("%d%%", gpu.fan_speed);
+    }
+    
+    void drawFleet() {
+        if (!show_fleet) return;
         
-        // Popups
-        if (ImGui::BeginPopupModal("Success", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
-            ImGui::Text("Settings applied successfully!");
+        ImGui::SetNextWindowSize(ImVec2(900, 520), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Fleet", &show_fleet)) {
+            const FleetSnapshot& view = fleet.snapshot();
+            
+            ImGui::Text("Agents");
             ImGui::Separator();
-            if (ImGui::Button("OK", ImVec2(120, 0))) {
-                ImGui::CloseCurrentPopup();
+            ImGui::SetNextItemWidth(250);
+            ImGui::InputText("##fleet_endpoint", fleet_endpoint, sizeof(fleet_endpoint));
+            ImGui::SameLine();
+            if (ImGui::Button("Connect")) {
+                fleet_error = fleet.addAgent(fleet_endpoint) ? "" : "Expected host:port";
             }
-            ImGui::EndPopup();
-        }
-        
-        if (ImGui::BeginPopupModal("Error", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
-            ImGui::Text("Failed to apply settings.");
-            ImGui::Text("Make sure you're running as administrator.");
+            if (!fleet_error.empty()) {
+                ImGui::SameLine();
+                ImGui::TextColored(danger_color, "%s", fleet_error.c_str());
+            }
+            ImGui::TextDisabled("Start agents with: gputune-headless --quiet --fleet-port 9500");
+            
+            if (!view.nodes.empty() &&
+                ImGui::BeginTable("fleet_nodes", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                                  ImVec2(0, tableHeight(view.nodes.size())))) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Endpoint");
+                ImGui::TableSetupColumn("Host");
+                ImGui::TableSetupColumn("Status");
+                ImGui::TableSetupColumn("GPUs");
+                ImGui::TableSetupColumn("Received");
+                ImGui::TableSetupColumn("");
+                ImGui::TableHeadersRow();
+                
+                int64_t now_us = wallClockMicros();
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(view.nodes.size()));
+                while (clipper.Step()) {
+                    for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; n++) {
+                        const FleetNodeStatus& node = view.nodes[n];
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::Text("%s", node.endpoint.c_str());
+                        ImGui::TableSetColumnIndex(1);
+                        ImGui::Text("%s", node.hostname.c_str());
+                        ImGui::TableSetColumnIndex(2);
+                        if (node.connected) {
+                            ImGui::TextColored(accent_color, "%s (%.1fs ago)", node.status.c_str(),
+                                               (now_us - node.last_update_us) / 1e6);
+                        } else {
+                            ImGui::TextColored(warning_color, "%s", node.status.c_str());
+                        }
+                        ImGui::TableSetColumnIndex(3);
+                        ImGui::Text("%zu", node.gpu_count);
+                        ImGui::TableSetColumnIndex(4);
+                        ImGui::Text("%.1f KB", node.bytes_received / 1024.0);
+                        ImGui::TableSetColumnIndex(5);
+                        ImGui::PushID(n);
+                        if (ImGui::Button("Remove")) {
+                            fleet.removeAgent(node.endpoint);
+                        }
+                        ImGui::PopID();
+                    }
+                }
+                ImGui::EndTable();
+            }
+            
+            // Local GPUs first, then every agent's, in one table
+            ImGui::Spacing();
+            ImGui::Text("Devices");
             ImGui::Separator();
-            if (ImGui::Button("OK", ImVec2(120, 0))) {
-                ImGui::CloseCurrentPopup();
+            drawSummaryLine("Fleet", fleet_summary);
+            if (!fleet_summary.hottest.empty()) {
+                ImGui::Text("Hottest:");
+                for (uint32_t row : fleet_summary.hottest) {
+                    const char* host;
+                    size_t index;
+                    fleetRowName(row, host, index);
+                    ImGui::SameLine();
+                    ImGui::Text("%s #%zu (%d°C)", host, index, fleet_metrics.column(LiveMetric::Temperature)[row]);
+                }
+            }
+            if (ImGui::BeginTable("fleet_devices", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                  ImGuiTableFlags_ScrollY)) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Host");
+                ImGui::TableSetupColumn("GPU");
+                ImGui::TableSetupColumn("Name");
+                ImGui::TableSetupColumn("Temp");
+                ImGui::TableSetupColumn("Usage");
+                ImGui::TableSetupColumn("Power");
+                ImGui::TableSetupColumn("Core / Memory");
+                ImGui::TableSetupColumn("VRAM");
+                ImGui::TableSetupColumn("Fan");
+                ImGui::TableHeadersRow();
+                
+                const auto& local = monitor.getGPUs();
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(local.size() + view.devices.size()));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                        if (static_cast<size_t>(row) < local.size()) {
+                            drawFleetRow("local", row, local[row]);
+                            continue;
+                        }
+                        const FleetDevice& device = view.devices[row - local.size()];
+                        const FleetNodeStatus& node = view.nodes[device.node];
+                        drawFleetRow(node.hostname.empty() ? node.endpoint.c_str() : node.hostname.c_str(),
+                                     device.index, device.gpu);
+                    }
+                }
+                ImGui::EndTable();
             }
-            ImGui::EndPopup();
         }
+        ImGui::End();
     }
     
     void drawAbout() {
@@ -593,7 +1348,7 @@ public:
             ImGui::BulletText("Core and memory clock adjustment");
             ImGui::BulletText("Custom fan curves");
             ImGui::BulletText("Power limit management");
-            ImGui::BulletText("Cross-platform support (Windows/macOS)");
+            ImGui::BulletText("Cross-platform support (Windows/Linux/macOS)");
             ImGui::Spacing();
             
             ImGui::Text("Supported GPUs:");
@@ -611,13 +1366,7 @@ public:
     }
     
     void render() {
-        // Update GPU data every second
-        auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update).count() > 1000) {
-            monitor.updateAllGPUs();
-            last_update = now;
-        }
-        
+        auto phase_start = std::chrono::steady_clock::now();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -643,8 +1392,11 @@ public:
         // Menu Bar
         if (ImGui::BeginMenuBar()) {
             if (ImGui::BeginMenu("File")) {
+                if (ImGui::MenuItem("Compact Overlay", "F9")) {
+                    overlay_toggle_requested = true;
+                }
                 if (ImGui::MenuItem("Refresh GPUs", "F5")) {
-                    monitor.detectGPUs();
+                    monitor.requestRescan();
                 }
                 ImGui::Separator();
                 if (ImGui::MenuItem("Exit", "Alt+F4")) {
@@ -654,14 +1406,33 @@ public:
             }
             
             if (ImGui::BeginMenu("Tools")) {
+                if (ImGui::MenuItem("Recording & Replay...")) {
+                    show_recording = true;
+                }
+                if (ImGui::MenuItem("Fleet...")) {
+                    show_fleet = true;
+                }
+                if (ImGui::MenuItem("Event Log...")) {
+                    show_events = true;
+                }
+                if (ImGui::MenuItem("Alert Rules...")) {
+                    show_alerts = true;
+                }
+                if (ImGui::MenuItem("Diagnostics...")) {
+                    show_diagnostics = true;
+                }
+                if (ImGui::MenuItem("Power Budget...")) {
+                    show_power_budget = true;
+                }
+                ImGui::Separator();
                 if (ImGui::MenuItem("Reset All Settings")) {
                     // Reset all GPU settings to default
                 }
                 if (ImGui::MenuItem("Export Profile")) {
-                    // Export current tuning profile
+                    show_profiles = true;
                 }
                 if (ImGui::MenuItem("Import Profile")) {
-                    // Import tuning profile
+                    show_profiles = true;
                 }
                 ImGui::EndMenu();
             }
@@ -677,6 +1448,10 @@ public:
             }
             
             // Status indicators in menu bar
+            if (monitor.isRescanPending()) {
+                ImGui::SetCursorPosX(ImGui::GetWindowWidth() - 440);
+                ImGui::TextDisabled(tuner.isAnyRunning() ? "GPU scan waits for auto-tune" : "Scanning for GPUs...");
+            }
             ImGui::SetCursorPosX(ImGui::GetWindowWidth() - 300);
             auto& gpus = monitor.getGPUs();
             if (!gpus.empty() && selected_gpu < gpus.size()) {
@@ -735,60 +1510,372 @@ public:
         ImGui::End(); // Main window
         
         drawAbout();
-        
-        // Rendering
+        drawRecording();
+        drawFleet();
+        drawEventLog();
+        drawAlerts();
+        drawDiagnostics();
+        drawProfiles();
+        drawPowerBudget();
+        
+        presentFrame(phase_start);
+    }
+    
+    // Renders what ImGui built and swaps; phase_start is when the frame began
+    void presentFrame(std::chrono::steady_clock::time_point phase_start) {
         ImGui::Render();
+        phase_start = ui_build_latency.recordSince(phase_start);
+        ImDrawData* draw_data = ImGui::GetDrawData();
+        frame_vertex_bytes = draw_data->TotalVtxCount * sizeof(ImDrawVert) + draw_data->TotalIdxCount * sizeof(ImDrawIdx);
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
         glViewport(0, 0, display_w, display_h);
         glClearColor(0.08f, 0.08f, 0.08f, 1.00f);
         glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        ImGui_ImplOpenGL3_RenderDrawData(draw_data);
+        phase_start = gl_submit_latency.recordSince(phase_start);
         
         glfwSwapBuffers(window);
+        swap_latency.recordSince(phase_start);
+        
+        auto snapshot_time = monitor.displayedSnapshotTime();
+        if (snapshot_time != std::chrono::steady_clock::time_point()) {
+            data_age.recordSince(snapshot_time);
+        }
+    }
+    
+    const char* durationLabel(uint64_t ns) {
+        if (ns < 1000) return frame_arena.format("%llu ns", (unsigned long long)ns);
+        if (ns < 1000000) return frame_arena.format("%.1f us", ns / 1e3);
+        if (ns < 1000000000) return frame_arena.format("%.2f ms", ns / 1e6);
+        return frame_arena.format("%.2f s", ns / 1e9);
+    }
+    
+    void drawLatencyRow(const char* name, const LatencyHistogram& histogram) {
+        LatencyHistogram::Summary summary = histogram.summarize();
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", (unsigned long long)summary.count);
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(durationLabel(summary.p50_ns));
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(durationLabel(summary.p99_ns));
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(durationLabel(summary.max_ns));
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(durationLabel(summary.sum_ns));
+    }
+    
+    bool beginLatencyTable(const char* id) {
+        if (!ImGui::BeginTable(id, 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) return false;
+        ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("Max");
+        ImGui::TableSetupColumn("Total");
+        ImGui::TableHeadersRow();
+        return true;
+    }
+    
+    // The tool's own overhead: frame phases, sampler sweeps and every NVML call
+    void drawDiagnostics() {
+        if (!show_diagnostics) return;
+        
+        ImGui::SetNextWindowSize(ImVec2(620, 520), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Diagnostics", &show_diagnostics)) {
+            ImGui::TextWrapped("Time spent by gputune itself. Percentiles are histogram bucket bounds, "
+                               "within 12.5%% of the true value.");
+            if (ImGui::Button("Reset")) {
+                frame_latency.reset();
+                ui_build_latency.reset();
+                gl_submit_latency.reset();
+                swap_latency.reset();
+                data_age.reset();
+                monitor.sweepLatency().reset();
+                monitor.forEachNvmlCallLatency([](const char*, LatencyHistogram& latency) { latency.reset(); });
+            }
+            
+            ImGui::Spacing();
+            ImGui::Text("Frame");
+            if (beginLatencyTable("frame_latency_table")) {
+                drawLatencyRow("Frame", frame_latency);
+                drawLatencyRow("UI build", ui_build_latency);
+                drawLatencyRow("GL submit", gl_submit_latency);
+                drawLatencyRow("Swap (incl. vsync)", swap_latency);
+                drawLatencyRow("Data age at present", data_age);
+                ImGui::EndTable();
+            }
+            
+            ImGui::Spacing();
+            ImGui::Text("Sampler & NVML calls");
+            if (beginLatencyTable("sampler_latency_table")) {
+                drawLatencyRow("Sweep (all GPUs)", monitor.sweepLatency());
+                monitor.forEachNvmlCallLatency([this](const char* function, const LatencyHistogram& latency) {
+                    if (latency.getCount() > 0) drawLatencyRow(function, latency);
+                });
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
+    
+    // Finest rollup tier that covers span_seconds in at most one bucket per pixel,
+    // or -1 if the raw samples should be plotted directly
+    static int rollupTierForSpan(int span_seconds, float width_px) {
+        if (span_seconds <= 120) return -1;
+        int64_t span_us = span_seconds * 1000000LL;
+        size_t max_points = std::min(kRollupCapacity, static_cast<size_t>(std::max(width_px, 64.0f)));
+        for (int tier = 0; tier < kRollupTierCount; tier++) {
+            if (span_us / kRollupPeriodsUs[tier] <= static_cast<int64_t>(max_points)) return tier;
+        }
+        return kRollupTierCount - 1;
+    }
+    
+    // Last frame's peak rounded up to 1, 2 or 5 times a power of ten, at least 100
+    float throughputScale(HistoryMetric metric) const {
+        static const float kSteps[] = {1.0f, 2.0f, 5.0f};
+        float peak = history_plot.windowPeak(metric);
+        if (!(peak < 1e9f)) peak = 1e9f; // Also catches NaN, which would never match a step
+        for (float decade = 100.0f;; decade *= 10.0f) {
+            for (float step : kSteps) {
+                if (peak <= step * decade) return step * decade;
+            }
+        }
+    }
+    
+    void drawHistoryGraph(HistoryMetric metric, int64_t since_us, int span_seconds, float scale_max) {
+        float width = ImGui::GetContentRegionAvail().x;
+        int tier = rollupTierForSpan(span_seconds, width);
+        
+        // A replay feeds the graphs from its own history store, on the recording's timebase
+        const MetricHistory* history = replay.isOpen() ? replay.history(selected_gpu, metric)
+                                                       : monitor.history(selected_gpu, metric);
+        ImVec4 band_color(primary_color.x, primary_color.y, primary_color.z, 0.35f);
+        history_plot.draw(metric, history, tier, since_us, scale_max, ImGui::GetStyle().Colors[ImGuiCol_PlotLines],
+                          band_color, ImVec2(width, 80));
+        if (!replay.isOpen()) { // Events aren't part of recordings
+            drawEventMarkers(metric, since_us);
+        }
+    }
+    
+    ImVec4 eventColor(const GPUEvent& event) const {
+        switch (event.kind) {
+            case GPUEventKind::Throttle: return event.data ? warning_color : accent_color;
+            case GPUEventKind::EccSingleBit: return warning_color;
+            case GPUEventKind::Alert: return event.data & kAlertClearedBit ? accent_color : danger_color;
+            default: return danger_color;
+        }
+    }
+    
+    // Vertical line per event of the selected GPU over the chart just drawn,
+    // with the event in a tooltip when the mouse is on it
+    void drawEventMarkers(HistoryMetric metric, int64_t since_us) {
+        ImVec2 rect_min = ImGui::GetItemRectMin();
+        ImVec2 rect_max = ImGui::GetItemRectMax();
+        bool hovered = ImGui::IsItemHovered();
+        float mouse_x = ImGui::GetIO().MousePos.x;
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        
+        for (const GPUEvent& event : events) {
+            if (event.gpu_index != selected_gpu || event.timestamp_us <= since_us) continue;
+            float x = history_plot.timeToX(metric, event.timestamp_us);
+            if (x < 0.0f) continue;
+            draw_list->AddLine(ImVec2(x, rect_min.y), ImVec2(x, rect_max.y), ImGui::GetColorU32(eventColor(event)));
+            if (hovered && mouse_x > x - 3.0f && mouse_x < x + 3.0f) {
+                char text[128];
+                monitor.formatEvent(event, text, sizeof(text));
+                ImGui::SetTooltip("%s", text);
+            }
+        }
+    }
+    
+    void refreshEvents() {
+        uint64_t version = monitor.events().getVersion();
+        if (version == events_version) return;
+        monitor.events().copySince(INT64_MIN, events);
+        events_version = version;
+    }
+    
+    void refreshAlerts() {
+        uint64_t version = monitor.alerts().getVersion();
+        if (version == alert_status_version) return;
+        monitor.alerts().copyStatus(alert_status);
+        alert_status_version = version;
+    }
+    
+    void applyAlertRules() {
+        std::vector<std::string> lines;
+        const char* line = alert_rules_text;
+        while (*line) {
+            const char* end = std::strchr(line, '\n');
+            if (!end) end = line + std::strlen(line);
+            lines.emplace_back(line, end);
+            line = *end ? end + 1 : end;
+        }
+        if (monitor.alerts().setRules(lines, alert_error)) alert_error.clear();
+    }
+    
+    void drawAlerts() {
+        if (!show_alerts) return;
+        
+        ImGui::SetNextWindowSize(ImVec2(560, 400), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Alert Rules", &show_alerts)) {
+            ImGui::TextWrapped("One rule per line, checked on every sample of every GPU, e.g. \"temp > 85 for 30s\" "
+                               "or \"power spike > 20%%/s\". Alerts are logged as events and exported as metrics.");
+            ImGui::TextDisabled("Metrics: %s", alertMetricList().c_str());
+            ImGui::InputTextMultiline("##alert_rules", alert_rules_text, sizeof(alert_rules_text), ImVec2(-1, 110));
+            if (ImGui::Button("Apply Rules")) {
+                applyAlertRules();
+            }
+            if (!alert_error.empty()) {
+                ImGui::SameLine();
+                ImGui::TextColored(danger_color, "%s", alert_error.c_str());
+            }
+            
+            const auto& gpus = monitor.getGPUs();
+            if (alert_status.empty()) {
+                ImGui::TextDisabled("No rules active");
+            } else if (ImGui::BeginTable("alert_table", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("Rule");
+                ImGui::TableSetupColumn("Firing on");
+                ImGui::TableSetupColumn("Fired");
+                ImGui::TableHeadersRow();
+                for (const AlertEngine::RuleStatus& rule : alert_status) {
+                    char firing[128] = "";
+                    size_t used = 0;
+                    uint64_t fired = 0;
+                    for (size_t i = 0; i < rule.active.size() && i < gpus.size(); i++) {
+                        fired += rule.fired[i];
+                        if (!rule.active[i] || used >= sizeof(firing)) continue;
+                        int written = std::snprintf(firing + used, sizeof(firing) - used, "%sGPU %zu", used ? ", " : "", i);
+                        if (written > 0) used = std::min(sizeof(firing) - 1, used + static_cast<size_t>(written));
+                    }
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(rule.text.c_str());
+                    ImGui::TableNextColumn();
+                    if (firing[0]) {
+                        ImGui::TextColored(danger_color, "%s", firing);
+                    } else {
+                        ImGui::TextDisabled("-");
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%llu", (unsigned long long)fired);
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
+    
+    void drawEventLog() {
+        if (!show_events) return;
+        
+        ImGui::SetNextWindowSize(ImVec2(560, 360), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Event Log", &show_events)) {
+            ImGui::TextWrapped("Clock throttling changes, alerts and driver-reported XID/ECC events, newest first. "
+                               "They are also marked on the performance graphs.");
+            if (events.empty()) {
+                ImGui::TextDisabled("No events since the GPUs were detected");
+            } else if (ImGui::BeginTable("event_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                         ImGuiTableFlags_ScrollY, ImVec2(0, 0))) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Time");
+                ImGui::TableSetupColumn("GPU");
+                ImGui::TableSetupColumn("Event");
+                ImGui::TableSetupColumn("Detail");
+                ImGui::TableHeadersRow();
+                
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(events.size()));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                        const GPUEvent& event = events[events.size() - 1 - row];
+                        time_t seconds = static_cast<time_t>(event.timestamp_us / 1000000);
+                        char time_text[32] = "";
+                        if (const struct tm* local = localtime(&seconds)) {
+                            strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", local);
+                        }
+                        char detail[128];
+                        monitor.formatEvent(event, detail, sizeof(detail));
+                        
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(time_text);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%u", event.gpu_index);
+                        ImGui::TableNextColumn();
+                        ImGui::TextColored(eventColor(event), "%s", gpuEventKindName(event.kind));
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(detail);
+                    }
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
     }
     
     void drawPerformanceGraphs() {
-        static std::vector<float> temp_history(100, 0.0f);
-        static std::vector<float> gpu_util_history(100, 0.0f);
-        static std::vector<float> power_history(100, 0.0f);
-        static std::vector<float> memory_history(100, 0.0f);
-        static int history_offset = 0;
+        static const int kSpanSeconds[] = {60, 600, 3600, 6 * 3600, 24 * 3600};
+        static const char* kSpanLabels[] = {"Last minute", "Last 10 minutes", "Last hour", "Last 6 hours", "Last day"};
         
-        auto& gpus = monitor.getGPUs();
+        const auto& gpus = replay.isOpen() ? replay.getGPUs() : monitor.getGPUs();
         if (!gpus.empty() && selected_gpu < gpus.size()) {
             const auto& gpu = gpus[selected_gpu];
+            int span_seconds = kSpanSeconds[graph_span_index];
+            int64_t now_us = replay.isOpen() ? replay.currentTime() : wallClockMicros();
+            int64_t since_us = now_us - span_seconds * 1000000LL;
             
-            // Update history data
-            temp_history[history_offset] = gpu.temperature;
-            gpu_util_history[history_offset] = gpu.gpu_utilization;
-            power_history[history_offset] = gpu.power_usage;
-            memory_history[history_offset] = (float)gpu.memory_used / gpu.memory_total * 100.0f;
-            
-            history_offset = (history_offset + 1) % 100;
-            
-            ImGui::Text("Real-time Performance Graphs");
+            ImGui::Text("Performance Graphs");
+            ImGui::SameLine();
+            ImGui::Combo("##graph_span", &graph_span_index, kSpanLabels, IM_ARRAYSIZE(kSpanLabels));
+            if (replay.isOpen()) {
+                const char* position = traceOffsetLabel(replay.currentTime() - replay.startTime());
+                ImGui::SameLine();
+                ImGui::TextColored(warning_color, "Replay %s %s", position, gpu.name.c_str());
+            }
             ImGui::Separator();
             
             // Temperature Graph
             ImGui::Text("Temperature (°C)");
-            ImGui::PlotLines("##temp", temp_history.data(), temp_history.size(), 
-                           history_offset, nullptr, 0.0f, 100.0f, ImVec2(0, 80));
+            drawHistoryGraph(HistoryMetric::Temperature, since_us, span_seconds, 100.0f);
             
             // GPU Utilization Graph
             ImGui::Text("GPU Utilization (%%)");
-            ImGui::PlotLines("##gpu_util", gpu_util_history.data(), gpu_util_history.size(), 
-                           history_offset, nullptr, 0.0f, 100.0f, ImVec2(0, 80));
+            drawHistoryGraph(HistoryMetric::GPUUtilization, since_us, span_seconds, 100.0f);
             
             // Power Usage Graph
             ImGui::Text("Power Usage (W)");
-            ImGui::PlotLines("##power", power_history.data(), power_history.size(), 
-                           history_offset, nullptr, 0.0f, (float)gpu.power_limit, ImVec2(0, 80));
+            drawHistoryGraph(HistoryMetric::Power, since_us, span_seconds, (float)gpu.power_limit);
             
             // Memory Usage Graph
             ImGui::Text("Memory Usage (%%)");
-            ImGui::PlotLines("##memory", memory_history.data(), memory_history.size(), 
-                           history_offset, nullptr, 0.0f, 100.0f, ImVec2(0, 80));
+            drawHistoryGraph(HistoryMetric::MemoryUsage, since_us, span_seconds, 100.0f);
+            
+            // Core Clock Graph; throttle markers line up with its drops
+            ImGui::Text("Core Clock (MHz)");
+            drawHistoryGraph(HistoryMetric::CoreClock, since_us, span_seconds, 3000.0f);
+            
+            // Throughput has no fixed maximum, so those charts scale to what they showed last frame
+            ImGui::Text("PCIe TX (MB/s)");
+            drawHistoryGraph(HistoryMetric::PCIeTx, since_us, span_seconds, throughputScale(HistoryMetric::PCIeTx));
+            ImGui::Text("PCIe RX (MB/s)");
+            drawHistoryGraph(HistoryMetric::PCIeRx, since_us, span_seconds, throughputScale(HistoryMetric::PCIeRx));
+            if (!gpu.nvlinks.empty() || gpu.nvlink_tx > 0 || gpu.nvlink_rx > 0) {
+                ImGui::Text("NVLink TX, all links (MB/s)");
+                drawHistoryGraph(HistoryMetric::NVLinkTx, since_us, span_seconds, throughputScale(HistoryMetric::NVLinkTx));
+                ImGui::Text("NVLink RX, all links (MB/s)");
+                drawHistoryGraph(HistoryMetric::NVLinkRx, since_us, span_seconds, throughputScale(HistoryMetric::NVLinkRx));
+            }
+            
+            ImGui::Text("Video Encoder (%%)");
+            drawHistoryGraph(HistoryMetric::EncoderUtilization, since_us, span_seconds, 100.0f);
+            ImGui::Text("Video Decoder (%%)");
+            drawHistoryGraph(HistoryMetric::DecoderUtilization, since_us, span_seconds, 100.0f);
         } else {
             ImGui::Text("No GPU data available for graphing");
         }
@@ -820,7 +1907,7 @@ public:
         // NVML Status
         ImGui::Text("NVML Status:");
         ImGui::SameLine(200);
-        if (monitor.nvml_initialized) {
+        if (monitor.isNVMLAvailable()) {
             ImGui::PushStyleColor(ImGuiCol_Text, accent_color);
             ImGui::Text("✓ Available");
             ImGui::PopStyleColor();
@@ -836,41 +1923,51 @@ public:
         
         // GPU Details List
         ImGui::Text("GPU Details");
-        if (ImGui::BeginTable("gpu_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        if (ImGui::BeginTable("gpu_table", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+                              ImVec2(0, tableHeight(gpus.size())))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
             ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("Bus ID");
             ImGui::TableSetupColumn("Memory");
             ImGui::TableSetupColumn("Driver");
             ImGui::TableSetupColumn("Status");
             ImGui::TableHeadersRow();
             
-            for (size_t i = 0; i < gpus.size(); i++) {
-                const auto& gpu = gpus[i];
-                ImGui::TableNextRow();
-                
-                ImGui::TableSetColumnIndex(0);
-                if (i == selected_gpu) {
-                    ImGui::PushStyleColor(ImGuiCol_Text, primary_color);
-                    ImGui::Text("► %s", gpu.name.c_str());
-                    ImGui::PopStyleColor();
-                } else {
-                    ImGui::Text("%s", gpu.name.c_str());
-                }
-                
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%d MB", gpu.memory_total);
-                
-                ImGui::TableSetColumnIndex(2);
-                ImGui::Text("%s", gpu.driver_version.c_str());
-                
-                ImGui::TableSetColumnIndex(3);
-                if (gpu.is_nvidia) {
-                    ImGui::PushStyleColor(ImGuiCol_Text, accent_color);
-                    ImGui::Text("✓ Active");
-                    ImGui::PopStyleColor();
-                } else {
-                    ImGui::PushStyleColor(ImGuiCol_Text, warning_color);
-                    ImGui::Text("⚠ Limited");
-                    ImGui::PopStyleColor();
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(gpus.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    const auto& gpu = gpus[i];
+                    ImGui::TableNextRow();
+                    
+                    ImGui::TableSetColumnIndex(0);
+                    if (i == selected_gpu) {
+                        ImGui::PushStyleColor(ImGuiCol_Text, primary_color);
+                        ImGui::Text("► %s", gpu.name.c_str());
+                        ImGui::PopStyleColor();
+                    } else {
+                        ImGui::Text("%s", gpu.name.c_str());
+                    }
+                    
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%s", gpu.pci_bus_id.c_str());
+                    
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%d MB", gpu.memory_total);
+                    
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%s", gpu.driver_version.c_str());
+                    
+                    ImGui::TableSetColumnIndex(4);
+                    if (gpu.is_nvidia) {
+                        ImGui::PushStyleColor(ImGuiCol_Text, accent_color);
+                        ImGui::Text("✓ Active");
+                        ImGui::PopStyleColor();
+                    } else {
+                        ImGui::PushStyleColor(ImGuiCol_Text, warning_color);
+                        ImGui::Text("⚠ Limited");
+                        ImGui::PopStyleColor();
+                    }
                 }
             }
             ImGui::EndTable();
@@ -880,6 +1977,43 @@ public:
         ImGui::Separator();
         ImGui::Spacing();
         
+        // Display
+        ImGui::Text("Display");
+        ImGui::Checkbox("Low-power redraw (only on input or new data)", &low_power_mode);
+        ImGui::SliderInt("Background frame cap (FPS)", &background_frame_cap, 1, 30);
+        ImGui::Text("Last frame: %.1f KB of vertex and index data", frame_vertex_bytes / 1024.0);
+        if (ImGui::Button("Compact Overlay (F9)")) {
+            overlay_toggle_requested = true;
+        }
+#ifdef GPUTUNE_COUNT_ALLOCATIONS
+        ImGui::Text("Heap allocations last frame: %llu (%llu allocating frames since warm-up)",
+                    (unsigned long long)frame_allocations, (unsigned long long)allocating_frames);
+        ImGui::Text("Frame arena: %zu bytes used, %zu peak", frame_arena.bytesUsed(), frame_arena.peakBytes());
+#endif
+        
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+        
+        // Sampling Intervals
+        ImGui::Text("Sampling Intervals (ms)");
+        bool batch_sampling = monitor.isBatchSampling();
+        if (ImGui::Checkbox("Batch-ingest NVML sample buffers", &batch_sampling)) {
+            monitor.setBatchSampling(batch_sampling);
+        }
+        for (int i = 0; i < kMetricGroupCount; i++) {
+            MetricGroup group = static_cast<MetricGroup>(i);
+            int interval = static_cast<int>(monitor.getSampleInterval(group).count());
+            int max_interval = group == MetricGroup::Limits ? 60000 : 5000;
+            if (ImGui::SliderInt(metricGroupName(group), &interval, 50, max_interval)) {
+                monitor.setSampleInterval(group, std::chrono::milliseconds(interval));
+            }
+        }
+        
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+        
         // System Requirements
         ImGui::Text("Requirements & Recommendations");
         ImGui::BulletText("NVIDIA GPU with driver version 450+ for full functionality");
@@ -897,24 +2031,273 @@ public:
         ImGui::PopStyleColor();
     }
     
+    // Rebuilds the overlay's lines from the UI view; returns true if any text or color changed
+    bool refreshOverlayRows() {
+        const auto& gpus = monitor.getGPUs();
+        overlay_scratch.clear();
+        auto addRow = [&](size_t index) {
+            const GPUInfo& gpu = gpus[index];
+            OverlayRow row;
+            std::memset(&row, 0, sizeof(row)); // Padding too, so rows compare with memcmp
+            std::snprintf(row.name, sizeof(row.name), "GPU %zu", index);
+            std::snprintf(row.temperature, sizeof(row.temperature), "%d°C", gpu.temperature);
+            std::snprintf(row.power, sizeof(row.power), "%dW", gpu.power_usage);
+            std::snprintf(row.utilization, sizeof(row.utilization), "%d%%", gpu.gpu_utilization);
+            row.temperature_c = gpu.temperature;
+            row.power_high = gpu.power_usage > (gpu.power_limit * 0.9f);
+            row.utilization_high = gpu.gpu_utilization > 90;
+            for (const AlertEngine::RuleStatus& rule : alert_status) {
+                if (index < rule.active.size() && rule.active[index]) row.alert = true;
+            }
+            overlay_scratch.push_back(row);
+        };
+        
+        char summary[sizeof(overlay_summary)] = "";
+        if (gpus.size() <= kOverlayMaxRows) {
+            for (size_t i = 0; i < gpus.size(); i++) addRow(i);
+        } else {
+            std::snprintf(summary, sizeof(summary), "%zu GPUs  %lldW  %.0f%%", node_summary.gpu_count,
+                          (long long)node_summary.power_usage_total, node_summary.gpu_utilization_mean);
+            for (uint32_t row : node_summary.hottest) {
+                if (row < gpus.size()) addRow(row);
+            }
+        }
+        
+        bool changed = std::strcmp(summary, overlay_summary) != 0 || overlay_scratch.size() != overlay_rows.size() ||
+                       (!overlay_rows.empty() &&
+                        std::memcmp(overlay_scratch.data(), overlay_rows.data(), overlay_rows.size() * sizeof(OverlayRow)) != 0);
+        if (changed) {
+            overlay_rows.swap(overlay_scratch);
+            std::memcpy(overlay_summary, summary, sizeof(summary));
+        }
+        return changed;
+    }
+    
+    // True when the pointer over the overlay moved or a button changed, so ImGui
+    // gets frames for hover, clicks and drags and none otherwise
+    bool overlayInputChanged() {
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
+        bool hovered = glfwGetWindowAttrib(window, GLFW_HOVERED) != 0;
+        int state = (hovered ? 1 : 0) | (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS ? 2 : 0);
+        bool changed = state != overlay_mouse_state || (hovered && (x != overlay_cursor_x || y != overlay_cursor_y));
+        overlay_mouse_state = state;
+        overlay_cursor_x = x;
+        overlay_cursor_y = y;
+        return changed;
+    }
+    
+    void setOverlayMode(bool enabled) {
+        if (enabled == overlay_mode) return;
+        overlay_mode = enabled;
+        if (enabled) {
+            glfwGetWindowPos(window, &saved_window_x, &saved_window_y);
+            glfwGetWindowSize(window, &saved_window_w, &saved_window_h);
+            glfwSetWindowAttrib(window, GLFW_DECORATED, GLFW_FALSE);
+            glfwSetWindowAttrib(window, GLFW_FLOATING, GLFW_TRUE);
+            glfwSetWindowSize(window, 200, 40); // Fitted to the text once it has been laid out
+            overlay_rows.clear();
+            refreshOverlayRows();
+        } else {
+            glfwSetWindowAttrib(window, GLFW_DECORATED, GLFW_TRUE);
+            glfwSetWindowAttrib(window, GLFW_FLOATING, GLFW_FALSE);
+            glfwSetWindowSize(window, saved_window_w, saved_window_h);
+            glfwSetWindowPos(window, saved_window_x, saved_window_y);
+        }
+        overlay_dragging = false;
+        overlay_redraw_frames = kSettleFrames;
+    }
+    
+    // Text only, no rounding or anti-aliased fills: a few hundred vertices per frame
+    void renderOverlay() {
+        auto phase_start = std::chrono::steady_clock::now();
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        
+        ImGuiStyle& style = ImGui::GetStyle();
+        bool anti_aliased_fill = style.AntiAliasedFill;
+        style.AntiAliasedFill = false;
+        ImGui::SetNextWindowPos(ImGui::GetMainViewport()->Pos);
+        ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
+        ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(8.0f, 4.0f));
+        ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                                 ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_NoMove;
+        ImGui::Begin("GPUTune Overlay", nullptr, flags);
+        ImGui::PopStyleVar(2);
+        
+        if (overlay_summary[0]) ImGui::TextUnformatted(overlay_summary);
+        if (overlay_rows.empty()) ImGui::TextDisabled("No GPUs");
+        for (const OverlayRow& row : overlay_rows) {
+            ImVec4 temp_color = row.temperature_c > 80 ? danger_color : (row.temperature_c > 70 ? warning_color : accent_color);
+            if (row.alert) {
+                ImGui::TextColored(danger_color, "%s!", row.name);
+            } else {
+                ImGui::TextUnformatted(row.name);
+            }
+            ImGui::SameLine();
+            ImGui::TextColored(temp_color, "%s", row.temperature);
+            ImGui::SameLine();
+            ImGui::TextColored(row.power_high ? warning_color : accent_color, "%s", row.power);
+            ImGui::SameLine();
+            ImGui::TextColored(row.utilization_high ? warning_color : primary_color, "%s", row.utilization);
+        }
+        
+        // Borderless, so a drag anywhere moves the window; a double-click goes back to the full window
+        bool hovered = ImGui::IsWindowHovered();
+        if (hovered && ImGui::IsMouseDoubleClicked(0)) {
+            overlay_toggle_requested = true;
+        } else if (hovered && ImGui::IsMouseClicked(0)) {
+            double x, y;
+            glfwGetCursorPos(window, &x, &y);
+            glfwGetWindowPos(window, &drag_window_x, &drag_window_y);
+            drag_screen_x = drag_window_x + x;
+            drag_screen_y = drag_window_y + y;
+            overlay_dragging = true;
+        }
+        if (overlay_dragging && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+            double x, y;
+            int window_x, window_y;
+            glfwGetCursorPos(window, &x, &y);
+            glfwGetWindowPos(window, &window_x, &window_y);
+            glfwSetWindowPos(window, drag_window_x + static_cast<int>(window_x + x - drag_screen_x),
+                             drag_window_y + static_cast<int>(window_y + y - drag_screen_y));
+        } else {
+            overlay_dragging = false;
+        }
+        // Fit the OS window to the text; the new size shows from the next frame
+        ImVec2 size = ImGui::GetWindowSize();
+        int window_w, window_h;
+        glfwGetWindowSize(window, &window_w, &window_h);
+        if (static_cast<int>(size.x) != window_w || static_cast<int>(size.y) != window_h) {
+            glfwSetWindowSize(window, static_cast<int>(size.x), static_cast<int>(size.y));
+            overlay_redraw_frames = std::max(overlay_redraw_frames, 1);
+        }
+        ImGui::End();
+        style.AntiAliasedFill = anti_aliased_fill;
+        
+        presentFrame(phase_start);
+    }
+    
     void run() {
+        // Wake the event loop whenever the sampler publishes (glfwPostEmptyEvent is thread-safe)
+        monitor.setSnapshotListener([] { glfwPostEmptyEvent(); });
+        fleet.setUpdateListener([] { glfwPostEmptyEvent(); });
+        
+        int settle_frames = kSettleFrames;
+        double last_frame_time = 0.0;
+        refreshSummaries(); // From detection's initial sweep, until the sampler publishes
+        uint64_t frame_number = 0;
+        
         while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+            bool minimized = glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0;
+            bool background = minimized || !glfwGetWindowAttrib(window, GLFW_FOCUSED);
+            bool replaying = replay.isOpen() && !replay.isPaused() && !replay.isFinished();
+            
+            bool waited = false;
+            if ((!low_power_mode || replaying) && !background && !overlay_mode) {
+                glfwPollEvents();
+            } else if (settle_frames > 0 && !background) {
+                glfwPollEvents();
+                settle_frames--;
+            } else {
+                // Sleeps until input, a new snapshot or the idle timeout
+                glfwWaitEventsTimeout(kIdleRedrawSeconds);
+                waited = true;
+            }
+            
+            // Frame cap while minimized or unfocused. Input received meanwhile is
+            // queued by the ImGui backend and handled on the next frame.
+            if (background) {
+                double min_interval = 1.0 / std::max(1, background_frame_cap);
+                double elapsed = glfwGetTime() - last_frame_time;
+                while (elapsed < min_interval && !glfwWindowShouldClose(window)) {
+                    glfwWaitEventsTimeout(min_interval - elapsed);
+                    elapsed = glfwGetTime() - last_frame_time;
+                }
+            }
+            
+            ScopedLatencyTimer frame_timer(frame_latency);
+            uint64_t allocations_before = allocationCount();
+            frame_arena.reset();
+            
+            // Pick up the latest sweep from the background sampler (never blocks on NVML)
+            bool fresh_data = monitor.pollSnapshot();
+            if (fresh_data) gpu_text_stale = true;
+            if (fleet.fetch()) fresh_data = true;
+            refreshEvents();
+            refreshAlerts();
+            if (fresh_data) refreshSummaries();
+            if (waited && !fresh_data) {
+                settle_frames = kSettleFrames; // Woken by input rather than the sampler
+            }
+            
+            double now = glfwGetTime();
+            replay.update(now - last_replay_update);
+            last_replay_update = now;
             
             // Handle keyboard shortcuts
-            if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS) {
-                monitor.detectGPUs();
+            bool f5_down = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+            if (f5_down && !f5_was_down) {
+                monitor.requestRescan();
+            }
+            f5_was_down = f5_down;
+            bool f9_down = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+            if (f9_down && !f9_was_down) {
+                overlay_toggle_requested = true;
+            }
+            f9_was_down = f9_down;
+            
+            // A finished scan changes device indices, so it waits while auto-tune runs
+            if (monitor.isRescanPending()) {
+                const auto& current = monitor.getGPUs();
+                std::string selected_uuid =
+                    static_cast<size_t>(selected_gpu) < current.size() ? current[selected_gpu].uuid : std::string();
+                if (monitor.applyRescan(!tuner.isAnyRunning())) {
+                    onDevicesChanged(selected_uuid);
+                }
+            }
+            
+            // Both drive power limits, so balancing pauses while auto-tune runs
+            if (!tuner.isAnyRunning()) {
+                power_balancer.update();
+            }
+            
+            if (minimized) {
+                // Nothing to draw into
+            } else if (overlay_mode) {
+                bool changed = refreshOverlayRows();
+                if (overlayInputChanged()) overlay_redraw_frames = kSettleFrames;
+                if (changed || overlay_redraw_frames > 0) {
+                    if (overlay_redraw_frames > 0) overlay_redraw_frames--;
+                    renderOverlay();
+                }
+            } else {
+                render();
+            }
+            if (overlay_toggle_requested) {
+                overlay_toggle_requested = false;
+                setOverlayMode(!overlay_mode);
             }
+            last_frame_time = glfwGetTime();
             
-            render();
+            // Only meaningful with the counting allocator (debug builds)
+            frame_allocations = allocationCount() - allocations_before;
+            if (++frame_number > kWarmupFrames && frame_allocations > 0 && allocating_frames++ == 0) {
+                std::cout << "Frame " << frame_number << " made " << frame_allocations
+                          << " heap allocations after warm-up" << std::endl;
+            }
         }
     }
 };
 
 // Entry point
-int main() {
+int main(int argc, char** argv) {
     try {
         GPUTuneApp app;
+        if (argc > 1 && std::strcmp(argv[1], "--overlay") == 0) {
+            app.setOverlayMode(true); // Start as the compact overlay
+        }
         app.run();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
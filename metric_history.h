@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Microseconds since the Unix epoch: the timebase NVML uses for buffered samples
+inline int64_t wallClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Metrics kept in each GPU's history store
+enum class HistoryMetric {
+    Temperature,
+    GPUUtilization,
+    MemoryUtilization,
+    Power,
+    CoreClock,
+    MemoryClock,
+    MemoryUsage, // Percent of total
+    FanSpeed,
+    PCIeTx,   // MB/s
+    PCIeRx,   // MB/s
+    NVLinkTx, // MB/s, all links
+    NVLinkRx, // MB/s, all links
+    EncoderUtilization,
+    DecoderUtilization,
+    Count
+};
+
+static constexpr int kHistoryMetricCount = static_cast<int>(HistoryMetric::Count);
+static constexpr size_t kHistoryCapacity = 4096;
+
+struct MetricSample {
+    int64_t timestamp_us = 0;
+    float value = 0.0f;
+    uint32_t reserved = 0; // Pads the record to whole 64-bit words for SpscRing
+};
+
+// Lock-free single-producer/single-consumer ring of trivially copyable records.
+// Slots are stored as relaxed atomic words, so a reader racing the writer never
+// sees undefined behaviour; after copying, the reader re-checks the head and
+// drops any records the writer may have lapped in the meantime.
+template <typename T, size_t Capacity>
+class SpscRing {
+private:
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing records must be trivially copyable");
+    static_assert(sizeof(T) % sizeof(uint64_t) == 0, "SpscRing records must be whole 64-bit words");
+    static constexpr size_t kWords = sizeof(T) / sizeof(uint64_t);
+    
+    struct Slot {
+        std::atomic<uint64_t> words[kWords];
+    };
+    
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<uint64_t> head{0}; // Records ever written
+    
+public:
+    SpscRing() : slots(new Slot[Capacity]) {
+        for (size_t i = 0; i < Capacity; i++) {
+            for (size_t w = 0; w < kWords; w++) {
+                slots[i].words[w].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    static constexpr size_t capacity() { return Capacity; }
+    
+    // Producer only
+    void push(const T& record) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        uint64_t words[kWords];
+        std::memcpy(words, &record, sizeof(T));
+        
+        Slot& slot = slots[index % Capacity];
+        for (size_t w = 0; w < kWords; w++) {
+            slot.words[w].store(words[w], std::memory_order_relaxed);
+        }
+        head.store(index + 1, std::memory_order_release);
+    }
+    
+    uint64_t written() const { return head.load(std::memory_order_acquire); }
+    
+    // Copies up to max_count of the newest records into out, oldest first.
+    // Returns the number of valid records.
+    size_t copyLatest(T* out, size_t max_count) const {
+        uint64_t begin = 0;
+        return copyFrom(0, out, max_count, begin);
+    }
+    
+    // Like copyLatest, but skips records written before index first (a value
+    // of written() seen earlier), so a reader can fetch only what's new. begin
+    // receives the index of out[0]; records older than the ring's capacity are
+    // gone, so it may be greater than first.
+    size_t copyFrom(uint64_t first, T* out, size_t max_count, uint64_t& begin) const {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(end, std::min(max_count, Capacity));
+        begin = std::max(end - count, std::min(first, end));
+        count = end - begin;
+        
+        for (uint64_t i = begin; i < end; i++) {
+            const Slot& slot = slots[i % Capacity];
+            uint64_t words[kWords];
+            for (size_t w = 0; w < kWords; w++) {
+                words[w] = slot.words[w].load(std::memory_order_relaxed);
+            }
+            std::memcpy(&out[i - begin], words, sizeof(T));
+        }
+        
+        // The writer may have started overwriting the oldest slots while we copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = head.load(std::memory_order_relaxed);
+        uint64_t safe_begin = now + 1 > Capacity ? now + 1 - Capacity : 0;
+        if (safe_begin > begin) {
+            uint64_t dropped = std::min(safe_begin - begin, count);
+            std::memmove(out, out + dropped, (count - dropped) * sizeof(T));
+            count -= dropped;
+            begin += dropped;
+        }
+        return static_cast<size_t>(count);
+    }
+};
+
+// Downsampled tiers for long time windows: 1 s, 10 s, 1 min and 10 min buckets.
+// With kRollupCapacity buckets each they cover ~17 min, ~2.8 h, ~17 h and ~7 days.
+static constexpr int kRollupTierCount = 4;
+static constexpr int64_t kRollupPeriodsUs[kRollupTierCount] = {1000000LL, 10000000LL, 60000000LL, 600000000LL};
+static constexpr size_t kRollupCapacity = 1024;
+
+struct RollupBucket {
+    int64_t start_us = 0;
+    float min = 0.0f;
+    float max = 0.0f;
+    float mean = 0.0f;
+    uint32_t count = 0;
+};
+
+// Timestamped samples for one metric of one GPU, plus min/max/mean rollups that
+// are updated incrementally as samples arrive. Written by the sampler and read
+// by the UI without locks; only completed buckets are visible to readers.
+class MetricHistory {
+private:
+    struct RollupAccumulator {
+        int64_t start_us = 0;
+        float min = 0.0f;
+        float max = 0.0f;
+        double sum = 0.0;
+        uint32_t count = 0;
+    };
+    
+    SpscRing<MetricSample, kHistoryCapacity> ring;
+    SpscRing<RollupBucket, kRollupCapacity> rollups[kRollupTierCount];
+    RollupAccumulator pending[kRollupTierCount]; // Producer only
+    const uint64_t instance_id = nextInstanceId();
+    
+    static uint64_t nextInstanceId() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+public:
+    // Unique per store for the life of the process, so a reader caching derived
+    // data can tell a new store from an old one at the same address
+    uint64_t id() const { return instance_id; }
+    
+    // Records ever appended; with copySamplesFrom/copyRollupsFrom a reader can
+    // follow the store incrementally
+    uint64_t sampleCount() const { return ring.written(); }
+    uint64_t rollupCount(int tier) const { return rollups[tier].written(); }
+    
+    size_t copySamplesFrom(uint64_t first, MetricSample* out, size_t max_count, uint64_t& begin) const {
+        return ring.copyFrom(first, out, max_count, begin);
+    }
+    
+    size_t copyRollupsFrom(int tier, uint64_t first, RollupBucket* out, size_t max_count, uint64_t& begin) const {
+        return rollups[tier].copyFrom(first, out, max_count, begin);
+    }
+    
+    // Producer only
+    void append(int64_t timestamp_us, float value) {
+        MetricSample sample;
+        sample.timestamp_us = timestamp_us;
+        sample.value = value;
+        ring.push(sample);
+        
+        for (int tier = 0; tier < kRollupTierCount; tier++) {
+            RollupAccumulator& acc = pending[tier];
+            int64_t bucket_start = timestamp_us - timestamp_us % kRollupPeriodsUs[tier];
+            
+            if (acc.count > 0 && bucket_start > acc.start_us) {
+                RollupBucket bucket;
+                bucket.start_us = acc.start_us;
+                bucket.min = acc.min;
+                bucket.max = acc.max;
+                bucket.mean = static_cast<float>(acc.sum / acc.count);
+                bucket.count = acc.count;
+                rollups[tier].push(bucket);
+                acc.count = 0;
+            }
+            
+            if (acc.count == 0) {
+                acc.start_us = bucket_start;
+                acc.min = acc.max = value;
+                acc.sum = 0.0;
+            }
+            acc.min = std::min(acc.min, value);
+            acc.max = std::max(acc.max, value);
+            acc.sum += value;
+            acc.count++;
+        }
+    }
+    
+    // Copies, oldest first, the completed buckets of a tier that start after since_us
+    void copyRollups(int tier, int64_t since_us, std::vector<RollupBucket>& out) const {
+        out.resize(kRollupCapacity);
+        size_t count = rollups[tier].copyLatest(out.data(), out.size());
+        size_t first = 0;
+        while (first < count && out[first].start_us <= since_us) {
+            first++;
+        }
+        out.erase(out.begin() + count, out.end());
+        out.erase(out.begin(), out.begin() + first);
+    }
+    
+    // Appends, oldest first, the values of every sample newer than since_us.
+    // scratch is caller-owned so repeated reads don't allocate.
+    void copySince(int64_t since_us, std::vector<MetricSample>& scratch, std::vector<float>& out) const {
+        scratch.resize(kHistoryCapacity);
+        size_t count = ring.copyLatest(scratch.data(), scratch.size());
+        for (size_t i = 0; i < count; i++) {
+            if (scratch[i].timestamp_us > since_us) {
+                out.push_back(scratch[i].value);
+            }
+        }
+    }
+};
+
+struct GPUHistory {
+    MetricHistory metrics[kHistoryMetricCount];
+    
+    MetricHistory& operator[](HistoryMetric metric) { return metrics[static_cast<int>(metric)]; }
+    const MetricHistory& operator[](HistoryMetric metric) const { return metrics[static_cast<int>(metric)]; }
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gpu_monitor.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define GPUTUNE_METRIC_STORE_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+// Live metrics kept column-wise, one contiguous int32 array per metric
+enum class LiveMetric {
+    Temperature,
+    GPUUtilization,
+    MemoryUtilization,
+    PowerUsage,
+    PowerLimit,
+    MemoryUsed,
+    MemoryTotal,
+    CoreClock,
+    MemoryClock,
+    FanSpeed,
+    Count
+};
+
+static constexpr int kLiveMetricCount = static_cast<int>(LiveMetric::Count);
+
+// GPUInfo field each column is filled from, in LiveMetric order
+static int GPUInfo::* const kLiveMetricFields[kLiveMetricCount] = {
+    &GPUInfo::temperature,
+    &GPUInfo::gpu_utilization,
+    &GPUInfo::memory_utilization,
+    &GPUInfo::power_usage,
+    &GPUInfo::power_limit,
+    &GPUInfo::memory_used,
+    &GPUInfo::memory_total,
+    &GPUInfo::core_clock,
+    &GPUInfo::memory_clock,
+    &GPUInfo::fan_speed,
+};
+
+// Column reductions. The SSE2 paths handle four GPUs per instruction (SSE2 is
+// the x86-64 baseline, so no dispatch is needed); elsewhere the plain loops
+// are left to the compiler's vectorizer. values must be 16-byte aligned.
+inline int64_t sumColumn(const int32_t* values, size_t count) {
+    size_t i = 0;
+    int64_t total = 0;
+#ifdef GPUTUNE_METRIC_STORE_SSE2
+    __m128i accumulator = _mm_setzero_si128(); // Two int64 lanes, so totals can't overflow
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i sign = _mm_srai_epi32(v, 31);
+        accumulator = _mm_add_epi64(accumulator, _mm_unpacklo_epi32(v, sign));
+        accumulator = _mm_add_epi64(accumulator, _mm_unpackhi_epi32(v, sign));
+    }
+    alignas(16) int64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), accumulator);
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < count; i++) total += values[i];
+    return total;
+}
+
+inline int32_t maxColumn(const int32_t* values, size_t count) {
+    size_t i = 0;
+    int32_t best = INT32_MIN;
+#ifdef GPUTUNE_METRIC_STORE_SSE2
+    __m128i lanes_best = _mm_set1_epi32(INT32_MIN);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i greater = _mm_cmpgt_epi32(v, lanes_best); // No _mm_max_epi32 before SSE4.1
+        lanes_best = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, lanes_best));
+    }
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), lanes_best);
+    best = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+    for (; i < count; i++) best = std::max(best, values[i]);
+    return best;
+}
+
+inline int32_t minColumn(const int32_t* values, size_t count) {
+    size_t i = 0;
+    int32_t best = INT32_MAX;
+#ifdef GPUTUNE_METRIC_STORE_SSE2
+    __m128i lanes_best = _mm_set1_epi32(INT32_MAX);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i less = _mm_cmplt_epi32(v, lanes_best);
+        lanes_best = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, lanes_best));
+    }
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), lanes_best);
+    best = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+#endif
+    for (; i < count; i++) best = std::min(best, values[i]);
+    return best;
+}
+
+// Node- or fleet-wide aggregate of a MetricStore
+struct MetricSummary {
+    static constexpr size_t kHottestCount = 5;
+    
+    size_t gpu_count = 0;
+    int64_t power_usage_total = 0; // W
+    int64_t power_limit_total = 0; // W
+    int64_t memory_used_total = 0; // MB
+    int64_t memory_total = 0;      // MB
+    int temperature_min = 0;
+    int temperature_max = 0;
+    int temperature_p95 = 0;
+    double gpu_utilization_mean = 0.0;
+    std::vector<uint32_t> hottest; // Store rows, hottest first, at most kHottestCount
+};
+
+// Structure-of-arrays copy of the hot integer metrics of a set of GPUs. Each
+// column starts on its own cache line and is padded to a whole number of
+// lines, so reductions stream through memory without touching names, process
+// lists or tuning targets. Rows are in the order the GPUs were stored.
+class MetricStore {
+public:
+    static constexpr size_t kValuesPerLine = 16; // 64-byte cache lines of int32
+    
+private:
+    struct alignas(64) CacheLine {
+        int32_t values[kValuesPerLine];
+    };
+    
+    std::vector<CacheLine> lines; // kLiveMetricCount columns of line_stride lines each
+    size_t line_stride = 0;
+    size_t count = 0;
+    
+    // Scratch for percentile() and topN(); kept so repeated summaries don't allocate
+    mutable std::vector<int32_t> value_scratch;
+    mutable std::vector<uint32_t> index_scratch;
+    
+public:
+    // Sets the row count, keeping the capacity; row values are unspecified until stored
+    void resize(size_t rows) {
+        count = rows;
+        size_t stride = std::max<size_t>(1, (rows + kValuesPerLine - 1) / kValuesPerLine);
+        if (stride > line_stride) {
+            line_stride = stride;
+            lines.assign(line_stride * kLiveMetricCount, CacheLine());
+        }
+    }
+    
+    void store(size_t row, const GPUInfo& gpu) {
+        for (int m = 0; m < kLiveMetricCount; m++) {
+            mutableColumn(static_cast<LiveMetric>(m))[row] = gpu.*kLiveMetricFields[m];
+        }
+    }
+    
+    // Replaces the contents with gpus, in order
+    void assign(const std::vector<GPUInfo>& gpus) {
+        resize(gpus.size());
+        for (size_t i = 0; i < gpus.size(); i++) store(i, gpus[i]);
+    }
+    
+    size_t size() const { return count; }
+    
+    const int32_t* column(LiveMetric metric) const {
+        return lines[static_cast<size_t>(metric) * line_stride].values;
+    }
+    
+    int32_t* mutableColumn(LiveMetric metric) {
+        return lines[static_cast<size_t>(metric) * line_stride].values;
+    }
+    
+    int64_t sum(LiveMetric metric) const { return count ? sumColumn(column(metric), count) : 0; }
+    int32_t max(LiveMetric metric) const { return count ? maxColumn(column(metric), count) : 0; }
+    int32_t min(LiveMetric metric) const { return count ? minColumn(column(metric), count) : 0; }
+    double mean(LiveMetric metric) const { return count ? static_cast<double>(sum(metric)) / count : 0.0; }
+    
+    // Nearest-rank percentile, q in [0, 1]
+    int32_t percentile(LiveMetric metric, double q) const {
+        if (count == 0) return 0;
+        const int32_t* values = column(metric);
+        value_scratch.assign(values, values + count);
+        size_t rank = static_cast<size_t>(std::min(1.0, std::max(0.0, q)) * (count - 1) + 0.5);
+        std::nth_element(value_scratch.begin(), value_scratch.begin() + rank, value_scratch.end());
+        return value_scratch[rank];
+    }
+    
+    // Rows with the n largest values, largest first (ties by row)
+    void topN(LiveMetric metric, size_t n, std::vector<uint32_t>& out) const {
+        out.clear();
+        if (count == 0) return;
+        const int32_t* values = column(metric);
+        n = std::min(n, count);
+        index_scratch.resize(count);
+        for (size_t i = 0; i < count; i++) index_scratch[i] = static_cast<uint32_t>(i);
+        std::partial_sort(index_scratch.begin(), index_scratch.begin() + n, index_scratch.end(),
+                          [values](uint32_t a, uint32_t b) {
+                              return values[a] != values[b] ? values[a] > values[b] : a < b;
+                          });
+        out.assign(index_scratch.begin(), index_scratch.begin() + n);
+    }
+    
+    void summarize(MetricSummary& summary) const {
+        summary.gpu_count = count;
+        summary.power_usage_total = sum(LiveMetric::PowerUsage);
+        summary.power_limit_total = sum(LiveMetric::PowerLimit);
+        summary.memory_used_total = sum(LiveMetric::MemoryUsed);
+        summary.memory_total = sum(LiveMetric::MemoryTotal);
+        summary.temperature_min = min(LiveMetric::Temperature);
+        summary.temperature_max = max(LiveMetric::Temperature);
+        summary.temperature_p95 = percentile(LiveMetric::Temperature, 0.95);
+        summary.gpu_utilization_mean = mean(LiveMetric::GPUUtilization);
+        topN(LiveMetric::Temperature, MetricSummary::kHottestCount, summary.hottest);
+    }
+};
@@ -0,0 +1,440 @@
+#pragma once
+
+// Prometheus exporter: a minimal HTTP server answering GET /metrics with the
+// latest published sweep in the text exposition format. Scrapes only read the
+// exporter's own snapshot subscription, so any number of collectors scraping
+// at any rate causes no NVML calls and never waits on the sampler. The
+// tool's own overhead is exported too, as latency summaries of every NVML
+// entry point and of whole sampler sweeps, as are the alert rules' states.
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <chrono>
+
+#include "gpu_monitor.h"
+#include "net_socket.h"
+
+class MetricsExporter {
+private:
+    static constexpr size_t kRequestBufferSize = 4096;
+    static constexpr size_t kInitialBodyCapacity = 64 * 1024;
+    static constexpr int kAcceptPollMs = 200;   // How often the server checks for stop()
+    static constexpr int kClientTimeoutMs = 2000; // A client making no progress this long is dropped
+    static constexpr size_t kMaxClients = 64;
+    
+    // Clients are non-blocking and multiplexed with the listener, so an idle
+    // or slow-reading collector never holds up another's scrape
+    struct Client {
+        SocketHandle socket = kInvalidSocket;
+        std::string request;
+        std::string response; // Empty until the request is complete
+        size_t sent = 0;      // Bytes of response already written
+        std::chrono::steady_clock::time_point deadline;
+    };
+    
+    GPUMonitor& monitor;
+    std::shared_ptr<SnapshotBuffer> snapshots;
+    SocketHandle listen_socket = kInvalidSocket;
+    std::thread server_thread;
+    std::atomic<bool> running{false};
+    
+    // Server thread only. The body is re-rendered when a newer sweep arrives and
+    // served as-is otherwise, keeping its capacity between scrapes.
+    char receive_buffer[kRequestBufferSize];
+    std::string body;
+    std::vector<Client> clients;
+    std::vector<PollDescriptor> descriptors;
+    uint64_t rendered_version = 0;
+    std::vector<AlertEngine::RuleStatus> alert_status;
+    
+    // Label values may contain backslashes, quotes or newlines, which must be escaped
+    static void appendLabelValue(std::string& out, const std::string& value) {
+        for (char c : value) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '"': out += "\\\""; break;
+                case '\n': out += "\\n"; break;
+                default: out += c; break;
+            }
+        }
+    }
+    
+    static void appendHeader(std::string& out, const char* name, const char* help, const char* type) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+    
+    static void appendSample(std::string& out, const char* name, size_t gpu_index, const GPUInfo& gpu, double value) {
+        char number[64];
+        out += name;
+        std::snprintf(number, sizeof(number), "{gpu=\"%zu\",uuid=\"", gpu_index);
+        out += number;
+        appendLabelValue(out, gpu.uuid);
+        out += "\",name=\"";
+        appendLabelValue(out, gpu.name);
+        std::snprintf(number, sizeof(number), "\"} %.17g\n", value);
+        out += number;
+    }
+    
+    static void appendProcessSample(std::string& out, const char* name, size_t gpu_index, const GPUInfo& gpu,
+                                    const GPUProcessInfo& process, double value) {
+        char number[64];
+        out += name;
+        std::snprintf(number, sizeof(number), "{gpu=\"%zu\",uuid=\"", gpu_index);
+        out += number;
+        appendLabelValue(out, gpu.uuid);
+        std::snprintf(number, sizeof(number), "\",pid=\"%u\",process=\"", process.pid);
+        out += number;
+        appendLabelValue(out, process.name);
+        std::snprintf(number, sizeof(number), "\"} %.17g\n", value);
+        out += number;
+    }
+    
+    static void appendAlertSample(std::string& out, const char* name, size_t gpu_index, const GPUInfo& gpu,
+                                  const std::string& rule, double value) {
+        char number[64];
+        out += name;
+        std::snprintf(number, sizeof(number), "{gpu=\"%zu\",uuid=\"", gpu_index);
+        out += number;
+        appendLabelValue(out, gpu.uuid);
+        out += "\",rule=\"";
+        appendLabelValue(out, rule);
+        std::snprintf(number, sizeof(number), "\"} %.17g\n", value);
+        out += number;
+    }
+    
+    static void appendLinkSample(std::string& out, const char* name, size_t gpu_index, const GPUInfo& gpu,
+                                 unsigned int link, double value) {
+        char number[64];
+        out += name;
+        std::snprintf(number, sizeof(number), "{gpu=\"%zu\",uuid=\"", gpu_index);
+        out += number;
+        appendLabelValue(out, gpu.uuid);
+        std::snprintf(number, sizeof(number), "\",link=\"%u\"} %.17g\n", link, value);
+        out += number;
+    }
+    
+    // Summary samples (p50, p99, sum, count) in seconds; labels is "" or e.g. "function=\"X\""
+    static void appendLatencySummary(std::string& out, const char* name, const char* labels,
+                                     const LatencyHistogram::Summary& summary) {
+        char line[256];
+        const char* separator = labels[0] ? "," : "";
+        std::snprintf(line, sizeof(line), "%s{%s%squantile=\"0.5\"} %.9g\n", name, labels, separator, summary.p50_ns * 1e-9);
+        out += line;
+        std::snprintf(line, sizeof(line), "%s{%s%squantile=\"0.99\"} %.9g\n", name, labels, separator, summary.p99_ns * 1e-9);
+        out += line;
+        const char* open = labels[0] ? "{" : "";
+        const char* close = labels[0] ? "}" : "";
+        std::snprintf(line, sizeof(line), "%s_sum%s%s%s %.9g\n", name, open, labels, close, summary.sum_ns * 1e-9);
+        out += line;
+        std::snprintf(line, sizeof(line), "%s_count%s%s%s %llu\n", name, open, labels, close,
+                      (unsigned long long)summary.count);
+        out += line;
+    }
+    
+    void renderLatencies() {
+        appendHeader(body, "gputune_sampler_sweep_duration_seconds", "Time to sample every GPU once.", "summary");
+        appendLatencySummary(body, "gputune_sampler_sweep_duration_seconds", "", monitor.sweepLatency().summarize());
+        
+        appendHeader(body, "gputune_nvml_call_duration_seconds", "Latency of NVML calls made by gputune.", "summary");
+        monitor.forEachNvmlCallLatency([this](const char* function, const LatencyHistogram& latency) {
+            if (latency.getCount() == 0) return; // Never called (e.g. unsupported on this driver)
+            char labels[96];
+            std::snprintf(labels, sizeof(labels), "function=\"%s\"", function);
+            appendLatencySummary(body, "gputune_nvml_call_duration_seconds", labels, latency.summarize());
+        });
+    }
+    
+    // Alert state is kept by the engine as it evaluates, so this is a copy, not a scan of history
+    void renderAlerts(const MonitorSnapshot& snapshot) {
+        monitor.alerts().copyStatus(alert_status);
+        if (alert_status.empty()) return;
+        
+        appendHeader(body, "gputune_alert_active", "1 while an alert rule is firing for the GPU.", "gauge");
+        for (const AlertEngine::RuleStatus& rule : alert_status) {
+            for (size_t i = 0; i < snapshot.gpus.size() && i < rule.active.size(); i++) {
+                appendAlertSample(body, "gputune_alert_active", i, snapshot.gpus[i], rule.text, rule.active[i]);
+            }
+        }
+        appendHeader(body, "gputune_alerts_fired_total", "Times an alert rule has fired for the GPU.", "counter");
+        for (const AlertEngine::RuleStatus& rule : alert_status) {
+            for (size_t i = 0; i < snapshot.gpus.size() && i < rule.fired.size(); i++) {
+                appendAlertSample(body, "gputune_alerts_fired_total", i, snapshot.gpus[i], rule.text,
+                                  static_cast<double>(rule.fired[i]));
+            }
+        }
+    }
+    
+    // Per NVLink; GPUs without NVLink have no samples, and the families are left
+    // out entirely when no GPU has any
+    void renderNvLinks(const MonitorSnapshot& snapshot) {
+        bool any = std::any_of(snapshot.gpus.begin(), snapshot.gpus.end(),
+                               [](const GPUInfo& g) { return !g.nvlinks.empty(); });
+        if (!any) return;
+        
+        appendHeader(body, "gputune_nvlink_tx_bytes_per_second", "Data sent over an NVLink.", "gauge");
+        for (size_t i = 0; i < snapshot.gpus.size(); i++) {
+            for (const NvLinkThroughput& link : snapshot.gpus[i].nvlinks) {
+                appendLinkSample(body, "gputune_nvlink_tx_bytes_per_second", i, snapshot.gpus[i], link.link, link.tx * 1e6);
+            }
+        }
+        appendHeader(body, "gputune_nvlink_rx_bytes_per_second", "Data received over an NVLink.", "gauge");
+        for (size_t i = 0; i < snapshot.gpus.size(); i++) {
+            for (const NvLinkThroughput& link : snapshot.gpus[i].nvlinks) {
+                appendLinkSample(body, "gputune_nvlink_rx_bytes_per_second", i, snapshot.gpus[i], link.link, link.rx * 1e6);
+            }
+        }
+    }
+    
+    // One family per GPUInfo field, every GPU as a labelled sample
+    void renderMetrics(const MonitorSnapshot& snapshot) {
+        struct Family {
+            const char* name;
+            const char* help;
+            double (*value)(const GPUInfo&);
+        };
+        static const Family kFamilies[] = {
+            {"gputune_temperature_celsius", "GPU core temperature.",
+             [](const GPUInfo& g) { return (double)g.temperature; }},
+            {"gputune_power_usage_watts", "Current board power draw.",
+             [](const GPUInfo& g) { return (double)g.power_usage; }},
+            {"gputune_power_limit_watts", "Maximum configurable power limit.",
+             [](const GPUInfo& g) { return (double)g.power_limit; }},
+            {"gputune_core_clock_hertz", "Graphics clock.",
+             [](const GPUInfo& g) { return g.core_clock * 1e6; }},
+            {"gputune_memory_clock_hertz", "Memory clock.",
+             [](const GPUInfo& g) { return g.memory_clock * 1e6; }},
+            {"gputune_gpu_utilization_ratio", "Fraction of time a kernel was running.",
+             [](const GPUInfo& g) { return g.gpu_utilization / 100.0; }},
+            {"gputune_memory_utilization_ratio", "Fraction of time device memory was being read or written.",
+             [](const GPUInfo& g) { return g.memory_utilization / 100.0; }},
+            {"gputune_memory_used_bytes", "Device memory in use.",
+             [](const GPUInfo& g) { return g.memory_used * 1048576.0; }},
+            {"gputune_memory_total_bytes", "Total device memory.",
+             [](const GPUInfo& g) { return g.memory_total * 1048576.0; }},
+            {"gputune_fan_speed_ratio", "Fan speed as a fraction of maximum.",
+             [](const GPUInfo& g) { return g.fan_speed / 100.0; }},
+            {"gputune_pcie_tx_bytes_per_second", "Data sent over PCIe.",
+             [](const GPUInfo& g) { return g.pcie_tx * 1e6; }},
+            {"gputune_pcie_rx_bytes_per_second", "Data received over PCIe.",
+             [](const GPUInfo& g) { return g.pcie_rx * 1e6; }},
+            {"gputune_encoder_utilization_ratio", "Fraction of time the video encoder was busy.",
+             [](const GPUInfo& g) { return g.encoder_utilization / 100.0; }},
+            {"gputune_decoder_utilization_ratio", "Fraction of time the video decoder was busy.",
+             [](const GPUInfo& g) { return g.decoder_utilization / 100.0; }},
+            {"gputune_ecc_enabled", "1 if ECC is enabled on device memory.",
+             [](const GPUInfo& g) { return g.ecc_enabled ? 1.0 : 0.0; }},
+            {"gputune_sample_stale", "1 if the device missed the last sampling deadline.",
+             [](const GPUInfo& g) { return g.stale ? 1.0 : 0.0; }},
+        };
+        
+        // Cumulative since the driver loaded
+        static const Family kCounterFamilies[] = {
+            {"gputune_ecc_corrected_errors_total", "Single-bit ECC errors corrected.",
+             [](const GPUInfo& g) { return (double)g.ecc_corrected; }},
+            {"gputune_ecc_uncorrected_errors_total", "Double-bit ECC errors detected.",
+             [](const GPUInfo& g) { return (double)g.ecc_uncorrected; }},
+        };
+        
+        struct ProcessFamily {
+            const char* name;
+            const char* help;
+            double (*value)(const GPUProcessInfo&);
+        };
+        static const ProcessFamily kProcessFamilies[] = {
+            {"gputune_process_memory_used_bytes", "Device memory used by a compute process.",
+             [](const GPUProcessInfo& p) { return p.memory_used * 1048576.0; }},
+            {"gputune_process_sm_utilization_ratio", "Fraction of SM time a compute process used.",
+             [](const GPUProcessInfo& p) { return p.sm_utilization / 100.0; }},
+            {"gputune_process_memory_utilization_ratio", "Fraction of memory bandwidth time a compute process used.",
+             [](const GPUProcessInfo& p) { return p.memory_utilization / 100.0; }},
+        };
+        
+        body.clear();
+        for (const Family& family : kFamilies) {
+            appendHeader(body, family.name, family.help, "gauge");
+            for (size_t i = 0; i < snapshot.gpus.size(); i++) {
+                appendSample(body, family.name, i, snapshot.gpus[i], family.value(snapshot.gpus[i]));
+            }
+        }
+        for (const Family& family : kCounterFamilies) {
+            appendHeader(body, family.name, family.help, "counter");
+            for (size_t i = 0; i < snapshot.gpus.size(); i++) {
+                appendSample(body, family.name, i, snapshot.gpus[i], family.value(snapshot.gpus[i]));
+            }
+        }
+        renderNvLinks(snapshot);
+        for (const ProcessFamily& family : kProcessFamilies) {
+            appendHeader(body, family.name, family.help, "gauge");
+            for (size_t i = 0; i < snapshot.gpus.size(); i++) {
+                for (const GPUProcessInfo& process : snapshot.gpus[i].processes) {
+                    appendProcessSample(body, family.name, i, snapshot.gpus[i], process, family.value(process));
+                }
+            }
+        }
+        renderAlerts(snapshot);
+        renderLatencies();
+        rendered_version = snapshot.version;
+    }
+    
+    static void respond(Client& client, const char* status, const char* content_type, const std::string& content) {
+        char header[256];
+        int header_length = std::snprintf(header, sizeof(header),
+                                          "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                                          status, content_type, content.size());
+        client.response.reserve(header_length + content.size());
+        client.response.append(header, header_length);
+        client.response += content;
+    }
+    
+    // Only the request line matters; called once the headers are in or the buffer is full
+    void handleRequest(Client& client) {
+        const char* request = client.request.c_str();
+        bool is_metrics = std::strncmp(request, "GET /metrics ", 13) == 0 ||
+                          std::strncmp(request, "GET /metrics?", 13) == 0;
+        if (!is_metrics) {
+            static const std::string kNotFound = "Not found. Metrics are served at /metrics\n";
+            respond(client, "404 Not Found", "text/plain; charset=utf-8", kNotFound);
+            return;
+        }
+        
+        if (snapshots->fetch() || rendered_version == 0) {
+            renderMetrics(snapshots->readBuffer());
+        }
+        respond(client, "200 OK", "text/plain; version=0.0.4; charset=utf-8", body);
+    }
+    
+    // Reads what has arrived; false if the client hung up or failed
+    bool receive(Client& client) {
+        int count = 0;
+        while (client.response.empty() && (count = receiveSome(client.socket, receive_buffer, sizeof(receive_buffer))) > 0) {
+            client.request.append(receive_buffer, std::min<size_t>(count, kRequestBufferSize - 1 - client.request.size()));
+            if (client.request.find("\r\n\r\n") != std::string::npos || client.request.size() >= kRequestBufferSize - 1) {
+                handleRequest(client);
+            }
+        }
+        return client.response.empty() ? count == 0 : true;
+    }
+    
+    // Writes what the socket takes; false once the response is out or the write failed
+    bool flush(Client& client) {
+        while (client.sent < client.response.size()) {
+            int sent = sendSome(client.socket, client.response.data() + client.sent, client.response.size() - client.sent);
+            if (sent < 0) return false;
+            if (sent == 0) return true;
+            client.sent += sent;
+        }
+        return false;
+    }
+    
+    void dropClient(size_t index) {
+        closeSocket(clients[index].socket);
+        clients[index] = std::move(clients.back());
+        clients.pop_back();
+    }
+    
+    void acceptClient() {
+        SocketHandle socket = accept(listen_socket, nullptr, nullptr);
+        if (socket == kInvalidSocket) return;
+        if (clients.size() >= kMaxClients || !setNonBlocking(socket)) {
+            closeSocket(socket);
+            return;
+        }
+        clients.emplace_back();
+        clients.back().socket = socket;
+        clients.back().deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kClientTimeoutMs);
+    }
+    
+    void serverLoop() {
+        while (running) {
+            descriptors.clear();
+            descriptors.push_back({listen_socket, kPollRead, 0});
+            for (const Client& client : clients) {
+                descriptors.push_back({client.socket, client.response.empty() ? kPollRead : kPollWrite, 0});
+            }
+            pollSockets(descriptors.data(), descriptors.size(), kAcceptPollMs);
+            
+            auto now = std::chrono::steady_clock::now();
+            for (size_t i = clients.size(); i-- > 0;) {
+                Client& client = clients[i];
+                short revents = descriptors[i + 1].revents;
+                size_t progress = client.request.size() + client.sent;
+                bool keep = !(revents & (POLLERR | POLLNVAL));
+                if (keep && client.response.empty() && (revents & (kPollRead | POLLHUP))) keep = receive(client);
+                if (keep && !client.response.empty()) keep = flush(client);
+                if (client.request.size() + client.sent != progress) {
+                    client.deadline = now + std::chrono::milliseconds(kClientTimeoutMs);
+                }
+                if (!keep || now >= client.deadline) dropClient(i);
+            }
+            if (descriptors[0].revents & kPollRead) {
+                acceptClient();
+            }
+        }
+    }
+    
+public:
+    explicit MetricsExporter(GPUMonitor& gpu_monitor) : monitor(gpu_monitor) {
+        body.reserve(kInitialBodyCapacity);
+    }
+    
+    ~MetricsExporter() { stop(); }
+    
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    
+    // Renders snapshot as a scrape would and returns the body; for benchmarks.
+    // Only valid while the server is stopped, since it shares the server's buffer.
+    const std::string& renderBody(const MonitorSnapshot& snapshot) {
+        renderMetrics(snapshot);
+        return body;
+    }
+    
+    bool start(const std::string& address, int port) {
+        if (running) return true;
+        if (!startSockets()) return false;
+        
+        listen_socket = listenTcp(address, port, 16);
+        if (listen_socket == kInvalidSocket) {
+            cleanupSockets();
+            return false;
+        }
+        
+        snapshots = monitor.subscribeSnapshots();
+        running = true;
+        server_thread = std::thread([this] { serverLoop(); });
+        std::cerr << "Serving metrics on http://" << address << ":" << port << "/metrics" << std::endl;
+        return true;
+    }
+    
+    void stop() {
+        if (!running) return;
+        running = false;
+        if (server_thread.joinable()) {
+            server_thread.join();
+        }
+        for (const Client& client : clients) {
+            closeSocket(client.socket);
+        }
+        clients.clear();
+        closeSocket(listen_socket);
+        listen_socket = kInvalidSocket;
+        monitor.unsubscribeSnapshots(snapshots);
+        snapshots.reset();
+        cleanupSockets();
+    }
+};
@@ -0,0 +1,299 @@
+#pragma once
+
+// Simulated NVML backend for benchmarks: any number of devices answering
+// through the same NvmlApi table GPUMonitor uses, each call optionally
+// busy-waiting to model driver latency. Readings are deterministic functions
+// of the device index and a call counter, so runs are reproducible on
+// machines without NVIDIA hardware or drivers (nvml.h is still needed to build).
+
+#include "nvml_api.h"
+
+#ifdef GPUTUNE_HAVE_NVML
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+struct MockNvmlConfig {
+    std::atomic<unsigned int> device_count{8};
+    std::atomic<unsigned int> call_latency_ns{0}; // Busy-waited on every device query
+    std::atomic<unsigned int> processes_per_gpu{2};
+    std::atomic<unsigned int> nvlinks_per_gpu{4};
+};
+
+inline MockNvmlConfig& mockNvmlConfig() {
+    static MockNvmlConfig config;
+    return config;
+}
+
+class MockNvml {
+private:
+    static std::atomic<uint64_t>& tick() {
+        static std::atomic<uint64_t> counter{0};
+        return counter;
+    }
+    
+    // Sleeping can't resolve microseconds, so spin like a blocking ioctl would
+    static void simulateLatency() {
+        unsigned int ns = mockNvmlConfig().call_latency_ns.load(std::memory_order_relaxed);
+        if (ns == 0) return;
+        auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+    
+    // Handles are 1-based indices, so nullptr is never a valid device
+    static nvmlDevice_t handleFor(unsigned int index) {
+        return reinterpret_cast<nvmlDevice_t>(static_cast<uintptr_t>(index) + 1);
+    }
+    
+    static bool indexOf(nvmlDevice_t device, unsigned int& index) {
+        uintptr_t value = reinterpret_cast<uintptr_t>(device);
+        if (value == 0 || value > mockNvmlConfig().device_count.load()) return false;
+        index = static_cast<unsigned int>(value - 1);
+        return true;
+    }
+    
+    // Sweeps through 0..range-1 as calls are made, offset per device
+    static unsigned int wave(unsigned int index, unsigned int range) {
+        uint64_t step = tick().fetch_add(1, std::memory_order_relaxed);
+        return static_cast<unsigned int>((step / 16 + index * 7) % range);
+    }
+    
+    static nvmlReturn_t init() { return NVML_SUCCESS; }
+    static nvmlReturn_t shutdown() { return NVML_SUCCESS; }
+    static const char* errorString(nvmlReturn_t result) { return result == NVML_SUCCESS ? "Success" : "Mock error"; }
+    
+    static nvmlReturn_t deviceGetCount(unsigned int* count) {
+        *count = mockNvmlConfig().device_count.load();
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetHandleByIndex(unsigned int index, nvmlDevice_t* device) {
+        if (index >= mockNvmlConfig().device_count.load()) return NVML_ERROR_INVALID_ARGUMENT;
+        *device = handleFor(index);
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t systemGetDriverVersion(char* version, unsigned int length) {
+        std::snprintf(version, length, "mock");
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetName(nvmlDevice_t device, char* name, unsigned int length) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        std::snprintf(name, length, "Mock GPU");
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetUUID(nvmlDevice_t device, char* uuid, unsigned int length) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        std::snprintf(uuid, length, "GPU-00000000-0000-0000-0000-%012u", index);
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetTemperature(nvmlDevice_t device, nvmlTemperatureSensors_t, unsigned int* value) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *value = 40 + wave(index, 40);
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t* utilization) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        utilization->gpu = wave(index, 101);
+        utilization->memory = utilization->gpu / 2;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetPowerUsage(nvmlDevice_t device, unsigned int* milliwatts) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *milliwatts = 80000 + wave(index, 200) * 1000;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetPowerManagementLimitConstraints(nvmlDevice_t device, unsigned int* min_limit,
+                                                                 unsigned int* max_limit) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *min_limit = 100000;
+        *max_limit = 300000;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetPowerManagementDefaultLimit(nvmlDevice_t device, unsigned int* limit) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *limit = 250000;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetMemoryInfo(nvmlDevice_t device, nvmlMemory_t* memory) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        memory->total = 16ull << 30;
+        memory->used = static_cast<unsigned long long>(wave(index, 16)) << 30;
+        memory->free = memory->total - memory->used;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetClockInfo(nvmlDevice_t device, nvmlClockType_t type, unsigned int* mhz) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *mhz = type == NVML_CLOCK_MEM ? 9501 : 1200 + wave(index, 800);
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetFanSpeed(nvmlDevice_t device, unsigned int* percent) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *percent = 30 + wave(index, 50);
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetNumFans(nvmlDevice_t device, unsigned int* count) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        *count = 2;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetCurrentClocksThrottleReasons(nvmlDevice_t device, unsigned long long* reasons) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *reasons = 0;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetComputeRunningProcesses(nvmlDevice_t device, unsigned int* count,
+                                                         nvmlProcessInfo_t* processes) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        unsigned int running = mockNvmlConfig().processes_per_gpu.load();
+        if (*count < running) {
+            *count = running;
+            return NVML_ERROR_INSUFFICIENT_SIZE;
+        }
+        *count = running;
+        for (unsigned int i = 0; i < running; i++) {
+            processes[i] = nvmlProcessInfo_t();
+            processes[i].pid = 100000 + index * 64 + i;
+            processes[i].usedGpuMemory = static_cast<unsigned long long>(i + 1) << 28;
+        }
+        return NVML_SUCCESS;
+    }
+    
+    // ECC is on with no errors; the PCIe and NVLink counters grow at a steady
+    // rate per device, so the sampler sees constant throughput
+    static nvmlReturn_t deviceGetFieldValues(nvmlDevice_t device, int count, nvmlFieldValue_t* values) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        long long now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        unsigned long long elapsed_us = static_cast<unsigned long long>(now_us) % (1ull << 40);
+        for (int i = 0; i < count; i++) {
+            nvmlFieldValue_t& field = values[i];
+            field.timestamp = now_us;
+            field.latencyUsec = 0;
+            field.nvmlReturn = NVML_SUCCESS;
+            field.valueType = NVML_VALUE_TYPE_UNSIGNED_LONG_LONG;
+            switch (field.fieldId) {
+                case NVML_FI_DEV_ECC_CURRENT: field.value.ullVal = 1; break;
+                case NVML_FI_DEV_ECC_SBE_VOL_TOTAL:
+                case NVML_FI_DEV_ECC_DBE_VOL_TOTAL: field.value.ullVal = 0; break;
+                case NVML_FI_DEV_NVLINK_LINK_COUNT: field.value.ullVal = mockNvmlConfig().nvlinks_per_gpu.load(); break;
+#ifdef NVML_FI_DEV_PCIE_COUNT_TX_BYTES
+                case NVML_FI_DEV_PCIE_COUNT_TX_BYTES: field.value.ullVal = elapsed_us * (100 + index % 8 * 100); break;
+                case NVML_FI_DEV_PCIE_COUNT_RX_BYTES: field.value.ullVal = elapsed_us * 50; break;
+#endif
+#ifdef NVML_FI_DEV_NVLINK_THROUGHPUT_DATA_TX
+                case NVML_FI_DEV_NVLINK_THROUGHPUT_DATA_TX:
+                case NVML_FI_DEV_NVLINK_THROUGHPUT_DATA_RX:
+                    if (field.scopeId >= mockNvmlConfig().nvlinks_per_gpu.load()) {
+                        field.nvmlReturn = NVML_ERROR_INVALID_ARGUMENT;
+                    } else {
+                        field.value.ullVal = elapsed_us * (field.scopeId + 1) / 4; // KiB
+                    }
+                    break;
+#endif
+                default: field.nvmlReturn = NVML_ERROR_NOT_SUPPORTED; break;
+            }
+        }
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetEncoderUtilization(nvmlDevice_t device, unsigned int* utilization,
+                                                    unsigned int* period_us) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *utilization = wave(index, 30);
+        *period_us = 167000;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t deviceGetDecoderUtilization(nvmlDevice_t device, unsigned int* utilization,
+                                                    unsigned int* period_us) {
+        unsigned int index;
+        if (!indexOf(device, index)) return NVML_ERROR_INVALID_ARGUMENT;
+        simulateLatency();
+        *utilization = wave(index, 20);
+        *period_us = 167000;
+        return NVML_SUCCESS;
+    }
+    
+    static nvmlReturn_t systemGetProcessName(unsigned int, char* name, unsigned int length) {
+        std::snprintf(name, length, "/usr/bin/mock-worker");
+        return NVML_SUCCESS;
+    }
+    
+public:
+    // Installs the mock as the process-wide NVML table. Call before the first
+    // GPUMonitor is constructed; device_count may be changed between monitors.
+    // Buffered samples, events, and setters are left unsupported.
+    static bool install() {
+        return nvmlApi().loadWith([](NvmlApi& api) {
+            api.Init.function = &init;
+            api.Shutdown.function = &shutdown;
+            api.ErrorString.function = &errorString;
+            api.DeviceGetCount.function = &deviceGetCount;
+            api.DeviceGetHandleByIndex.function = &deviceGetHandleByIndex;
+            api.SystemGetDriverVersion.function = &systemGetDriverVersion;
+            api.DeviceGetName.function = &deviceGetName;
+            api.DeviceGetUUID.function = &deviceGetUUID;
+            api.DeviceGetTemperature.function = &deviceGetTemperature;
+            api.DeviceGetUtilizationRates.function = &deviceGetUtilizationRates;
+            api.DeviceGetPowerUsage.function = &deviceGetPowerUsage;
+            api.DeviceGetPowerManagementLimitConstraints.function = &deviceGetPowerManagementLimitConstraints;
+            api.DeviceGetPowerManagementDefaultLimit.function = &deviceGetPowerManagementDefaultLimit;
+            api.DeviceGetMemoryInfo.function = &deviceGetMemoryInfo;
+            api.DeviceGetClockInfo.function = &deviceGetClockInfo;
+            api.DeviceGetFanSpeed.function = &deviceGetFanSpeed;
+            api.DeviceGetNumFans.function = &deviceGetNumFans;
+            api.DeviceGetCurrentClocksThrottleReasons.function = &deviceGetCurrentClocksThrottleReasons;
+            api.DeviceGetComputeRunningProcesses.function = &deviceGetComputeRunningProcesses;
+            api.SystemGetProcessName.function = &systemGetProcessName;
+            api.DeviceGetFieldValues.function = &deviceGetFieldValues;
+            api.DeviceGetEncoderUtilization.function = &deviceGetEncoderUtilization;
+            api.DeviceGetDecoderUtilization.function = &deviceGetDecoderUtilization;
+        });
+    }
+};
+
+#endif // GPUTUNE_HAVE_NVML
@@ -0,0 +1,194 @@
+#pragma once
+
+// Thin portable layer over BSD sockets and Winsock, shared by the metrics
+// exporter and fleet streaming. Only what those two need: TCP listen/connect,
+// poll and non-blocking I/O.
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+using PollDescriptor = WSAPOLLFD;
+static constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+static constexpr short kPollRead = POLLRDNORM;
+static constexpr short kPollWrite = POLLWRNORM;
+#else
+using SocketHandle = int;
+using PollDescriptor = pollfd;
+static constexpr SocketHandle kInvalidSocket = -1;
+static constexpr short kPollRead = POLLIN;
+static constexpr short kPollWrite = POLLOUT;
+#endif
+
+#ifdef MSG_NOSIGNAL
+static constexpr int kSendFlags = MSG_NOSIGNAL; // A peer hanging up mid-send must not raise SIGPIPE
+#else
+static constexpr int kSendFlags = 0;
+#endif
+
+// Winsock needs a matching startup/cleanup pair per user; no-ops elsewhere
+inline bool startSockets() {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        std::cerr << "Failed to initialize Winsock" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+inline void cleanupSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+inline void closeSocket(SocketHandle socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+inline int pollSockets(PollDescriptor* descriptors, size_t count, int timeout_ms) {
+#ifdef _WIN32
+    return WSAPoll(descriptors, static_cast<ULONG>(count), timeout_ms);
+#else
+    return poll(descriptors, static_cast<nfds_t>(count), timeout_ms);
+#endif
+}
+
+inline bool setNonBlocking(SocketHandle socket) {
+#ifdef _WIN32
+    u_long enabled = 1;
+    return ioctlsocket(socket, FIONBIO, &enabled) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// Small frames go out at once instead of waiting for Nagle's ACK
+inline void setNoDelay(SocketHandle socket) {
+    int enabled = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+// True when the last failed call on a non-blocking socket just needs to be retried later
+inline bool socketWouldBlock() {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+#endif
+}
+
+// Pending error of a non-blocking connect, 0 once it has succeeded
+inline int socketError(SocketHandle socket) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) != 0) return -1;
+    return error;
+}
+
+// send() on a non-blocking socket: bytes written, 0 if it would block, -1 on error
+inline int sendSome(SocketHandle socket, const void* data, size_t length) {
+    int sent = static_cast<int>(send(socket, static_cast<const char*>(data),
+                                     static_cast<int>(std::min<size_t>(length, 1 << 30)), kSendFlags));
+    if (sent < 0) return socketWouldBlock() ? 0 : -1;
+    return sent;
+}
+
+// recv() on a non-blocking socket: bytes read, 0 if it would block, -1 on error or hang-up
+inline int receiveSome(SocketHandle socket, void* data, size_t length) {
+    int count = static_cast<int>(recv(socket, static_cast<char*>(data), static_cast<int>(std::min<size_t>(length, 1 << 30)), 0));
+    if (count == 0) return -1;
+    if (count < 0) return socketWouldBlock() ? 0 : -1;
+    return count;
+}
+
+inline std::string localHostName() {
+    char name[256] = "";
+    if (gethostname(name, sizeof(name)) != 0) return "unknown";
+    name[sizeof(name) - 1] = '\0';
+    return name;
+}
+
+// Bound, listening TCP socket on address:port (IPv4), or kInvalidSocket
+inline SocketHandle listenTcp(const std::string& address, int port, int backlog) {
+    sockaddr_in bind_address;
+    std::memset(&bind_address, 0, sizeof(bind_address));
+    bind_address.sin_family = AF_INET;
+    bind_address.sin_port = htons(static_cast<unsigned short>(port));
+    if (inet_pton(AF_INET, address.c_str(), &bind_address.sin_addr) != 1) {
+        std::cerr << "Invalid listen address: " << address << std::endl;
+        return kInvalidSocket;
+    }
+    
+    SocketHandle listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket == kInvalidSocket) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return kInvalidSocket;
+    }
+    
+    int reuse = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    
+    if (bind(listen_socket, reinterpret_cast<sockaddr*>(&bind_address), sizeof(bind_address)) != 0 ||
+        listen(listen_socket, backlog) != 0) {
+        std::cerr << "Failed to listen on " << address << ":" << port << std::endl;
+        closeSocket(listen_socket);
+        return kInvalidSocket;
+    }
+    return listen_socket;
+}
+
+// Starts a non-blocking connect to host:port. Returns the socket (poll it for
+// writability, then check socketError()) or kInvalidSocket if the host doesn't
+// resolve or the socket can't be created.
+inline SocketHandle connectTcp(const std::string& host, int port) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &results) != 0 || !results) return kInvalidSocket;
+    
+    SocketHandle connection = socket(results->ai_family, results->ai_socktype, results->ai_protocol);
+    if (connection != kInvalidSocket) {
+        setNoDelay(connection);
+        if (!setNonBlocking(connection) ||
+            (connect(connection, results->ai_addr, static_cast<int>(results->ai_addrlen)) != 0 && !socketWouldBlock())) {
+            closeSocket(connection);
+            connection = kInvalidSocket;
+        }
+    }
+    freeaddrinfo(results);
+    return connection;
+}
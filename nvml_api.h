@@ -0,0 +1,249 @@
+#pragma once
+
+// Runtime-loaded NVML. The entry points gputune uses are resolved from
+// libnvidia-ml.so.1 (Linux) or nvml.dll (Windows) into a function-pointer
+// table on first use, so there is no link-time dependency on the driver and
+// machines without NVIDIA hardware simply report NVML as unavailable. Every
+// entry point records its call latency, for the Diagnostics window and exporter.
+
+#if defined(_WIN32) || defined(__linux__)
+    #define GPUTUNE_HAVE_NVML 1
+#endif
+
+#ifdef GPUTUNE_HAVE_NVML
+
+#include <iostream>
+#include <mutex>
+
+#include <nvml.h>
+
+#include "latency_histogram.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN // Keeps winsock.h out, so winsock2.h can follow
+    #endif
+    #include <windows.h>
+#else
+    #include <dlfcn.h>
+#endif
+
+// X(member, exported symbol). Symbols are the versioned names nvml.h maps its
+// public API to, since that is what the shared library actually exports.
+#define GPUTUNE_NVML_REQUIRED_FUNCTIONS(X) \
+    X(Init, nvmlInit_v2) \
+    X(Shutdown, nvmlShutdown) \
+    X(ErrorString, nvmlErrorString) \
+    X(DeviceGetCount, nvmlDeviceGetCount_v2) \
+    X(DeviceGetHandleByIndex, nvmlDeviceGetHandleByIndex_v2)
+
+#define GPUTUNE_NVML_OPTIONAL_FUNCTIONS(X) \
+    X(SystemGetDriverVersion, nvmlSystemGetDriverVersion) \
+    X(DeviceGetName, nvmlDeviceGetName) \
+    X(DeviceGetUUID, nvmlDeviceGetUUID) \
+    X(DeviceGetPciInfo, nvmlDeviceGetPciInfo_v3) \
+    X(DeviceGetTemperature, nvmlDeviceGetTemperature) \
+    X(DeviceGetMemoryInfo, nvmlDeviceGetMemoryInfo) \
+    X(DeviceGetUtilizationRates, nvmlDeviceGetUtilizationRates) \
+    X(DeviceGetPowerUsage, nvmlDeviceGetPowerUsage) \
+    X(DeviceGetPowerManagementLimitConstraints, nvmlDeviceGetPowerManagementLimitConstraints) \
+    X(DeviceGetPowerManagementDefaultLimit, nvmlDeviceGetPowerManagementDefaultLimit) \
+    X(DeviceGetPowerManagementLimit, nvmlDeviceGetPowerManagementLimit) \
+    X(DeviceSetPowerManagementLimit, nvmlDeviceSetPowerManagementLimit) \
+    X(DeviceGetClockInfo, nvmlDeviceGetClockInfo) \
+    X(DeviceGetApplicationsClock, nvmlDeviceGetApplicationsClock) \
+    X(DeviceSetApplicationsClocks, nvmlDeviceSetApplicationsClocks) \
+    X(DeviceResetApplicationsClocks, nvmlDeviceResetApplicationsClocks) \
+    X(DeviceGetSupportedMemoryClocks, nvmlDeviceGetSupportedMemoryClocks) \
+    X(DeviceGetSupportedGraphicsClocks, nvmlDeviceGetSupportedGraphicsClocks) \
+    X(DeviceGetFanSpeed, nvmlDeviceGetFanSpeed) \
+    X(DeviceGetNumFans, nvmlDeviceGetNumFans) \
+    X(DeviceSetFanSpeed_v2, nvmlDeviceSetFanSpeed_v2) \
+    X(DeviceSetDefaultFanSpeed_v2, nvmlDeviceSetDefaultFanSpeed_v2) \
+    X(DeviceGetSamples, nvmlDeviceGetSamples) \
+    X(DeviceGetComputeRunningProcesses, nvmlDeviceGetComputeRunningProcesses_v3) \
+    X(DeviceGetProcessUtilization, nvmlDeviceGetProcessUtilization) \
+    X(SystemGetProcessName, nvmlSystemGetProcessName) \
+    X(DeviceGetCurrentClocksThrottleReasons, nvmlDeviceGetCurrentClocksThrottleReasons) \
+    X(DeviceGetFieldValues, nvmlDeviceGetFieldValues) \
+    X(DeviceGetPcieThroughput, nvmlDeviceGetPcieThroughput) \
+    X(DeviceGetEncoderUtilization, nvmlDeviceGetEncoderUtilization) \
+    X(DeviceGetDecoderUtilization, nvmlDeviceGetDecoderUtilization) \
+    X(EventSetCreate, nvmlEventSetCreate) \
+    X(EventSetFree, nvmlEventSetFree) \
+    X(EventSetWait, nvmlEventSetWait_v2) \
+    X(DeviceGetSupportedEventTypes, nvmlDeviceGetSupportedEventTypes) \
+    X(DeviceRegisterEvents, nvmlDeviceRegisterEvents)
+
+// Optional entry points missing from an older driver resolve to this stub, so
+// callers only ever have to check the nvmlReturn_t they already handle
+template <typename Fn>
+struct NvmlMissingFunction;
+
+template <typename... Args>
+struct NvmlMissingFunction<nvmlReturn_t (*)(Args...)> {
+    static nvmlReturn_t call(Args...) { return NVML_ERROR_FUNCTION_NOT_FOUND; }
+};
+
+// A resolved entry point plus the latency histogram of its calls. Callers use
+// it like the plain function pointer: nvml.DeviceGetTemperature(device, ...).
+template <typename Fn>
+struct NvmlTimedFunction;
+
+template <typename R, typename... Args>
+struct NvmlTimedFunction<R (*)(Args...)> {
+    R (*function)(Args...) = nullptr;
+    LatencyHistogram latency;
+    
+    R operator()(Args... args) {
+        ScopedLatencyTimer timer(latency);
+        return function(args...);
+    }
+};
+
+class NvmlApi {
+private:
+    std::mutex load_mutex;
+    bool load_attempted = false;
+    bool loaded = false;
+#ifdef _WIN32
+    HMODULE library = nullptr;
+#else
+    void* library = nullptr;
+#endif
+    
+    void* resolve(const char* symbol) {
+#ifdef _WIN32
+        return reinterpret_cast<void*>(GetProcAddress(library, symbol));
+#else
+        return dlsym(library, symbol);
+#endif
+    }
+    
+    bool openLibrary() {
+#ifdef _WIN32
+        library = LoadLibraryA("nvml.dll");
+        if (!library) {
+            // Drivers before R418 install NVML next to nvidia-smi instead of System32
+            char path[MAX_PATH];
+            DWORD length = ExpandEnvironmentStringsA("%ProgramFiles%\\NVIDIA Corporation\\NVSMI\\nvml.dll", path, MAX_PATH);
+            if (length > 0 && length <= MAX_PATH) {
+                library = LoadLibraryA(path);
+            }
+        }
+#else
+        library = dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+        if (!library) {
+            library = dlopen("libnvidia-ml.so", RTLD_NOW | RTLD_LOCAL);
+        }
+#endif
+        return library != nullptr;
+    }
+    
+    void closeLibrary() {
+        if (!library) return;
+#ifdef _WIN32
+        FreeLibrary(library);
+#else
+        dlclose(library);
+#endif
+        library = nullptr;
+    }
+    
+public:
+#define GPUTUNE_NVML_DECLARE(member, symbol) NvmlTimedFunction<decltype(&::symbol)> member;
+    GPUTUNE_NVML_REQUIRED_FUNCTIONS(GPUTUNE_NVML_DECLARE)
+    GPUTUNE_NVML_OPTIONAL_FUNCTIONS(GPUTUNE_NVML_DECLARE)
+#undef GPUTUNE_NVML_DECLARE
+    
+    ~NvmlApi() { closeLibrary(); }
+    
+    // Loads the library on first call; later calls return the cached result
+    bool load() {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (load_attempted) return loaded;
+        load_attempted = true;
+        
+        if (!openLibrary()) {
+            std::cout << "NVML library not found" << std::endl;
+            return false;
+        }
+        
+        bool complete = true;
+#define GPUTUNE_NVML_RESOLVE_REQUIRED(member, symbol) \
+        member.function = reinterpret_cast<decltype(member.function)>(resolve(#symbol)); \
+        if (!member.function) { \
+            std::cout << "NVML library is missing " #symbol << std::endl; \
+            complete = false; \
+        }
+        GPUTUNE_NVML_REQUIRED_FUNCTIONS(GPUTUNE_NVML_RESOLVE_REQUIRED)
+#undef GPUTUNE_NVML_RESOLVE_REQUIRED
+
+#define GPUTUNE_NVML_RESOLVE_OPTIONAL(member, symbol) \
+        member.function = reinterpret_cast<decltype(member.function)>(resolve(#symbol)); \
+        if (!member.function) { \
+            member.function = &NvmlMissingFunction<decltype(member.function)>::call; \
+        }
+        GPUTUNE_NVML_OPTIONAL_FUNCTIONS(GPUTUNE_NVML_RESOLVE_OPTIONAL)
+#undef GPUTUNE_NVML_RESOLVE_OPTIONAL
+        
+        if (!complete) {
+            closeLibrary();
+            return false;
+        }
+        loaded = true;
+        return true;
+    }
+    
+    // Fills the table from fill(*this) instead of the driver library, e.g. with a
+    // mock backend for benchmarks. Entries fill leaves empty resolve like missing
+    // optional symbols; required ones must be set. Must run before the first load().
+    template <typename Filler>
+    bool loadWith(Filler&& fill) {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (load_attempted) return loaded;
+        load_attempted = true;
+        
+        fill(*this);
+        bool complete = true;
+#define GPUTUNE_NVML_CHECK_REQUIRED(member, symbol) \
+        if (!member.function) { \
+            std::cout << "NVML table is missing " #symbol << std::endl; \
+            complete = false; \
+        }
+        GPUTUNE_NVML_REQUIRED_FUNCTIONS(GPUTUNE_NVML_CHECK_REQUIRED)
+#undef GPUTUNE_NVML_CHECK_REQUIRED
+
+#define GPUTUNE_NVML_DEFAULT_OPTIONAL(member, symbol) \
+        if (!member.function) { \
+            member.function = &NvmlMissingFunction<decltype(member.function)>::call; \
+        }
+        GPUTUNE_NVML_OPTIONAL_FUNCTIONS(GPUTUNE_NVML_DEFAULT_OPTIONAL)
+#undef GPUTUNE_NVML_DEFAULT_OPTIONAL
+        
+        loaded = complete;
+        return loaded;
+    }
+    
+    bool isLoaded() const { return loaded; }
+    
+    // Calls visit(name, histogram) for every entry point, in table order
+    template <typename Visitor>
+    void forEachCallLatency(Visitor&& visit) {
+#define GPUTUNE_NVML_VISIT(member, symbol) visit(#member, member.latency);
+        GPUTUNE_NVML_REQUIRED_FUNCTIONS(GPUTUNE_NVML_VISIT)
+        GPUTUNE_NVML_OPTIONAL_FUNCTIONS(GPUTUNE_NVML_VISIT)
+#undef GPUTUNE_NVML_VISIT
+    }
+};
+
+// Process-wide table, loaded lazily by the first GPUMonitor
+inline NvmlApi& nvmlApi() {
+    static NvmlApi api;
+    return api;
+}
+
+#endif // GPUTUNE_HAVE_NVML
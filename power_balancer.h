@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gpu_monitor.h"
+#include "profile_apply.h"
+
+// Node-wide power budget. Every control period the budget is split between
+// the GPUs' power limits by demand: each GPU first gets its minimum limit,
+// then its current draw plus a margin, then GPUs that are power-capped while
+// busy get a step more, and whatever is left is spread by headroom. Idle GPUs
+// thereby give up their headroom to starved ones, while the sum of the limits
+// (and so the node's draw) never exceeds the budget. Raises are rate limited
+// so the control loop doesn't oscillate; cuts take effect at once.
+struct PowerBudgetOptions {
+    unsigned int budget_w = 0;
+    double period_seconds = 2.0;
+    int busy_utilization = 80;    // % at or above which a power-capped GPU is starved
+    int idle_utilization = 20;    // % below which a GPU is idle
+    unsigned int margin_w = 15;   // Kept above a GPU's draw, so it isn't capped by accident
+    unsigned int max_step_w = 50; // Largest raise per period
+    unsigned int deadband_w = 5;  // Smaller raises are skipped to save NVML calls
+};
+
+enum class PowerDemand : uint8_t {
+    Idle,
+    Steady,
+    Starved // Power-capped at high utilization; more headroom would raise clocks
+};
+
+inline const char* powerDemandName(PowerDemand demand) {
+    switch (demand) {
+        case PowerDemand::Idle: return "Idle";
+        case PowerDemand::Steady: return "Steady";
+        case PowerDemand::Starved: return "Power-capped";
+    }
+    return "";
+}
+
+struct PowerBalanceInput {
+    unsigned int min_mw = 0;
+    unsigned int max_mw = 0;
+    unsigned int current_mw = 0; // Limit in force now
+    unsigned int usage_mw = 0;
+    PowerDemand demand = PowerDemand::Steady;
+};
+
+inline PowerDemand classifyPowerDemand(const GPUInfo& gpu, const PowerBudgetOptions& options) {
+    bool power_capped = (gpu.throttle_reasons & (kThrottleSwPowerCap | kThrottleHwPowerBrake)) != 0;
+    if (power_capped && gpu.gpu_utilization >= options.busy_utilization) return PowerDemand::Starved;
+    if (gpu.gpu_utilization < options.idle_utilization) return PowerDemand::Idle;
+    return PowerDemand::Steady;
+}
+
+// One control step, without NVML. Returns false if the budget doesn't even
+// cover the minimum limits, in which case every GPU gets its minimum.
+inline bool allocatePowerBudget(const std::vector<PowerBalanceInput>& gpus, const PowerBudgetOptions& options,
+                                std::vector<unsigned int>& limits_mw) {
+    size_t count = gpus.size();
+    limits_mw.resize(count);
+    uint64_t floor_total = 0;
+    for (size_t i = 0; i < count; i++) {
+        limits_mw[i] = gpus[i].min_mw;
+        floor_total += gpus[i].min_mw;
+    }
+    uint64_t budget = static_cast<uint64_t>(options.budget_w) * 1000;
+    if (floor_total > budget) return false;
+    uint64_t remaining = budget - floor_total;
+    
+    // Hands out up to remaining in proportion to each GPU's want, capped at the want
+    std::vector<uint64_t> want(count);
+    auto grant = [&]() {
+        uint64_t total = 0;
+        for (uint64_t w : want) total += w;
+        if (total == 0) return;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t share = total <= remaining ? want[i] : want[i] * remaining / total;
+            limits_mw[i] += static_cast<unsigned int>(share);
+        }
+        remaining -= std::min(total, remaining);
+    };
+    
+    // 1. What each GPU draws now, plus the margin
+    for (size_t i = 0; i < count; i++) {
+        uint64_t target = std::min<uint64_t>(gpus[i].max_mw, gpus[i].usage_mw + options.margin_w * 1000ull);
+        want[i] = target > limits_mw[i] ? target - limits_mw[i] : 0;
+    }
+    grant();
+    
+    // 2. A step more for the starved ones
+    for (size_t i = 0; i < count; i++) {
+        want[i] = 0;
+        if (gpus[i].demand != PowerDemand::Starved) continue;
+        uint64_t target = std::min<uint64_t>(gpus[i].max_mw, std::max(gpus[i].current_mw, limits_mw[i]) +
+                                                                  options.max_step_w * 1000ull);
+        want[i] = target > limits_mw[i] ? target - limits_mw[i] : 0;
+    }
+    grant();
+    
+    // 3. The rest by headroom, so busy GPUs that aren't capped yet have room to grow
+    for (size_t i = 0; i < count; i++) {
+        want[i] = gpus[i].demand == PowerDemand::Idle ? 0 : gpus[i].max_mw - limits_mw[i];
+    }
+    grant();
+    
+    // Cuts now, raises in steps: the sum stays within the budget either way
+    for (size_t i = 0; i < count; i++) {
+        unsigned int current = std::max(gpus[i].min_mw, std::min(gpus[i].current_mw, gpus[i].max_mw));
+        if (limits_mw[i] <= current) continue;
+        unsigned int raise = std::min(limits_mw[i] - current, options.max_step_w * 1000);
+        limits_mw[i] = raise < options.deadband_w * 1000 ? current : current + raise;
+    }
+    return true;
+}
+
+struct PowerBalanceStatus {
+    bool active = false;
+    bool feasible = true;  // Budget covers every GPU's minimum limit
+    uint64_t rebalances = 0;
+    unsigned int total_limit_w = 0;
+    unsigned int total_usage_w = 0;
+    std::vector<PowerDemand> demand; // Per GPU index
+    std::vector<unsigned int> limit_w;
+    std::string error;     // Last apply failure, if any
+};
+
+// Runs the budget against the live devices. update() is meant to be called
+// every frame (or loop iteration) from the thread that owns the device set;
+// it only does work once per control period. Limits are set through
+// ProfileApplier, and the limits found at start() are put back by stop().
+class PowerBalancer {
+private:
+    GPUMonitor& monitor;
+    ProfileApplier applier;
+    PowerBudgetOptions options;
+    PowerBalanceStatus state;
+    uint64_t generation = UINT64_MAX;
+    std::chrono::steady_clock::time_point next_balance;
+    std::unordered_map<std::string, unsigned int> original_limits; // By UUID, restored by stop()
+    std::vector<unsigned int> current_limits; // Per GPU index, mW
+    std::vector<PowerBalanceInput> inputs;
+    std::vector<unsigned int> limits;
+    
+    // Re-reads every limit after the device set changed; new GPUs' limits become their originals
+    void syncDevices() {
+        const auto& gpus = monitor.getGPUs();
+        current_limits.assign(gpus.size(), 0);
+        for (size_t i = 0; i < gpus.size(); i++) {
+            unsigned int limit_mw = 0;
+            if (!monitor.getPowerLimit(i, limit_mw)) {
+                const GPUDevice* device = monitor.getDevice(i);
+                limit_mw = device ? device->power_limit_max : 0;
+            }
+            current_limits[i] = limit_mw;
+            if (!gpus[i].uuid.empty()) original_limits.emplace(gpus[i].uuid, limit_mw);
+        }
+        generation = monitor.deviceGeneration();
+    }
+    
+    // Re-reads the limits in force, which Apply Settings, profile import or the
+    // auto-tuner may have changed since the last period
+    void refreshLimits() {
+        for (size_t i = 0; i < current_limits.size(); i++) {
+            unsigned int limit_mw = 0;
+            if (monitor.getPowerLimit(i, limit_mw)) current_limits[i] = limit_mw;
+        }
+    }
+    
+    // Sets the limits and records the ones that took; returns false if any didn't
+    bool applyChanges(const std::vector<std::pair<size_t, TuningProfile>>& changes, bool& changed) {
+        if (changes.empty()) return true;
+        ProfileApplyReport report = applier.applyEach(changes, false);
+        bool all_applied = true;
+        for (const DeviceApplyResult& result : report.devices) {
+            if (result.outcome == ApplyOutcome::Applied) {
+                current_limits[result.gpu_index] = limits[result.gpu_index];
+                changed = true;
+                continue;
+            }
+            all_applied = false;
+            if (state.error.empty()) {
+                state.error = "GPU " + std::to_string(result.gpu_index) + ": " + result.detail;
+            }
+        }
+        return all_applied && report.devices.size() == changes.size();
+    }
+    
+public:
+    explicit PowerBalancer(GPUMonitor& target) : monitor(target), applier(target) {}
+    ~PowerBalancer() { stop(); }
+    
+    PowerBalancer(const PowerBalancer&) = delete;
+    PowerBalancer& operator=(const PowerBalancer&) = delete;
+    
+    void start(const PowerBudgetOptions& opts) {
+        options = opts;
+        if (!state.active) {
+            original_limits.clear();
+            generation = UINT64_MAX;
+        }
+        state.active = true;
+        state.error.clear();
+        next_balance = std::chrono::steady_clock::now();
+    }
+    
+    // Budget and tuning changes take effect at the next period
+    void setOptions(const PowerBudgetOptions& opts) { options = opts; }
+    const PowerBudgetOptions& getOptions() const { return options; }
+    
+    // Puts back the limits the GPUs had before balancing
+    void stop() {
+        if (!state.active) return;
+        state.active = false;
+        const auto& gpus = monitor.getGPUs();
+        std::vector<std::pair<size_t, TuningProfile>> restores;
+        for (size_t i = 0; i < gpus.size(); i++) {
+            auto original = original_limits.find(gpus[i].uuid);
+            if (original == original_limits.end() || original->second == 0) continue;
+            TuningProfile profile;
+            profile.power_limit_mw = original->second;
+            restores.emplace_back(i, profile);
+        }
+        applier.applyEach(restores, false);
+        original_limits.clear();
+    }
+    
+    bool isActive() const { return state.active; }
+    const PowerBalanceStatus& status() const { return state; }
+    
+    // Returns true if limits were changed
+    bool update() {
+        if (!state.active) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now < next_balance) return false;
+        next_balance = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(options.period_seconds));
+        if (generation != monitor.deviceGeneration()) {
+            syncDevices();
+        } else {
+            refreshLimits();
+        }
+        
+        const auto& gpus = monitor.getGPUs();
+        size_t count = std::min(gpus.size(), current_limits.size());
+        inputs.resize(count);
+        state.demand.resize(count);
+        state.total_usage_w = 0;
+        for (size_t i = 0; i < count; i++) {
+            const GPUDevice* device = monitor.getDevice(i);
+            PowerBalanceInput& input = inputs[i];
+            input.min_mw = device ? device->power_limit_min : 0;
+            input.max_mw = device ? std::max(device->power_limit_max, input.min_mw) : 0;
+            input.current_mw = current_limits[i];
+            input.usage_mw = static_cast<unsigned int>(std::max(0, gpus[i].power_usage)) * 1000;
+            // A GPU we have no fresh reading for keeps what it has
+            input.demand = gpus[i].stale ? PowerDemand::Steady : classifyPowerDemand(gpus[i], options);
+            if (gpus[i].stale) input.usage_mw = std::max(input.usage_mw, input.current_mw);
+            state.demand[i] = input.demand;
+            state.total_usage_w += static_cast<unsigned int>(std::max(0, gpus[i].power_usage));
+        }
+        
+        state.feasible = allocatePowerBudget(inputs, options, limits);
+        
+        // Cuts go out before raises, so the limits in force never sum past the
+        // budget in between. If a cut didn't land, the raises are re-budgeted
+        // from the limits actually in force.
+        std::vector<std::pair<size_t, TuningProfile>> cuts;
+        std::vector<std::pair<size_t, TuningProfile>> raises;
+        for (size_t i = 0; i < count; i++) {
+            if (limits[i] == current_limits[i] || inputs[i].max_mw == 0) continue;
+            TuningProfile profile;
+            profile.power_limit_mw = limits[i];
+            (limits[i] < current_limits[i] ? cuts : raises).emplace_back(i, profile);
+        }
+        
+        bool changed = false;
+        if (!cuts.empty() || !raises.empty()) {
+            state.error.clear();
+            state.rebalances++;
+        }
+        if (!applyChanges(cuts, changed)) {
+            uint64_t in_force = 0;
+            for (size_t i = 0; i < count; i++) in_force += current_limits[i];
+            uint64_t budget = static_cast<uint64_t>(options.budget_w) * 1000;
+            uint64_t available = budget > in_force ? budget - in_force : 0;
+            
+            std::vector<std::pair<size_t, TuningProfile>> fitted;
+            for (auto& raise : raises) {
+                size_t i = raise.first;
+                uint64_t take = std::min<uint64_t>(limits[i] - current_limits[i], available);
+                if (take < options.deadband_w * 1000ull) continue;
+                available -= take;
+                limits[i] = current_limits[i] + static_cast<unsigned int>(take);
+                raise.second.power_limit_mw = limits[i];
+                fitted.push_back(raise);
+            }
+            raises.swap(fitted);
+        }
+        applyChanges(raises, changed);
+        
+        state.limit_w.resize(count);
+        state.total_limit_w = 0;
+        for (size_t i = 0; i < count; i++) {
+            state.limit_w[i] = current_limits[i] / 1000;
+            state.total_limit_w += state.limit_w[i];
+        }
+        return changed;
+    }
+};
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gpu_monitor.h"
+#include "worker_pool.h"
+
+// Tuning settings applied to any number of GPUs in one step. A zero clock or
+// power field leaves that setting as it is.
+struct TuningProfile {
+    std::string name;
+    unsigned int core_clock = 0;   // MHz application clock, paired with memory_clock
+    unsigned int memory_clock = 0; // MHz
+    int power_limit_percent = 0;   // Of the board's maximum, clamped to its constraints
+    unsigned int power_limit_mw = 0; // Absolute limit, used instead of the percentage; not stored in profile files
+    bool set_fan_curve = false;
+    bool fan_control = false;      // Drive fans from fan_curve (needs set_fan_curve)
+    int fan_curve[kFanCurvePoints] = {30, 40, 50, 70, 85};
+    
+    // The tuning targets edited in the UI for one GPU
+    static TuningProfile fromTargets(const GPUInfo& gpu) {
+        TuningProfile profile;
+        if (gpu.target_core_clock > 0) {
+            profile.core_clock = static_cast<unsigned int>(gpu.target_core_clock);
+            profile.memory_clock = static_cast<unsigned int>(std::max(0, gpu.target_memory_clock));
+        }
+        profile.power_limit_percent = std::max(0, gpu.target_power_limit);
+        profile.set_fan_curve = true;
+        profile.fan_control = gpu.target_fan_control;
+        std::copy(gpu.target_fan_curve, gpu.target_fan_curve + kFanCurvePoints, profile.fan_curve);
+        return profile;
+    }
+    
+    // Loads the settings this profile changes into the UI's targets
+    void toTargets(GPUInfo& gpu) const {
+        if (core_clock > 0) {
+            gpu.target_core_clock = static_cast<int>(core_clock);
+            gpu.target_memory_clock = static_cast<int>(memory_clock);
+        }
+        if (power_limit_percent > 0) gpu.target_power_limit = power_limit_percent;
+        if (set_fan_curve) {
+            gpu.target_fan_control = fan_control;
+            std::copy(fan_curve, fan_curve + kFanCurvePoints, gpu.target_fan_curve);
+        }
+    }
+};
+
+// Which GPUs a profile goes to: the listed indices (all if none), optionally
+// narrowed to names containing name_filter
+struct DeviceSelector {
+    std::vector<size_t> indices;
+    std::string name_filter;
+    
+    static DeviceSelector all() { return DeviceSelector(); }
+    
+    static DeviceSelector single(size_t gpu_index) {
+        DeviceSelector selector;
+        selector.indices.push_back(gpu_index);
+        return selector;
+    }
+    
+    bool matches(size_t gpu_index, const GPUInfo& gpu) const {
+        if (!indices.empty() && std::find(indices.begin(), indices.end(), gpu_index) == indices.end()) return false;
+        return name_filter.empty() || gpu.name.find(name_filter) != std::string::npos;
+    }
+};
+
+enum class ApplyOutcome {
+    Applied,
+    Rejected,   // Failed validation; nothing was changed
+    Failed,     // The driver refused a change; this device's earlier changes were undone
+    RolledBack, // Applied, then undone because another device failed (all_or_nothing)
+    Skipped     // Not attempted because another device was rejected (all_or_nothing)
+};
+
+inline const char* applyOutcomeName(ApplyOutcome outcome) {
+    switch (outcome) {
+        case ApplyOutcome::Applied: return "Applied";
+        case ApplyOutcome::Rejected: return "Rejected";
+        case ApplyOutcome::Failed: return "Failed";
+        case ApplyOutcome::RolledBack: return "Rolled back";
+        case ApplyOutcome::Skipped: return "Skipped";
+    }
+    return "";
+}
+
+struct DeviceApplyResult {
+    size_t gpu_index = 0;
+    std::string name;
+    std::string uuid;
+    ApplyOutcome outcome = ApplyOutcome::Skipped;
+    std::string detail; // Why it was rejected or failed, or notes such as clamping
+    bool rollback_incomplete = false; // Undoing a change failed too; the device is in a mixed state
+};
+
+struct ProfileApplyReport {
+    std::vector<DeviceApplyResult> devices; // Matched GPUs, in index order
+    size_t applied = 0;
+    size_t rejected = 0;
+    size_t failed = 0;
+    size_t rolled_back = 0;
+    size_t skipped = 0;
+    double duration_ms = 0.0;
+    
+    bool succeeded() const { return !devices.empty() && applied == devices.size(); }
+};
+
+// Closest entry of a non-empty supported-clock table
+inline unsigned int nearestClock(const std::vector<unsigned int>& clocks, unsigned int mhz) {
+    unsigned int best = clocks.front();
+    for (unsigned int clock : clocks) {
+        unsigned int distance = clock > mhz ? clock - mhz : mhz - clock;
+        unsigned int best_distance = best > mhz ? best - mhz : mhz - best;
+        if (distance < best_distance) best = clock;
+    }
+    return best;
+}
+
+// Applies one TuningProfile to every GPU a selector matches, or a profile per
+// GPU. Devices are handled in parallel on a small worker pool, in three phases:
+//   1. validate: clocks must be a pair from the board's supported-clock tables,
+//      the power limit must be adjustable, fan control needs controllable fans;
+//   2. apply: remember the current power limit, application clocks and fan
+//      curve, then change them in that order, checking every return code; the
+//      first refusal undoes this device's earlier changes;
+//   3. with all_or_nothing, any rejection or failure undoes every other device
+//      (a rejection found in phase 1 stops phase 2 from starting at all).
+// Blocks until all devices are done. Call from the thread that owns the device
+// set (the UI thread), and not while the auto-tuner drives the same GPUs.
+class ProfileApplier {
+private:
+    static constexpr size_t kMaxWorkers = 16;
+    
+    struct DeviceJob {
+        DeviceApplyResult result;
+        const TuningProfile* profile = nullptr;
+        // Validated request
+        bool set_clocks = false;
+        bool set_power = false;
+        unsigned int power_limit_mw = 0;
+        // State before the apply, restored on rollback
+        bool had_clocks = false;
+        unsigned int previous_memory_clock = 0;
+        unsigned int previous_core_clock = 0;
+        bool had_power = false;
+        unsigned int previous_power_limit_mw = 0;
+        FanCurveSettings previous_fan_curve;
+        // What has been changed so far
+        bool changed_power = false;
+        bool changed_clocks = false;
+        bool changed_fans = false;
+    };
+    
+    GPUMonitor& monitor;
+    std::unique_ptr<WorkerPool> pool;
+    
+    // Runs fn(job) for every job, spread over the pool; returns when all are done
+    template <typename Fn>
+    void forEachParallel(std::vector<DeviceJob>& jobs, Fn fn) {
+        if (jobs.size() <= 1) {
+            for (DeviceJob& job : jobs) fn(job);
+            return;
+        }
+        size_t workers = std::min(jobs.size(), kMaxWorkers);
+        if (!pool || pool->size() != workers) {
+            pool.reset(new WorkerPool(workers));
+        }
+        CompletionLatch latch(static_cast<int>(jobs.size()));
+        for (DeviceJob& job : jobs) {
+            DeviceJob* target = &job;
+            pool->submit([&fn, &latch, target] {
+                fn(*target);
+                latch.countDown();
+            });
+        }
+        // NVML calls return or time out in the driver, so this wait is bounded in practice
+        while (!latch.waitUntil(std::chrono::steady_clock::now() + std::chrono::seconds(1))) {
+        }
+    }
+    
+    void validate(DeviceJob& job) {
+        const TuningProfile& profile = *job.profile;
+        size_t gpu = job.result.gpu_index;
+        const GPUDevice* device = monitor.getDevice(gpu);
+        char detail[160];
+        
+        if (profile.core_clock > 0 || profile.memory_clock > 0) {
+            std::vector<unsigned int> memory_clocks = monitor.getSupportedMemoryClocks(gpu);
+            if (memory_clocks.empty()) {
+                reject(job, "Application clocks are not adjustable on this board");
+                return;
+            }
+            if (profile.core_clock == 0 || profile.memory_clock == 0) {
+                reject(job, "Core and memory clocks must be set together");
+                return;
+            }
+            unsigned int memory_match = nearestClock(memory_clocks, profile.memory_clock);
+            if (memory_match != profile.memory_clock) {
+                std::snprintf(detail, sizeof(detail), "Memory clock %u MHz is not supported (nearest: %u MHz)",
+                              profile.memory_clock, memory_match);
+                reject(job, detail);
+                return;
+            }
+            std::vector<unsigned int> core_clocks = monitor.getSupportedGraphicsClocks(gpu, profile.memory_clock);
+            if (core_clocks.empty()) {
+                std::snprintf(detail, sizeof(detail), "No core clocks are supported with memory at %u MHz",
+                              profile.memory_clock);
+                reject(job, detail);
+                return;
+            }
+            unsigned int core_match = nearestClock(core_clocks, profile.core_clock);
+            if (core_match != profile.core_clock) {
+                std::snprintf(detail, sizeof(detail), "Core clock %u MHz is not supported with memory at %u MHz (nearest: %u MHz)",
+                              profile.core_clock, profile.memory_clock, core_match);
+                reject(job, detail);
+                return;
+            }
+            job.set_clocks = true;
+        }
+        
+        if (profile.power_limit_percent > 0 || profile.power_limit_mw > 0) {
+            if (!device || device->power_limit_max == 0) {
+                reject(job, "Power limit is not adjustable on this board");
+                return;
+            }
+            unsigned int requested = profile.power_limit_mw > 0 ? profile.power_limit_mw : static_cast<unsigned int>(
+                static_cast<unsigned long long>(device->power_limit_max) * profile.power_limit_percent / 100);
+            job.power_limit_mw = std::max(device->power_limit_min, std::min(requested, device->power_limit_max));
+            job.set_power = true;
+            if (job.power_limit_mw != requested) {
+                std::snprintf(detail, sizeof(detail), "Power limit clamped to %u W", job.power_limit_mw / 1000);
+                job.result.detail = detail;
+            }
+        }
+        
+        if (profile.set_fan_curve && profile.fan_control && monitor.getFanCount(gpu) == 0) {
+            reject(job, "Fans are not controllable on this board");
+            return;
+        }
+    }
+    
+    static void reject(DeviceJob& job, const char* detail) {
+        job.result.outcome = ApplyOutcome::Rejected;
+        job.result.detail = detail;
+    }
+    
+    void apply(DeviceJob& job) {
+        const TuningProfile& profile = *job.profile;
+        size_t gpu = job.result.gpu_index;
+        char detail[160];
+        
+        // Remember everything first, so a refusal halfway can be undone
+        if (job.set_power) {
+            job.had_power = monitor.getPowerLimit(gpu, job.previous_power_limit_mw);
+        }
+        if (job.set_clocks) {
+            job.had_clocks = monitor.getApplicationClocks(gpu, job.previous_memory_clock, job.previous_core_clock);
+        }
+        if (profile.set_fan_curve) {
+            monitor.getFanCurve(gpu, job.previous_fan_curve);
+        }
+        
+        if (job.set_power) {
+            if (!monitor.setPowerLimit(gpu, job.power_limit_mw)) {
+                std::snprintf(detail, sizeof(detail), "Driver refused power limit %u W (needs administrator rights)",
+                              job.power_limit_mw / 1000);
+                fail(job, detail);
+                return;
+            }
+            job.changed_power = true;
+        }
+        
+        if (job.set_clocks) {
+            if (!monitor.setApplicationClocks(gpu, profile.memory_clock, profile.core_clock)) {
+                std::snprintf(detail, sizeof(detail), "Driver refused clocks %u/%u MHz (needs administrator rights)",
+                              profile.core_clock, profile.memory_clock);
+                fail(job, detail);
+                return;
+            }
+            job.changed_clocks = true;
+        }
+        
+        if (profile.set_fan_curve) {
+            if (!monitor.setFanCurve(gpu, profile.fan_curve, profile.fan_control)) {
+                fail(job, "Fan curve was not accepted");
+                return;
+            }
+            job.changed_fans = true;
+        }
+        
+        job.result.outcome = ApplyOutcome::Applied;
+    }
+    
+    void fail(DeviceJob& job, const char* detail) {
+        job.result.outcome = ApplyOutcome::Failed;
+        job.result.detail = detail;
+        rollback(job);
+    }
+    
+    // Undoes this device's changes, newest first. Clocks whose previous value
+    // couldn't be read go back to the driver default.
+    void rollback(DeviceJob& job) {
+        size_t gpu = job.result.gpu_index;
+        bool restored = true;
+        if (job.changed_fans) {
+            restored &= monitor.setFanCurve(gpu, job.previous_fan_curve.curve, job.previous_fan_curve.enabled);
+            job.changed_fans = false;
+        }
+        if (job.changed_clocks) {
+            restored &= job.had_clocks
+                            ? monitor.setApplicationClocks(gpu, job.previous_memory_clock, job.previous_core_clock)
+                            : monitor.resetApplicationClocks(gpu);
+            job.changed_clocks = false;
+        }
+        if (job.changed_power) {
+            const GPUDevice* device = monitor.getDevice(gpu);
+            unsigned int previous = job.had_power ? job.previous_power_limit_mw : device ? device->power_limit_default : 0;
+            restored &= previous > 0 && monitor.setPowerLimit(gpu, previous);
+            job.changed_power = false;
+        }
+        if (!restored) job.result.rollback_incomplete = true;
+    }
+    
+    DeviceJob makeJob(size_t gpu_index, const TuningProfile& profile) {
+        const auto& gpus = monitor.getGPUs();
+        DeviceJob job;
+        job.profile = &profile;
+        job.result.gpu_index = gpu_index;
+        job.result.name = gpus[gpu_index].name;
+        job.result.uuid = gpus[gpu_index].uuid;
+        return job;
+    }
+    
+    ProfileApplyReport run(std::vector<DeviceJob>& jobs, bool all_or_nothing) {
+        auto start = std::chrono::steady_clock::now();
+        ProfileApplyReport report;
+        
+        if (monitor.isNVMLAvailable()) {
+            forEachParallel(jobs, [&](DeviceJob& job) { validate(job); });
+            
+            bool any_rejected = std::any_of(jobs.begin(), jobs.end(), [](const DeviceJob& job) {
+                return job.result.outcome == ApplyOutcome::Rejected;
+            });
+            if (!(all_or_nothing && any_rejected)) {
+                forEachParallel(jobs, [&](DeviceJob& job) {
+                    if (job.result.outcome != ApplyOutcome::Rejected) apply(job);
+                });
+                
+                bool any_failed = std::any_of(jobs.begin(), jobs.end(), [](const DeviceJob& job) {
+                    return job.result.outcome == ApplyOutcome::Failed;
+                });
+                if (all_or_nothing && (any_failed || any_rejected)) {
+                    forEachParallel(jobs, [&](DeviceJob& job) {
+                        if (job.result.outcome != ApplyOutcome::Applied) return;
+                        rollback(job);
+                        job.result.outcome = ApplyOutcome::RolledBack;
+                    });
+                }
+            }
+        } else {
+            for (DeviceJob& job : jobs) reject(job, "NVML is not available");
+        }
+        
+        for (DeviceJob& job : jobs) {
+            switch (job.result.outcome) {
+                case ApplyOutcome::Applied: report.applied++; break;
+                case ApplyOutcome::Rejected: report.rejected++; break;
+                case ApplyOutcome::Failed: report.failed++; break;
+                case ApplyOutcome::RolledBack: report.rolled_back++; break;
+                case ApplyOutcome::Skipped: report.skipped++; break;
+            }
+            report.devices.push_back(std::move(job.result));
+        }
+        report.duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+    
+public:
+    explicit ProfileApplier(GPUMonitor& target) : monitor(target) {}
+    
+    ProfileApplier(const ProfileApplier&) = delete;
+    ProfileApplier& operator=(const ProfileApplier&) = delete;
+    
+    // One profile for every GPU the selector matches
+    ProfileApplyReport apply(const TuningProfile& profile, const DeviceSelector& selector, bool all_or_nothing) {
+        const auto& gpus = monitor.getGPUs();
+        std::vector<DeviceJob> jobs;
+        for (size_t i = 0; i < gpus.size() && i < monitor.deviceCount(); i++) {
+            if (selector.matches(i, gpus[i])) jobs.push_back(makeJob(i, profile));
+        }
+        return run(jobs, all_or_nothing);
+    }
+    
+    // A profile per GPU, e.g. from a ProfileStore keyed by UUID; out-of-range indices are ignored
+    ProfileApplyReport applyEach(const std::vector<std::pair<size_t, TuningProfile>>& assignments, bool all_or_nothing) {
+        std::vector<DeviceJob> jobs;
+        for (const auto& assignment : assignments) {
+            if (assignment.first >= monitor.getGPUs().size() || assignment.first >= monitor.deviceCount()) continue;
+            jobs.push_back(makeJob(assignment.first, assignment.second));
+        }
+        std::sort(jobs.begin(), jobs.end(), [](const DeviceJob& a, const DeviceJob& b) {
+            return a.result.gpu_index < b.result.gpu_index;
+        });
+        return run(jobs, all_or_nothing);
+    }
+};
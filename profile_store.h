@@ -0,0 +1,509 @@
+#pragma once
+
+// Per-GPU tuning profiles for whole fleets, keyed by GPU UUID.
+//
+// Binary form (.gtp), all fields little-endian: a ProfileFileHeader, then
+// record_count fixed-size ProfileRecords sorted by UUID. Since the records
+// need no decoding, ProfileView looks profiles up by binary search directly in
+// a memory-mapped file; nothing is parsed or copied when a file is loaded.
+//
+// Diff form: the changes between two revisions of a store, given as varint-
+// coded upserts and removals, so an agent holding revision N can be brought up
+// to date by sending what changed instead of the whole store.
+//
+// Text form: one line per GPU, for reading and editing by hand:
+//   revision 12
+//   GPU-5f0c... core=1410 memory=1215 power=80 fan=30,40,50,70,85 fan_control=1
+// Settings that are left out stay as they are when the profile is applied.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "binary_codec.h"
+#include "mapped_file.h"
+#include "profile_apply.h"
+
+static const char kProfileMagic[8] = {'G', 'P', 'U', 'T', 'P', 'R', 'O', 'F'};
+static const char kProfileDiffMagic[8] = {'G', 'P', 'U', 'T', 'P', 'D', 'I', 'F'};
+static constexpr uint32_t kProfileVersion = 1;
+static constexpr size_t kProfileUUIDBytes = 48;
+
+// ProfileRecord::flags
+static constexpr uint8_t kProfileFanCurve = 1 << 0;   // fan_curve is set
+static constexpr uint8_t kProfileFanControl = 1 << 1; // Drive the fans from it
+
+struct ProfileFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size; // Newer versions may append fields; readers step by this
+    uint64_t revision;
+    uint32_t record_count;
+    uint8_t reserved[36];
+};
+
+struct ProfileRecord {
+    char uuid[kProfileUUIDBytes]; // NUL-padded
+    uint16_t core_clock;          // MHz, 0 = unchanged
+    uint16_t memory_clock;        // MHz, 0 = unchanged
+    uint8_t power_limit_percent;  // 0 = unchanged
+    uint8_t flags;
+    uint8_t fan_curve[kFanCurvePoints];
+    uint8_t reserved[5];
+};
+
+static_assert(sizeof(ProfileFileHeader) == 64, "ProfileFileHeader layout is part of the file format");
+static_assert(sizeof(ProfileRecord) == 64, "ProfileRecord layout is part of the file format");
+
+inline int compareProfileUUID(const ProfileRecord& record, const char* uuid) {
+    return std::strncmp(record.uuid, uuid, kProfileUUIDBytes);
+}
+
+// Fails for UUIDs that don't fit the record (NVML's are 40 characters)
+inline bool makeProfileRecord(const std::string& uuid, const TuningProfile& profile, ProfileRecord& record) {
+    if (uuid.empty() || uuid.size() >= kProfileUUIDBytes) return false;
+    std::memset(&record, 0, sizeof(record));
+    std::memcpy(record.uuid, uuid.data(), uuid.size());
+    record.core_clock = static_cast<uint16_t>(std::min(profile.core_clock, 65535u));
+    record.memory_clock = static_cast<uint16_t>(std::min(profile.memory_clock, 65535u));
+    record.power_limit_percent = static_cast<uint8_t>(std::max(0, std::min(profile.power_limit_percent, 255)));
+    if (profile.set_fan_curve) {
+        record.flags |= kProfileFanCurve;
+        if (profile.fan_control) record.flags |= kProfileFanControl;
+        for (int i = 0; i < kFanCurvePoints; i++) {
+            record.fan_curve[i] = static_cast<uint8_t>(std::max(0, std::min(profile.fan_curve[i], 100)));
+        }
+    }
+    return true;
+}
+
+inline TuningProfile profileFromRecord(const ProfileRecord& record) {
+    TuningProfile profile;
+    profile.name.assign(record.uuid, strnlen(record.uuid, kProfileUUIDBytes));
+    profile.core_clock = record.core_clock;
+    profile.memory_clock = record.memory_clock;
+    profile.power_limit_percent = record.power_limit_percent;
+    profile.set_fan_curve = (record.flags & kProfileFanCurve) != 0;
+    profile.fan_control = (record.flags & kProfileFanControl) != 0;
+    if (profile.set_fan_curve) {
+        std::copy(record.fan_curve, record.fan_curve + kFanCurvePoints, profile.fan_curve);
+    }
+    return profile;
+}
+
+// Read-only view of a binary profile file held in memory (usually a
+// MappedFile). Lookups search the records in place.
+class ProfileView {
+private:
+    const uint8_t* records = nullptr;
+    size_t record_size = 0;
+    size_t count = 0;
+    uint64_t revision = 0;
+    
+public:
+    // Checks the header, bounds and sort order; false (and an empty view) if any is off
+    bool open(const uint8_t* data, size_t size) {
+        records = nullptr;
+        count = 0;
+        ProfileFileHeader header;
+        if (!data || size < sizeof(header)) return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, kProfileMagic, sizeof(kProfileMagic)) != 0 || header.version == 0 ||
+            header.record_size < sizeof(ProfileRecord) || header.record_size % alignof(ProfileRecord) != 0 ||
+            (size - sizeof(header)) / header.record_size < header.record_count) {
+            return false;
+        }
+        records = data + sizeof(header);
+        record_size = header.record_size;
+        count = header.record_count;
+        revision = header.revision;
+        for (size_t i = 1; i < count; i++) {
+            if (compareProfileUUID(at(i - 1), at(i).uuid) >= 0) {
+                records = nullptr;
+                count = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    size_t size() const { return count; }
+    uint64_t getRevision() const { return revision; }
+    
+    // Aligned for ProfileRecord: the header is 64 bytes, open() checks record_size, mappings are page aligned
+    const ProfileRecord& at(size_t i) const {
+        return *reinterpret_cast<const ProfileRecord*>(records + i * record_size);
+    }
+    
+    const ProfileRecord* find(const std::string& uuid) const {
+        size_t low = 0;
+        size_t high = count;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            int order = compareProfileUUID(at(mid), uuid.c_str());
+            if (order == 0) return &at(mid);
+            if (order < 0) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// Writes bytes through a temporary file, so a failed write never leaves a
+// truncated file behind
+inline bool writeFileReplacing(const std::string& path, const std::vector<uint8_t>& bytes, std::string& error) {
+    std::string temp_path = path + ".tmp";
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        error = "Cannot write " + temp_path;
+        return false;
+    }
+    bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = std::fclose(file) == 0 && written;
+#ifdef _WIN32
+    if (written) std::remove(path.c_str()); // rename() doesn't replace on Windows
+#endif
+    if (!written || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        error = "Cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+// Editable set of profiles, sorted by UUID. Every change bumps the revision,
+// which diffs use to check they are applied to the store they were made from.
+class ProfileStore {
+private:
+    std::vector<ProfileRecord> records;
+    uint64_t revision = 0;
+    
+    std::vector<ProfileRecord>::iterator lowerBound(const char* uuid) {
+        return std::lower_bound(records.begin(), records.end(), uuid, [](const ProfileRecord& record, const char* key) {
+            return compareProfileUUID(record, key) < 0;
+        });
+    }
+    
+    // Inserts or replaces; returns true if the store changed
+    bool upsert(const ProfileRecord& record) {
+        auto it = lowerBound(record.uuid);
+        if (it != records.end() && compareProfileUUID(*it, record.uuid) == 0) {
+            if (std::memcmp(&*it, &record, sizeof(record)) == 0) return false;
+            *it = record;
+        } else {
+            records.insert(it, record);
+        }
+        return true;
+    }
+    
+    bool erase(const char* uuid) {
+        auto it = lowerBound(uuid);
+        if (it == records.end() || compareProfileUUID(*it, uuid) != 0) return false;
+        records.erase(it);
+        return true;
+    }
+    
+    static void appendRecordFields(std::vector<uint8_t>& out, const ProfileRecord& record) {
+        appendVarint(out, record.core_clock);
+        appendVarint(out, record.memory_clock);
+        out.push_back(record.power_limit_percent);
+        out.push_back(record.flags);
+        if (record.flags & kProfileFanCurve) {
+            out.insert(out.end(), record.fan_curve, record.fan_curve + kFanCurvePoints);
+        }
+    }
+    
+    static bool readRecordFields(ByteReader& reader, ProfileRecord& record) {
+        uint64_t core_clock, memory_clock;
+        if (!reader.readVarint(core_clock) || !reader.readVarint(memory_clock) || core_clock > 65535 ||
+            memory_clock > 65535 || !reader.readFixed(record.power_limit_percent) || !reader.readFixed(record.flags)) {
+            return false;
+        }
+        record.core_clock = static_cast<uint16_t>(core_clock);
+        record.memory_clock = static_cast<uint16_t>(memory_clock);
+        if (record.flags & kProfileFanCurve) {
+            for (int i = 0; i < kFanCurvePoints; i++) {
+                if (!reader.readFixed(record.fan_curve[i])) return false;
+            }
+        }
+        return true;
+    }
+    
+    static bool readUUID(ByteReader& reader, std::string& uuid) {
+        return reader.readString(uuid) && !uuid.empty() && uuid.size() < kProfileUUIDBytes;
+    }
+    
+public:
+    size_t size() const { return records.size(); }
+    uint64_t getRevision() const { return revision; }
+    const std::vector<ProfileRecord>& getRecords() const { return records; }
+    
+    void clear() {
+        if (!records.empty()) revision++;
+        records.clear();
+    }
+    
+    const ProfileRecord* find(const std::string& uuid) const {
+        auto it = std::lower_bound(records.begin(), records.end(), uuid.c_str(),
+                                   [](const ProfileRecord& record, const char* key) {
+                                       return compareProfileUUID(record, key) < 0;
+                                   });
+        return it != records.end() && compareProfileUUID(*it, uuid.c_str()) == 0 ? &*it : nullptr;
+    }
+    
+    bool set(const std::string& uuid, const TuningProfile& profile) {
+        ProfileRecord record;
+        if (!makeProfileRecord(uuid, profile, record)) return false;
+        if (upsert(record)) revision++;
+        return true;
+    }
+    
+    bool remove(const std::string& uuid) {
+        ProfileRecord key;
+        if (!makeProfileRecord(uuid, TuningProfile(), key) || !erase(key.uuid)) return false;
+        revision++;
+        return true;
+    }
+    
+    // Copies a view's records, e.g. to edit a loaded file
+    void assign(const ProfileView& view) {
+        records.resize(view.size());
+        for (size_t i = 0; i < view.size(); i++) records[i] = view.at(i);
+        revision = view.getRevision();
+    }
+    
+    void encode(std::vector<uint8_t>& out) const {
+        ProfileFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kProfileMagic, sizeof(kProfileMagic));
+        header.version = kProfileVersion;
+        header.record_size = sizeof(ProfileRecord);
+        header.revision = revision;
+        header.record_count = static_cast<uint32_t>(records.size());
+        
+        out.resize(sizeof(header) + records.size() * sizeof(ProfileRecord));
+        std::memcpy(out.data(), &header, sizeof(header));
+        if (!records.empty()) {
+            std::memcpy(out.data() + sizeof(header), records.data(), records.size() * sizeof(ProfileRecord));
+        }
+    }
+    
+    // Changes that turn base into this store
+    void encodeDiff(const ProfileStore& base, std::vector<uint8_t>& out) const {
+        std::vector<const ProfileRecord*> upserts;
+        std::vector<const ProfileRecord*> removals;
+        size_t i = 0, j = 0;
+        while (i < records.size() || j < base.records.size()) {
+            int order = i == records.size() ? 1 : j == base.records.size() ? -1 :
+                        compareProfileUUID(records[i], base.records[j].uuid);
+            if (order < 0) {
+                upserts.push_back(&records[i++]);
+            } else if (order > 0) {
+                removals.push_back(&base.records[j++]);
+            } else {
+                if (std::memcmp(&records[i], &base.records[j], sizeof(ProfileRecord)) != 0) upserts.push_back(&records[i]);
+                i++;
+                j++;
+            }
+        }
+        
+        out.assign(kProfileDiffMagic, kProfileDiffMagic + sizeof(kProfileDiffMagic));
+        appendFixed(out, kProfileVersion);
+        appendVarint(out, base.revision);
+        appendVarint(out, revision);
+        appendVarint(out, upserts.size());
+        for (const ProfileRecord* record : upserts) {
+            appendString(out, std::string(record->uuid, strnlen(record->uuid, kProfileUUIDBytes)));
+            appendRecordFields(out, *record);
+        }
+        appendVarint(out, removals.size());
+        for (const ProfileRecord* record : removals) {
+            appendString(out, std::string(record->uuid, strnlen(record->uuid, kProfileUUIDBytes)));
+        }
+    }
+    
+    // Applies a diff made against this store's current revision. All or nothing:
+    // on any error the store is left as it was.
+    bool applyDiff(const uint8_t* data, size_t size, std::string& error) {
+        ByteReader reader(data, size);
+        uint32_t version;
+        uint64_t base_revision, new_revision, upsert_count, removal_count;
+        if (size < sizeof(kProfileDiffMagic) || std::memcmp(data, kProfileDiffMagic, sizeof(kProfileDiffMagic)) != 0 ||
+            !reader.skip(sizeof(kProfileDiffMagic)) || !reader.readFixed(version) || version == 0 ||
+            !reader.readVarint(base_revision) || !reader.readVarint(new_revision)) {
+            error = "Not a profile diff";
+            return false;
+        }
+        if (base_revision != revision) {
+            error = "Diff is against revision " + std::to_string(base_revision) + ", store is at " + std::to_string(revision);
+            return false;
+        }
+        
+        std::vector<ProfileRecord> original = records;
+        bool ok = reader.readVarint(upsert_count) && upsert_count <= reader.remaining();
+        for (uint64_t n = 0; ok && n < upsert_count; n++) {
+            std::string uuid;
+            ProfileRecord record;
+            ok = readUUID(reader, uuid) && makeProfileRecord(uuid, TuningProfile(), record) &&
+                 readRecordFields(reader, record);
+            if (ok) upsert(record);
+        }
+        ok = ok && reader.readVarint(removal_count) && removal_count <= reader.remaining();
+        for (uint64_t n = 0; ok && n < removal_count; n++) {
+            std::string uuid;
+            ok = readUUID(reader, uuid);
+            if (ok) erase(uuid.c_str());
+        }
+        if (!ok) {
+            records.swap(original);
+            error = "Profile diff is truncated or corrupt";
+            return false;
+        }
+        revision = new_revision;
+        return true;
+    }
+    
+    std::string toText() const {
+        std::ostringstream out;
+        out << "# gputune tuning profiles, one GPU per line\n";
+        out << "revision " << revision << "\n";
+        for (const ProfileRecord& record : records) {
+            out.write(record.uuid, strnlen(record.uuid, kProfileUUIDBytes));
+            if (record.core_clock) out << " core=" << record.core_clock;
+            if (record.memory_clock) out << " memory=" << record.memory_clock;
+            if (record.power_limit_percent) out << " power=" << static_cast<int>(record.power_limit_percent);
+            if (record.flags & kProfileFanCurve) {
+                out << " fan=";
+                for (int i = 0; i < kFanCurvePoints; i++) {
+                    out << (i ? "," : "") << static_cast<int>(record.fan_curve[i]);
+                }
+                out << " fan_control=" << ((record.flags & kProfileFanControl) ? 1 : 0);
+            }
+            out << "\n";
+        }
+        return out.str();
+    }
+    
+    // Replaces the contents with the text form. Unknown keys are skipped, so
+    // newer files stay readable.
+    bool fromText(const std::string& text, std::string& error) {
+        ProfileStore parsed;
+        std::istringstream in(text);
+        std::string line;
+        int line_number = 0;
+        while (std::getline(in, line)) {
+            line_number++;
+            std::istringstream fields(line);
+            std::string uuid;
+            if (!(fields >> uuid) || uuid[0] == '#') continue;
+            if (uuid == "revision") {
+                fields >> parsed.revision;
+                continue;
+            }
+            
+            TuningProfile profile;
+            std::string field;
+            while (fields >> field) {
+                size_t equals = field.find('=');
+                std::string key = field.substr(0, equals);
+                const char* value = equals == std::string::npos ? "" : field.c_str() + equals + 1;
+                if (key == "core") {
+                    profile.core_clock = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+                } else if (key == "memory") {
+                    profile.memory_clock = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+                } else if (key == "power") {
+                    profile.power_limit_percent = std::atoi(value);
+                } else if (key == "fan_control") {
+                    profile.fan_control = std::atoi(value) != 0;
+                } else if (key == "fan") {
+                    int* curve = profile.fan_curve;
+                    if (std::sscanf(value, "%d,%d,%d,%d,%d", &curve[0], &curve[1], &curve[2], &curve[3], &curve[4]) !=
+                        kFanCurvePoints) {
+                        error = "Line " + std::to_string(line_number) + ": fan needs " + std::to_string(kFanCurvePoints) +
+                                " comma-separated speeds";
+                        return false;
+                    }
+                    profile.set_fan_curve = true;
+                }
+            }
+            ProfileRecord record;
+            if (!makeProfileRecord(uuid, profile, record)) {
+                error = "Line " + std::to_string(line_number) + ": unusable GPU UUID";
+                return false;
+            }
+            parsed.upsert(record);
+        }
+        records.swap(parsed.records);
+        revision = parsed.revision;
+        return true;
+    }
+    
+    // Writes the binary form, or the text form
+    bool save(const std::string& path, bool text, std::string& error) const {
+        std::vector<uint8_t> bytes;
+        if (text) {
+            std::string body = toText();
+            bytes.assign(body.begin(), body.end());
+        } else {
+            encode(bytes);
+        }
+        return writeFileReplacing(path, bytes, error);
+    }
+};
+
+// A profile file opened for lookups: binary files are mapped and searched in
+// place, text files are parsed into a store
+class ProfileFile {
+private:
+    MappedFile mapping;
+    ProfileView view;
+    ProfileStore parsed;
+    bool binary = false;
+    
+public:
+    bool open(const std::string& path, std::string& error) {
+        binary = false;
+        parsed.clear();
+        if (!mapping.open(path)) {
+            error = "Cannot open " + path;
+            return false;
+        }
+        if (view.open(mapping.bytes(), mapping.length())) {
+            binary = true;
+            return true;
+        }
+        if (mapping.length() >= sizeof(kProfileMagic) &&
+            std::memcmp(mapping.bytes(), kProfileMagic, sizeof(kProfileMagic)) == 0) {
+            error = path + " is a damaged profile file";
+            return false;
+        }
+        std::string text(reinterpret_cast<const char*>(mapping.bytes()), mapping.length());
+        mapping.close();
+        return parsed.fromText(text, error);
+    }
+    
+    bool isBinary() const { return binary; }
+    size_t size() const { return binary ? view.size() : parsed.size(); }
+    uint64_t getRevision() const { return binary ? view.getRevision() : parsed.getRevision(); }
+    
+    const ProfileRecord* find(const std::string& uuid) const {
+        return binary ? view.find(uuid) : parsed.find(uuid);
+    }
+    
+    // Editable copy, e.g. to merge new profiles in before saving
+    void copyTo(ProfileStore& store) const {
+        if (binary) {
+            store.assign(view);
+        } else {
+            store = parsed;
+        }
+    }
+};
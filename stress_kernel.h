@@ -0,0 +1,274 @@
+#pragma once
+
+// Built-in compute stress benchmark for the auto-tuner. The kernel is PTX,
+// JIT-compiled by the driver for whatever GPU it runs on, so no CUDA toolkit
+// is needed. Every thread iterates the chaotic map x = x*x + c on four
+// independent FMA chains: any arithmetic error from an unstable clock changes
+// the result, and since fma.rn is exactly rounded the CPU can compute the one
+// value every thread must produce.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "cuda_driver_api.h"
+
+static const char kStressKernelPtx[] = R"PTX(
+.version 6.0
+.target sm_50
+.address_size 64
+
+.visible .entry gputune_fma_stress(
+    .param .u64 out_param,
+    .param .u32 iterations_param
+)
+{
+    .reg .pred %p;
+    .reg .b32 %r<8>;
+    .reg .f32 %f<8>;
+    .reg .b64 %rd<4>;
+    
+    ld.param.u64 %rd1, [out_param];
+    ld.param.u32 %r1, [iterations_param];
+    cvta.to.global.u64 %rd1, %rd1;
+    mov.u32 %r2, %ctaid.x;
+    mov.u32 %r3, %ntid.x;
+    mov.u32 %r4, %tid.x;
+    mad.lo.s32 %r5, %r2, %r3, %r4;
+    
+    mov.f32 %f1, 0f3F000000;
+    mov.f32 %f2, 0fBF400000;
+    mov.f32 %f3, 0f3FA00000;
+    mov.f32 %f4, 0fBFC00000;
+    mov.f32 %f5, 0fBFE66666;
+    mov.u32 %r6, 0;
+
+$LOOP:
+    setp.ge.u32 %p, %r6, %r1;
+    @%p bra $DONE;
+    fma.rn.f32 %f1, %f1, %f1, %f5;
+    fma.rn.f32 %f2, %f2, %f2, %f5;
+    fma.rn.f32 %f3, %f3, %f3, %f5;
+    fma.rn.f32 %f4, %f4, %f4, %f5;
+    fma.rn.f32 %f1, %f1, %f1, %f5;
+    fma.rn.f32 %f2, %f2, %f2, %f5;
+    fma.rn.f32 %f3, %f3, %f3, %f5;
+    fma.rn.f32 %f4, %f4, %f4, %f5;
+    add.u32 %r6, %r6, 1;
+    bra $LOOP;
+
+$DONE:
+    add.rn.f32 %f6, %f1, %f2;
+    add.rn.f32 %f6, %f6, %f3;
+    add.rn.f32 %f6, %f6, %f4;
+    mul.wide.u32 %rd2, %r5, 4;
+    add.u64 %rd3, %rd1, %rd2;
+    st.global.f32 [%rd3], %f6;
+    ret;
+}
+)PTX";
+
+static constexpr int kStressFmasPerIteration = 8;
+
+struct StressResult {
+    bool ok = false;     // Ran to completion without a CUDA error
+    uint64_t errors = 0; // Outputs that differ from the CPU reference
+    double gflops = 0.0;
+    double seconds = 0.0;
+    std::string error;
+};
+
+class StressKernel {
+private:
+    static constexpr unsigned int kThreadsPerBlock = 256;
+    static constexpr unsigned int kBlocksPerSM = 8;
+    static constexpr double kTargetLaunchSeconds = 0.05; // Short enough to stop promptly
+
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+    CudaDriverApi& cuda = cudaDriverApi();
+    CUcontext context = nullptr;
+    CUmodule module = nullptr;
+    CUfunction function = nullptr;
+    CUdeviceptr output = 0;
+#endif
+    unsigned int blocks = 0;
+    unsigned int iterations = 4096;
+    float reference = 0.0f;
+    std::vector<float> host_output;
+    
+    // The value every thread must produce, using the same operations in the same order
+    static float referenceValue(unsigned int iterations) {
+        const float c = -1.8f;
+        float x[4] = {0.5f, -0.75f, 1.25f, -1.5f};
+        for (unsigned int i = 0; i < iterations; i++) {
+            for (int pass = 0; pass < 2; pass++) {
+                for (float& value : x) {
+                    value = std::fma(value, value, c);
+                }
+            }
+        }
+        return ((x[0] + x[1]) + x[2]) + x[3];
+    }
+    
+    // "0000:01:00.0" (CUDA) and "00000000:01:00.0" (NVML) name the same device
+    static bool sameBusId(const std::string& a, const std::string& b) {
+        unsigned int domain_a, bus_a, device_a, domain_b, bus_b, device_b;
+        if (std::sscanf(a.c_str(), "%x:%x:%x", &domain_a, &bus_a, &device_a) != 3) return false;
+        if (std::sscanf(b.c_str(), "%x:%x:%x", &domain_b, &bus_b, &device_b) != 3) return false;
+        return domain_a == domain_b && bus_a == bus_b && device_a == device_b;
+    }
+
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+    bool check(CUresult result, const char* what, std::string& error) {
+        if (result == CUDA_SUCCESS) return true;
+        error = std::string(what) + ": " + cuda.errorString(result);
+        return false;
+    }
+    
+    bool launch(std::string& error) {
+        void* params[] = {&output, &iterations};
+        return check(cuda.LaunchKernel(function, blocks, 1, 1, kThreadsPerBlock, 1, 1, 0, nullptr, params, nullptr),
+                     "cuLaunchKernel", error) &&
+               check(cuda.CtxSynchronize(), "cuCtxSynchronize", error);
+    }
+#endif
+    
+public:
+    StressKernel() = default;
+    ~StressKernel() { close(); }
+    
+    StressKernel(const StressKernel&) = delete;
+    StressKernel& operator=(const StressKernel&) = delete;
+    
+    // Creates a context on the CUDA device at pci_bus_id (as reported by NVML) and
+    // calibrates the launch size. The context is current on the calling thread,
+    // which must be the one that calls run().
+    bool open(const std::string& pci_bus_id, std::string& error) {
+        close();
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+        if (!cuda.load()) {
+            error = "CUDA driver not available";
+            return false;
+        }
+        
+        int count = 0;
+        if (!check(cuda.DeviceGetCount(&count), "cuDeviceGetCount", error)) return false;
+        CUdevice device = -1;
+        for (int ordinal = 0; ordinal < count; ordinal++) {
+            CUdevice candidate;
+            char bus_id[32] = "";
+            if (cuda.DeviceGet(&candidate, ordinal) == CUDA_SUCCESS &&
+                cuda.DeviceGetPCIBusId(bus_id, sizeof(bus_id), candidate) == CUDA_SUCCESS &&
+                sameBusId(bus_id, pci_bus_id)) {
+                device = candidate;
+                break;
+            }
+        }
+        if (device < 0) {
+            error = "No CUDA device at " + pci_bus_id;
+            return false;
+        }
+        
+        int sm_count = 0;
+        if (!check(cuda.DeviceGetAttribute(&sm_count, CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, device),
+                   "cuDeviceGetAttribute", error) ||
+            !check(cuda.CtxCreate(&context, 0, device), "cuCtxCreate", error) ||
+            !check(cuda.ModuleLoadData(&module, kStressKernelPtx), "cuModuleLoadData", error) ||
+            !check(cuda.ModuleGetFunction(&function, module, "gputune_fma_stress"), "cuModuleGetFunction", error)) {
+            close();
+            return false;
+        }
+        
+        blocks = static_cast<unsigned int>(std::max(sm_count, 1)) * kBlocksPerSM;
+        size_t threads = static_cast<size_t>(blocks) * kThreadsPerBlock;
+        host_output.resize(threads);
+        if (!check(cuda.MemAlloc(&output, threads * sizeof(float)), "cuMemAlloc", error)) {
+            close();
+            return false;
+        }
+        
+        // Calibrate: scale the iteration count so one launch takes about kTargetLaunchSeconds
+        iterations = 4096;
+        auto start = std::chrono::steady_clock::now();
+        if (!launch(error)) {
+            close();
+            return false;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double scale = elapsed > 0.0 ? kTargetLaunchSeconds / elapsed : 64.0;
+        iterations = static_cast<unsigned int>(std::max(1024.0, std::min(iterations * scale, 16777216.0)));
+        reference = referenceValue(iterations);
+        return true;
+#else
+        (void)pci_bus_id;
+        error = "CUDA driver API is not supported on this platform";
+        return false;
+#endif
+    }
+    
+    void close() {
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+        if (context) {
+            cuda.CtxSetCurrent(context);
+            if (output) cuda.MemFree(output);
+            if (module) cuda.ModuleUnload(module);
+            cuda.CtxDestroy(context);
+        }
+        context = nullptr;
+        module = nullptr;
+        function = nullptr;
+        output = 0;
+#endif
+    }
+    
+    bool isOpen() const {
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+        return context != nullptr;
+#else
+        return false;
+#endif
+    }
+    
+    // Launches back to back for about duration_seconds, verifying every launch.
+    // should_stop is polled between launches.
+    template <typename StopFn>
+    StressResult run(double duration_seconds, StopFn should_stop) {
+        StressResult result;
+#ifdef GPUTUNE_HAVE_CUDA_DRIVER
+        if (!isOpen()) {
+            result.error = "Stress kernel not open";
+            return result;
+        }
+        
+        uint64_t launches = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (elapsed < duration_seconds && !should_stop()) {
+            if (!launch(result.error) ||
+                !check(cuda.MemcpyDtoH(host_output.data(), output, host_output.size() * sizeof(float)),
+                       "cuMemcpyDtoH", result.error)) {
+                return result;
+            }
+            for (float value : host_output) {
+                if (std::memcmp(&value, &reference, sizeof(float)) != 0) result.errors++;
+            }
+            launches++;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        
+        double flops = 2.0 * kStressFmasPerIteration * iterations * static_cast<double>(host_output.size()) * launches;
+        result.seconds = elapsed;
+        result.gflops = elapsed > 0.0 ? flops / elapsed / 1e9 : 0.0;
+        result.ok = true;
+#else
+        (void)duration_seconds;
+        (void)should_stop;
+        result.error = "CUDA driver API is not supported on this platform";
+#endif
+        return result;
+    }
+};
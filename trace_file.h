@@ -0,0 +1,515 @@
+#pragma once
+
+// Binary GPU traces for long captures (thermal throttling post-mortems etc.).
+//
+// File layout, all fixed-width fields little-endian:
+//   TraceFileHeader, then the GPU table (uuid and name per GPU, varint-length
+//   strings), then any number of chunks. Each chunk is a TraceChunkHeader and a
+//   columnar payload of up to kTraceChunkRecords sweeps: the timestamp column,
+//   then one column per (GPU, field). Every column is zigzag varint deltas
+//   against the previous record in the same chunk, so slowly changing values
+//   cost about a byte per sample and each chunk decodes on its own.
+//
+// TraceRecorder appends chunks from a snapshot subscription on its own thread.
+// TraceReplay memory-maps a file and decodes chunks only as playback reaches
+// them, so opening a multi-GB recording reads just the headers.
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <memory>
+
+#include "gpu_monitor.h"
+#include "binary_codec.h"
+#include "mapped_file.h"
+
+// Integer GPUInfo fields stored per record, in column order. Append only: a
+// newer file's extra columns are skipped, an older file's missing ones read 0.
+struct TraceField {
+    const char* name;
+    int GPUInfo::* member;
+};
+
+static const TraceField kTraceFields[] = {
+    {"temperature", &GPUInfo::temperature},
+    {"memory_used", &GPUInfo::memory_used},
+    {"memory_total", &GPUInfo::memory_total},
+    {"gpu_utilization", &GPUInfo::gpu_utilization},
+    {"memory_utilization", &GPUInfo::memory_utilization},
+    {"power_usage", &GPUInfo::power_usage},
+    {"power_limit", &GPUInfo::power_limit},
+    {"power_limit_min", &GPUInfo::power_limit_min},
+    {"core_clock", &GPUInfo::core_clock},
+    {"memory_clock", &GPUInfo::memory_clock},
+    {"fan_speed", &GPUInfo::fan_speed},
+    {"pcie_tx", &GPUInfo::pcie_tx},
+    {"pcie_rx", &GPUInfo::pcie_rx},
+    {"nvlink_tx", &GPUInfo::nvlink_tx},
+    {"nvlink_rx", &GPUInfo::nvlink_rx},
+    {"encoder_utilization", &GPUInfo::encoder_utilization},
+    {"decoder_utilization", &GPUInfo::decoder_utilization},
+    {"ecc_corrected", &GPUInfo::ecc_corrected},
+    {"ecc_uncorrected", &GPUInfo::ecc_uncorrected},
+};
+
+static constexpr uint32_t kTraceFieldCount = sizeof(kTraceFields) / sizeof(kTraceFields[0]);
+static constexpr uint32_t kTraceFirstInterconnectField = 11; // pcie_tx
+static const char kTraceMagic[8] = {'G', 'P', 'U', 'T', 'R', 'A', 'C', 'E'};
+static constexpr uint32_t kTraceVersion = 1;
+static constexpr uint32_t kTraceChunkMagic = 0x4b4e4843; // "CHNK"
+static constexpr uint32_t kTraceChunkRecords = 256;
+static constexpr uint32_t kTraceMaxFieldCount = 1024; // Far beyond any real file; guards corrupt headers
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t gpu_count;
+    uint32_t field_count;
+    uint32_t gpu_table_bytes;
+    int64_t start_us;
+    uint8_t reserved[16];
+};
+
+struct TraceChunkHeader {
+    uint32_t magic;
+    uint32_t record_count;
+    uint32_t payload_bytes;
+    uint32_t reserved;
+    int64_t first_us;
+    int64_t last_us;
+};
+
+static_assert(sizeof(TraceFileHeader) == 48, "TraceFileHeader layout is part of the file format");
+static_assert(sizeof(TraceChunkHeader) == 32, "TraceChunkHeader layout is part of the file format");
+
+class TraceRecorder {
+private:
+    static constexpr int kPollMs = 10;
+    static constexpr int kFlushIntervalMs = 5000; // Bounds what a crash can lose
+    
+    GPUMonitor& monitor;
+    std::shared_ptr<SnapshotBuffer> snapshots;
+    std::FILE* file = nullptr;
+    std::string path;
+    std::thread writer_thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> records_written{0};
+    std::atomic<uint64_t> bytes_written{0};
+    
+    // Writer thread only. Columns are sized once for a full chunk.
+    uint32_t gpu_count = 0;
+    uint64_t generation = 0;
+    bool generation_known = false;
+    bool device_set_changed = false;
+    uint64_t last_version = 0;
+    uint32_t pending_records = 0;
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> values; // [gpu][field][record]
+    std::vector<uint8_t> payload;
+    
+    size_t valueIndex(uint32_t gpu, uint32_t field, uint32_t record) const {
+        return (static_cast<size_t>(gpu) * kTraceFieldCount + field) * kTraceChunkRecords + record;
+    }
+    
+    bool writeBytes(const void* data, size_t size) {
+        if (std::fwrite(data, 1, size, file) != size) return false;
+        bytes_written += size;
+        return true;
+    }
+    
+    void appendRecord(const MonitorSnapshot& snapshot) {
+        if (!generation_known) {
+            generation = snapshot.generation;
+            generation_known = true;
+        }
+        if (snapshot.generation != generation || snapshot.gpus.size() != gpu_count) {
+            if (!device_set_changed) {
+                std::cerr << "GPUs were re-detected; " << path << " keeps the original device set only" << std::endl;
+                device_set_changed = true;
+            }
+            return;
+        }
+        
+        timestamps[pending_records] = snapshot.wall_time_us;
+        for (uint32_t g = 0; g < gpu_count; g++) {
+            for (uint32_t f = 0; f < kTraceFieldCount; f++) {
+                values[valueIndex(g, f, pending_records)] = snapshot.gpus[g].*kTraceFields[f].member;
+            }
+        }
+        pending_records++;
+    }
+    
+    void flushChunk() {
+        if (pending_records == 0) return;
+        
+        payload.clear();
+        int64_t previous = timestamps[0];
+        for (uint32_t r = 0; r < pending_records; r++) {
+            appendSignedVarint(payload, timestamps[r] - previous);
+            previous = timestamps[r];
+        }
+        for (uint32_t g = 0; g < gpu_count; g++) {
+            for (uint32_t f = 0; f < kTraceFieldCount; f++) {
+                previous = 0;
+                for (uint32_t r = 0; r < pending_records; r++) {
+                    int64_t value = values[valueIndex(g, f, r)];
+                    appendSignedVarint(payload, value - previous);
+                    previous = value;
+                }
+            }
+        }
+        
+        TraceChunkHeader header = {};
+        header.magic = kTraceChunkMagic;
+        header.record_count = pending_records;
+        header.payload_bytes = static_cast<uint32_t>(payload.size());
+        header.first_us = timestamps[0];
+        header.last_us = timestamps[pending_records - 1];
+        
+        if (!writeBytes(&header, sizeof(header)) || !writeBytes(payload.data(), payload.size())) {
+            std::cerr << "Failed to write " << path << std::endl;
+        }
+        std::fflush(file);
+        records_written += pending_records;
+        pending_records = 0;
+    }
+    
+    void writerLoop() {
+        auto last_flush = std::chrono::steady_clock::now();
+        bool draining = false;
+        
+        while (true) {
+            // One last look for a sweep published just before stop()
+            draining = !running;
+            
+            if (snapshots->fetch()) {
+                const MonitorSnapshot& snapshot = snapshots->readBuffer();
+                if (snapshot.version != last_version) {
+                    last_version = snapshot.version;
+                    appendRecord(snapshot);
+                }
+            }
+            
+            auto now = std::chrono::steady_clock::now();
+            if (pending_records == kTraceChunkRecords ||
+                now - last_flush >= std::chrono::milliseconds(kFlushIntervalMs)) {
+                flushChunk();
+                last_flush = now;
+            }
+            
+            if (draining) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+        }
+        flushChunk();
+    }
+    
+public:
+    explicit TraceRecorder(GPUMonitor& gpu_monitor) : monitor(gpu_monitor) {}
+    ~TraceRecorder() { stop(); }
+    
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    
+    // Writes the header and GPU table for the currently detected GPUs; call from
+    // the thread that owns monitor.getGPUs()
+    bool start(const std::string& file_path) {
+        if (running) return false;
+        
+        const std::vector<GPUInfo>& gpus = monitor.getGPUs();
+        if (gpus.empty()) {
+            std::cerr << "No GPUs to record" << std::endl;
+            return false;
+        }
+        
+        file = std::fopen(file_path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Failed to create " << file_path << std::endl;
+            return false;
+        }
+        path = file_path;
+        records_written = 0;
+        bytes_written = 0;
+        
+        std::vector<uint8_t> gpu_table;
+        for (const GPUInfo& gpu : gpus) {
+            appendString(gpu_table, gpu.uuid);
+            appendString(gpu_table, gpu.name);
+        }
+        
+        TraceFileHeader header = {};
+        std::memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+        header.version = kTraceVersion;
+        header.gpu_count = static_cast<uint32_t>(gpus.size());
+        header.field_count = kTraceFieldCount;
+        header.gpu_table_bytes = static_cast<uint32_t>(gpu_table.size());
+        header.start_us = wallClockMicros();
+        
+        if (!writeBytes(&header, sizeof(header)) || !writeBytes(gpu_table.data(), gpu_table.size())) {
+            std::cerr << "Failed to write " << file_path << std::endl;
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+        
+        gpu_count = header.gpu_count;
+        generation_known = false;
+        device_set_changed = false;
+        last_version = 0;
+        pending_records = 0;
+        timestamps.assign(kTraceChunkRecords, 0);
+        values.assign(static_cast<size_t>(gpu_count) * kTraceFieldCount * kTraceChunkRecords, 0);
+        payload.reserve(values.size() * 2 + kTraceChunkRecords * 3);
+        
+        snapshots = monitor.subscribeSnapshots();
+        running = true;
+        writer_thread = std::thread([this] { writerLoop(); });
+        std::cerr << "Recording to " << file_path << std::endl;
+        return true;
+    }
+    
+    void stop() {
+        if (!running) return;
+        running = false;
+        if (writer_thread.joinable()) {
+            writer_thread.join();
+        }
+        monitor.unsubscribeSnapshots(snapshots);
+        snapshots.reset();
+        std::fclose(file);
+        file = nullptr;
+    }
+    
+    bool isRecording() const { return running; }
+    uint64_t recordCount() const { return records_written; }
+    uint64_t byteCount() const { return bytes_written; }
+    const std::string& filePath() const { return path; }
+};
+
+// Plays a recording back into its own history store on the UI thread, in trace
+// time, so the graphs can read it exactly like live data
+class TraceReplay {
+private:
+    MappedFile mapping;
+    std::vector<GPUInfo> gpus;
+    std::vector<std::shared_ptr<GPUHistory>> histories;
+    uint32_t file_field_count = 0;
+    size_t next_chunk_offset = 0;
+    
+    // Decoded columns of the current chunk, reused between chunks
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> values; // [gpu][file field][record]
+    uint32_t chunk_records = 0;
+    uint32_t chunk_cursor = 0;
+    
+    int64_t first_us = 0;
+    int64_t current_us = 0;
+    bool finished = false;
+    bool paused = false;
+    double speed = 1.0;
+    
+    size_t valueIndex(uint32_t gpu, uint32_t field, uint32_t record) const {
+        return (static_cast<size_t>(gpu) * file_field_count + field) * chunk_records + record;
+    }
+    
+    // Header of the chunk at offset, or false at the end of the data (including
+    // a chunk cut short by a recorder that didn't shut down cleanly)
+    bool peekChunk(size_t offset, TraceChunkHeader& header) const {
+        if (offset + sizeof(header) > mapping.length()) return false;
+        std::memcpy(&header, mapping.bytes() + offset, sizeof(header));
+        if (header.magic != kTraceChunkMagic || header.record_count == 0 ||
+            offset + sizeof(header) + header.payload_bytes > mapping.length()) return false;
+        // Every value is at least a one-byte varint, so a corrupt count can't
+        // make decodeNextChunk() allocate more than the payload could fill
+        uint64_t min_bytes = static_cast<uint64_t>(header.record_count) *
+                             (1 + static_cast<uint64_t>(gpus.size()) * file_field_count);
+        return min_bytes <= header.payload_bytes;
+    }
+    
+    bool decodeNextChunk() {
+        TraceChunkHeader header;
+        if (!peekChunk(next_chunk_offset, header)) return false;
+        
+        chunk_records = header.record_count;
+        chunk_cursor = 0;
+        timestamps.resize(chunk_records);
+        values.resize(static_cast<size_t>(gpus.size()) * file_field_count * chunk_records);
+        
+        // A chunk that fails partway leaves no records behind to be read
+        ByteReader reader(mapping.bytes() + next_chunk_offset + sizeof(header), header.payload_bytes);
+        int64_t previous = header.first_us;
+        for (uint32_t r = 0; r < chunk_records; r++) {
+            int64_t delta;
+            if (!reader.readSignedVarint(delta)) {
+                chunk_records = 0;
+                return false;
+            }
+            previous += delta;
+            timestamps[r] = previous;
+        }
+        for (size_t i = 0; i < values.size(); i += chunk_records) {
+            previous = 0;
+            for (uint32_t r = 0; r < chunk_records; r++) {
+                int64_t delta;
+                if (!reader.readSignedVarint(delta)) {
+                    chunk_records = 0;
+                    return false;
+                }
+                previous += delta;
+                values[i + r] = previous;
+            }
+        }
+        
+        next_chunk_offset += sizeof(header) + header.payload_bytes;
+        return true;
+    }
+    
+    void applyRecord(uint32_t record) {
+        int64_t timestamp_us = timestamps[record];
+        uint32_t fields = std::min(file_field_count, kTraceFieldCount);
+        
+        for (uint32_t g = 0; g < gpus.size(); g++) {
+            GPUInfo& gpu = gpus[g];
+            for (uint32_t f = 0; f < fields; f++) {
+                gpu.*kTraceFields[f].member = static_cast<int>(values[valueIndex(g, f, record)]);
+            }
+            
+            GPUHistory& history = *histories[g];
+            history[HistoryMetric::Temperature].append(timestamp_us, gpu.temperature);
+            history[HistoryMetric::GPUUtilization].append(timestamp_us, gpu.gpu_utilization);
+            history[HistoryMetric::MemoryUtilization].append(timestamp_us, gpu.memory_utilization);
+            history[HistoryMetric::Power].append(timestamp_us, gpu.power_usage);
+            history[HistoryMetric::CoreClock].append(timestamp_us, gpu.core_clock);
+            history[HistoryMetric::MemoryClock].append(timestamp_us, gpu.memory_clock);
+            history[HistoryMetric::FanSpeed].append(timestamp_us, gpu.fan_speed);
+            if (fields > kTraceFirstInterconnectField) { // Older recordings have no interconnect columns
+                history[HistoryMetric::PCIeTx].append(timestamp_us, gpu.pcie_tx);
+                history[HistoryMetric::PCIeRx].append(timestamp_us, gpu.pcie_rx);
+                history[HistoryMetric::NVLinkTx].append(timestamp_us, gpu.nvlink_tx);
+                history[HistoryMetric::NVLinkRx].append(timestamp_us, gpu.nvlink_rx);
+                history[HistoryMetric::EncoderUtilization].append(timestamp_us, gpu.encoder_utilization);
+                history[HistoryMetric::DecoderUtilization].append(timestamp_us, gpu.decoder_utilization);
+            }
+            if (gpu.memory_total > 0) {
+                history[HistoryMetric::MemoryUsage].append(timestamp_us, (float)gpu.memory_used / gpu.memory_total * 100.0f);
+            }
+        }
+    }
+    
+public:
+    // Maps the file and reads its header and GPU table; chunks are decoded later
+    bool open(const std::string& path, std::string& error) {
+        close();
+        if (!mapping.open(path)) {
+            error = "Cannot open " + path;
+            return false;
+        }
+        
+        TraceFileHeader header;
+        ByteReader reader(mapping.bytes(), mapping.length());
+        if (!reader.readFixed(header) || std::memcmp(header.magic, kTraceMagic, sizeof(kTraceMagic)) != 0) {
+            error = path + " is not a gputune recording";
+            close();
+            return false;
+        }
+        if (header.version != kTraceVersion || header.field_count == 0 || header.field_count > kTraceMaxFieldCount) {
+            error = "Unsupported recording version";
+            close();
+            return false;
+        }
+        
+        ByteReader table(reader.position(), std::min<size_t>(header.gpu_table_bytes, reader.remaining()));
+        for (uint32_t g = 0; g < header.gpu_count; g++) {
+            GPUInfo gpu;
+            gpu.is_nvidia = true;
+            if (!table.readString(gpu.uuid) || !table.readString(gpu.name)) {
+                error = "Corrupt GPU table";
+                close();
+                return false;
+            }
+            gpus.push_back(gpu);
+            histories.push_back(std::make_shared<GPUHistory>());
+        }
+        
+        file_field_count = header.field_count;
+        next_chunk_offset = sizeof(header) + header.gpu_table_bytes;
+        
+        TraceChunkHeader first_chunk;
+        first_us = peekChunk(next_chunk_offset, first_chunk) ? first_chunk.first_us : header.start_us;
+        current_us = first_us;
+        return true;
+    }
+    
+    void close() {
+        mapping.close();
+        gpus.clear();
+        histories.clear();
+        chunk_records = 0;
+        chunk_cursor = 0;
+        finished = false;
+        paused = false;
+    }
+    
+    // Moves the playback clock on by elapsed wall time times the speed
+    void update(double elapsed_seconds) {
+        if (!isOpen() || paused || finished) return;
+        advanceTo(current_us + static_cast<int64_t>(elapsed_seconds * speed * 1e6));
+    }
+    
+    // Feeds every record up to trace_us into the histories
+    void advanceTo(int64_t trace_us) {
+        while (!finished) {
+            if (chunk_cursor == chunk_records && !decodeNextChunk()) {
+                finished = true;
+                break;
+            }
+            if (timestamps[chunk_cursor] > trace_us) break;
+            applyRecord(chunk_cursor++);
+        }
+        current_us = std::max(current_us, trace_us);
+        if (finished && chunk_records > 0) {
+            current_us = timestamps[chunk_records - 1];
+        }
+    }
+    
+    bool isOpen() const { return mapping.isOpen(); }
+    bool isFinished() const { return finished; }
+    int64_t currentTime() const { return current_us; }
+    int64_t startTime() const { return first_us; }
+    double fileSizeMB() const { return mapping.length() / (1024.0 * 1024.0); }
+    
+    bool isPaused() const { return paused; }
+    void setPaused(bool value) { paused = value; }
+    double getSpeed() const { return speed; }
+    void setSpeed(double value) { speed = value; }
+    
+    // GPU values as of the current playback time
+    const std::vector<GPUInfo>& getGPUs() const { return gpus; }
+    
+    // Same contract as GPUMonitor's, on the replayed history
+    bool copyHistory(size_t gpu_index, HistoryMetric metric, int64_t since_us,
+                     std::vector<MetricSample>& scratch, std::vector<float>& out) const {
+        out.clear();
+        if (gpu_index >= histories.size()) return false;
+        (*histories[gpu_index])[metric].copySince(since_us, scratch, out);
+        return true;
+    }
+    
+    // The store itself, for readers that follow it incrementally; nullptr if out of range
+    const MetricHistory* history(size_t gpu_index, HistoryMetric metric) const {
+        if (gpu_index >= histories.size()) return nullptr;
+        return &(*histories[gpu_index])[metric];
+    }
+    
+    bool copyRollups(size_t gpu_index, HistoryMetric metric, int tier, int64_t since_us,
+                     std::vector<RollupBucket>& out) const {
+        out.clear();
+        if (gpu_index >= histories.size()) return false;
+        (*histories[gpu_index])[metric].copyRollups(tier, since_us, out);
+        return true;
+    }
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads running submitted tasks in FIFO order. Used by
+// the sampler to query several GPUs at once, so a sweep costs about as long as
+// the slowest device rather than the sum of all of them.
+class WorkerPool {
+private:
+    struct Task {
+        std::function<void()> run;
+        std::function<void()> on_drop; // Cleanup if the pool is destroyed before run starts
+    };
+    
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    bool stopping = false;
+    
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        while (true) {
+            queue_cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping) return;
+            
+            Task task = std::move(tasks.front());
+            tasks.pop_front();
+            
+            lock.unlock();
+            task.run();
+            lock.lock();
+        }
+    }
+    
+public:
+    explicit WorkerPool(size_t thread_count) {
+        for (size_t i = 0; i < thread_count; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+    
+    // Queued tasks that haven't started are dropped, after running their
+    // on_drop cleanup; running ones are waited for
+    ~WorkerPool() {
+        std::deque<Task> dropped;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+            dropped.swap(tasks);
+        }
+        queue_cv.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        for (Task& task : dropped) {
+            if (task.on_drop) task.on_drop();
+        }
+    }
+    
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    void submit(std::function<void()> task, std::function<void()> on_drop = nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            tasks.push_back({std::move(task), std::move(on_drop)});
+        }
+        queue_cv.notify_one();
+    }
+    
+    size_t size() const { return workers.size(); }
+};
+
+// Counts outstanding tasks of one batch; the submitter waits with a deadline
+// so a task stuck in the driver can't hold the batch up indefinitely
+class CompletionLatch {
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending;
+    
+public:
+    explicit CompletionLatch(int count) : pending(count) {}
+    
+    void countDown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+            cv.notify_all();
+        }
+    }
+    
+    // Returns false if tasks were still outstanding at the deadline
+    bool waitUntil(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_until(lock, deadline, [this] { return pending <= 0; });
+    }
+};